@@ -0,0 +1,291 @@
+/*
+File: bench_frontend.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Microbenchmarks for the lexer and the parser. Run these with 
+`make bench-frontend`.
+
+Each benchmark runs over a synthetic program that is dominated by one kind of
+token or one production of the grammar. A benchmark is run a few times to
+warm up and then timed over a number of samples. The median of the samples is
+reported along with the median absolute deviation, which isn't thrown off by 
+the odd slow sample the way the mean and standard deviation are.
+*/
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bbc.h"
+#include "compiler.h"
+#include "generator.h"
+#include "lexer.h"
+#include "parallel_parser.h"
+#include "parser.h"
+#include "source.h"
+#include "token_pipeline.h"
+
+// The approximate size of each synthetic program
+static const size_t CORPUS_BYTES = 1 << 20;
+
+// The number of untimed runs before sampling starts
+static const int WARMUP_RUNS = 3;
+
+// The number of timed samples taken for each benchmark
+static const int SAMPLES = 15;
+
+// Builds a program by repeating a statement until it is about
+// CORPUS_BYTES long. `statement` is given the index of the repetition.
+static std::string buildCorpus(const std::string& prelude,
+    const std::function<std::string(size_t)>& statement)
+{
+    std::string program = prelude;
+    for (size_t i = 0; program.size() < CORPUS_BYTES; i++)
+        program += statement(i);
+    return program;
+}
+
+// Declarations used by the corpora that reference variables
+static const char* DECLARATIONS = 
+    "let alpha = 1;\nlet beta = 2;\nlet gamma = 3;\nlet delta = 4;\n";
+
+// Builds a program with `depth` levels of nested if/while blocks
+static std::string nestedBlock(size_t depth)
+{
+    std::string open;
+    std::string close;
+    for (size_t i = 0; i < depth; i++)
+    {
+        if (i % 2 == 0)
+            open += "if (alpha < beta) {\n";
+        else
+            open += "while (gamma > delta) {\n";
+        close += "}\n";
+    }
+    return open + "alpha = alpha + 1;\n" + close;
+}
+
+// What a benchmark runs
+enum BenchMode
+{
+    LEX,        // Lexing alone
+    PARSE,      // Parsing and code generation, lexing on demand
+    PIPELINE,   // Parsing and code generation, lexing on another thread
+    PARALLEL,   // Parsing and code generation, parsing pieces on every core
+    CHECK,      // Checking the program, without code generation
+    LOAD_BBC,   // Loading the program from a .bbc file and generating code
+    AST_SINK,   // Parsing alone, building the AST
+    NULL_SINK,  // Parsing alone, throwing the program away
+    COUNT_SINK, // Parsing alone, counting the nodes of the program
+};
+
+// Where the .bbc benchmarks write their program
+static const char* BBC_PATH = "/tmp/bench_frontend.bbc";
+
+// Loads a program into a source buffer the lexer can read
+static std::shared_ptr<SourceBuffer> makeSource(const std::string& program)
+{
+    std::istringstream stream(program);
+    return std::make_shared<SourceBuffer>(stream);
+}
+
+// Lexes a whole program and returns the number of tokens
+static size_t runLexer(const std::shared_ptr<SourceBuffer>& source)
+{
+    Lexer lexer(source);
+    size_t count = 0;
+    while (!Token::isKind(lexer.getToken(), T_EOF))
+        count++;
+    return count + 1;
+}
+
+// Parses a whole program into a sink, without generating any code
+template <typename Sink>
+static void runSink(const std::shared_ptr<SourceBuffer>& source)
+{
+    BasicParser<Sink>(std::make_shared<Lexer>(source)).parse();
+}
+
+// Loads a program from a .bbc file and generates its code. The generated
+// code is thrown away.
+static void runLoader()
+{
+    std::shared_ptr<Program> program = loadBbc(BBC_PATH);
+    std::ofstream output("/dev/null");
+    Generator generator(output);
+    generator.emitProgram(*program);
+}
+
+// Parses a whole program and generates its code. The generated code is
+// thrown away.
+static void runParser(const std::shared_ptr<SourceBuffer>& source, 
+    BenchMode mode)
+{
+    auto lexer = std::make_shared<Lexer>(source);
+    std::shared_ptr<Program> program;
+    if (mode == PARALLEL)
+        program = ParallelParser(source).parse();
+    else if (mode == PIPELINE)
+        program = Parser(std::make_shared<TokenPipeline>(lexer)).parse();
+    else
+        program = Parser(lexer).parse();
+    std::ofstream output("/dev/null");
+    Generator generator(output);
+    generator.emitProgram(*program);
+}
+
+// Gets the median of a set of samples
+static double median(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    size_t middle = samples.size() / 2;
+    if (samples.size() % 2 == 0)
+        return (samples[middle - 1] + samples[middle]) / 2;
+    return samples[middle];
+}
+
+// Times a benchmark and prints a line of results
+static void benchmark(const char* name, const std::string& program, 
+    BenchMode mode)
+{
+    auto source = makeSource(program);
+    size_t tokens = runLexer(source);
+
+    if (mode == LOAD_BBC)
+    {
+        std::ofstream output(BBC_PATH);
+        writeBbc(*Parser(std::make_shared<Lexer>(source)).parse(), output);
+    }
+
+    auto run = [&]() {
+        if (mode == LEX)
+            runLexer(source);
+        else if (mode == LOAD_BBC)
+            runLoader();
+        else if (mode == AST_SINK)
+            runSink<AstSink>(source);
+        else if (mode == NULL_SINK)
+            runSink<NullSink>(source);
+        else if (mode == COUNT_SINK)
+            runSink<CountingSink>(source);
+        else if (mode == CHECK)
+            check(std::string_view(source->data(), source->size()), 
+                CompileOptions());
+        else
+            runParser(source, mode);
+    };
+
+    for (int i = 0; i < WARMUP_RUNS; i++)
+        run();
+
+    std::vector<double> samples;
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double>(end - start).count());
+    }
+
+    double seconds = median(samples);
+    std::vector<double> deviations;
+    for (double sample : samples)
+        deviations.push_back(sample > seconds ? sample - seconds 
+            : seconds - sample);
+    double mad = median(deviations);
+
+    printf("%-24s %10zu %12.3f %12.2f %10.2f %8.2f%%\n", name, tokens,
+        tokens / seconds / 1e6, program.size() / seconds / 1e6,
+        seconds * 1e9 / tokens, 100.0 * mad / seconds);
+}
+
+int main()
+{
+    printf("%-24s %10s %12s %12s %10s %9s\n", "benchmark", "tokens", 
+        "Mtokens/s", "MB/s", "ns/token", "+/- MAD");
+
+    // Lexer::getToken over corpora dominated by one kind of token
+    benchmark("lex/identifiers", buildCorpus("", [](size_t i) {
+        return "let identifier" + std::to_string(i) + " = someOtherName" 
+            + std::to_string(i % 97) + ";\n";
+    }), LEX);
+    benchmark("lex/comments", buildCorpus("", [](size_t) {
+        return "# This comment runs on for a while, much like the comments "
+            "in our generated programs do; { } \"quotes\" are ignored\n";
+    }), LEX);
+    benchmark("lex/strings", buildCorpus("", [](size_t) {
+        return "print(\"a string literal that is long enough to be worth "
+            "scanning in bulk, with an \\\"escaped\\\" quote\\n\");\n";
+    }), LEX);
+    benchmark("lex/nesting", nestedBlock(CORPUS_BYTES / 40), LEX);
+
+    // Each Parser production, parsed from source to generated code
+    benchmark("parse/arithmetic", buildCorpus(DECLARATIONS, [](size_t) {
+        return "alpha = (alpha + beta) * gamma - delta % 7 / (beta + 1);\n";
+    }), PARSE);
+    benchmark("parse/boolean", buildCorpus(DECLARATIONS, [](size_t) {
+        return "if (alpha < beta and !(gamma == 3) or delta != 4) { }\n";
+    }), PARSE);
+    benchmark("parse/output", buildCorpus(DECLARATIONS, [](size_t) {
+        return "print(\"alpha is \", alpha, \" and beta is \", beta, \"\\n\");\n";
+    }), PARSE);
+    benchmark("parse/nested", buildCorpus(DECLARATIONS, [](size_t) {
+        return nestedBlock(16);
+    }), PARSE);
+    benchmark("parse/deep-nesting", 
+        std::string(DECLARATIONS) + nestedBlock(2000), PARSE);
+
+    // The same as above, with the lexer running on its own thread
+    benchmark("pipeline/arithmetic", buildCorpus(DECLARATIONS, [](size_t) {
+        return "alpha = (alpha + beta) * gamma - delta % 7 / (beta + 1);\n";
+    }), PIPELINE);
+    benchmark("pipeline/output", buildCorpus(DECLARATIONS, [](size_t) {
+        return "print(\"alpha is \", alpha, \" and beta is \", beta, \"\\n\");\n";
+    }), PIPELINE);
+
+    // The same again, with the input split into pieces parsed on every core
+    benchmark("parallel/arithmetic", buildCorpus(DECLARATIONS, [](size_t) {
+        return "alpha = (alpha + beta) * gamma - delta % 7 / (beta + 1);\n";
+    }), PARALLEL);
+    benchmark("parallel/nested", buildCorpus(DECLARATIONS, [](size_t) {
+        return nestedBlock(16);
+    }), PARALLEL);
+
+    // The front end alone, as run by `bb --check`
+    benchmark("check/arithmetic", buildCorpus(DECLARATIONS, [](size_t) {
+        return "alpha = (alpha + beta) * gamma - delta % 7 / (beta + 1);\n";
+    }), CHECK);
+    benchmark("check/output", buildCorpus(DECLARATIONS, [](size_t) {
+        return "print(\"alpha is \", alpha, \" and beta is \", beta, \"\\n\");\n";
+    }), CHECK);
+
+    // Parsing alone, into each of the parser's sinks
+    std::string sinkCorpus = buildCorpus(DECLARATIONS, [](size_t) {
+        return "if (alpha < beta) { alpha = (alpha + beta) * gamma - delta; }"
+            "\n";
+    });
+    benchmark("sink/ast", sinkCorpus, AST_SINK);
+    benchmark("sink/null", sinkCorpus, NULL_SINK);
+    benchmark("sink/counting", sinkCorpus, COUNT_SINK);
+
+    // Code generation from a precompiled program, as run by `bb --from-bbc`
+    benchmark("bbc/arithmetic", buildCorpus(DECLARATIONS, [](size_t) {
+        return "alpha = (alpha + beta) * gamma - delta % 7 / (beta + 1);\n";
+    }), LOAD_BBC);
+    benchmark("bbc/output", buildCorpus(DECLARATIONS, [](size_t) {
+        return "print(\"alpha is \", alpha, \" and beta is \", beta, \"\\n\");\n";
+    }), LOAD_BBC);
+    std::remove(BBC_PATH);
+
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include <stdio.h>
+
+int main(void) {
+	int a;
+	int b;
+	int q;
+	int r;
+	int s;
+	int t;
+	int u;
+	int w;
+	int x;
+	int c;
+
+	scanf("%d", &a);
+	scanf("%d", &b);
+	q = 0;
+	r = 0;
+	if (((b != 0))) {
+		q = a / b;
+		r = a % b;
+	}
+	printf("q=%d r=%d\n", q,  r);
+	if (((b > 0 && a >= 0))) {
+		s = a * 8;
+		t = a / 8;
+		u = a % 8;
+		w = a % b;
+		x = 100 % b;
+		printf("%d %d %d %d %d\n", s,  t,  u,  w,  x);
+	}
+	c = 0;
+	while (((c < 20))) {
+		if (((c > 0))) {
+			r = a / c + a % c;
+			printf("%d ", r);
+		}
+		c = c + 1;
+	}
+	printf("\n");
+	return 0;
+}
\ No newline at end of file
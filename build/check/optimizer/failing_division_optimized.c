@@ -0,0 +1,13 @@
+#include <stdio.h>
+
+int main(void) {
+	int a;
+	int d;
+	int unused;
+
+	scanf("%d", &a);
+	scanf("%d", &d);
+	unused = a / d;
+	printf("a=%d\n", a);
+	return 0;
+}
\ No newline at end of file
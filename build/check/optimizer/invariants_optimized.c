@@ -0,0 +1,49 @@
+#include <stdio.h>
+
+int main(void) {
+	int a;
+	int b;
+	int v;
+	int i;
+	int x;
+	int t_dotimes_0;
+	int t_hoisted_0;
+	int t_hoisted_1;
+	int t_hoisted_2;
+	int t_hoisted_3;
+	int t_hoisted_4;
+
+	scanf("%d", &a);
+	scanf("%d", &b);
+	scanf("%d", &v);
+	i = 0;
+	x = 0;
+	if (((v > 0))) {
+		t_hoisted_2 = (a - b);
+		t_hoisted_3 = a * b;
+		while (((i < 10))) {
+			x = x + t_hoisted_3 + t_hoisted_2;
+			printf("v %d\n", i);
+			i = i + 1;
+		}
+	}
+	else  {
+		t_hoisted_0 = (a - b);
+		t_hoisted_1 = a * b;
+		while (((i < 10))) {
+			x = x + t_hoisted_1 + t_hoisted_0;
+			printf("nv %d\n", i);
+			i = i + 1;
+		}
+	}
+	t_dotimes_0 = a;
+	if (((t_dotimes_0 > 0))) {
+		t_hoisted_4 = b / 3;
+		while (((t_dotimes_0 > 0))) {
+			x = x + t_hoisted_4;
+			t_dotimes_0 = t_dotimes_0 - 1;
+		}
+	}
+	printf("%d\n", x);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#include <stdio.h>
+
+int main(void) {
+	int a;
+	int b;
+	int v;
+	int i;
+	int x;
+
+	scanf("%d", &a);
+	scanf("%d", &b);
+	scanf("%d", &v);
+	i = 0;
+	x = 0;
+	while (((i < 10))) {
+		x = x + a * b + (a - b);
+		if (((v > 0))) {
+			printf("v %d\n", i);
+		}
+		else  {
+			printf("nv %d\n", i);
+		}
+		i = i + 1;
+	}
+	for (int i_dotimes_loop_counter_var=0; i_dotimes_loop_counter_var<a; i_dotimes_loop_counter_var++) {
+		x = x + b / 3;
+	}
+	printf("%d\n", x);
+	return 0;
+}
\ No newline at end of file
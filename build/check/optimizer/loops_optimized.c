@@ -0,0 +1,48 @@
+#include <stdio.h>
+
+int main(void) {
+	int n;
+	int i;
+	int total;
+	int j;
+	int count;
+	int t_dotimes_0;
+
+	scanf("%d", &n);
+	i = 0;
+	total = 0;
+	while (((i < n))) {
+		j = 0;
+		while (((j < i))) {
+			total = total + j * 2;
+			j = j + 1;
+		}
+		i = i + 1;
+	}
+	printf("total=%d\n", total);
+	count = 0;
+	t_dotimes_0 = n;
+	while (((t_dotimes_0 > 0))) {
+		count = count + 3;
+		t_dotimes_0 = t_dotimes_0 - 1;
+	}
+	count = count + 1;
+	count = count + 1;
+	count = count + 1;
+	count = count + 1;
+	count = count + 1;
+	for (int i_dotimes_loop_counter_var=0; i_dotimes_loop_counter_var<9; i_dotimes_loop_counter_var++) {
+		count = count + 2;
+		printf("%d ", count);
+		count = count + 2;
+		printf("%d ", count);
+		count = count + 2;
+		printf("%d ", count);
+		count = count + 2;
+		printf("%d ", count);
+	}
+	count = count + 2;
+	printf("%d ", count);
+	printf("\ncount=%d\n", count);
+	return 0;
+}
\ No newline at end of file
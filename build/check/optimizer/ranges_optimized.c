@@ -0,0 +1,24 @@
+#include <stdio.h>
+
+int main(void) {
+	int n;
+	int e;
+	int k;
+	int m;
+
+	scanf("%d", &n);
+	e = 10 + n + 5 + 6;
+	k = 0;
+	while (((k < 50))) {
+		if (((k >= 10 && k < 40))) {
+			e = e + k % 7 + (k >> 2) + (k << 1);
+		}
+		k = k + 3;
+	}
+	m = 100;
+	while (((m > n))) {
+		m = m - 7;
+	}
+	printf("e=%d k=%d m=%d\n", e,  k,  m);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#include <stdio.h>
+
+int main(void) {
+	int n;
+	int a;
+	int b;
+	int c;
+	int d;
+	int e;
+	int k;
+	int m;
+
+	scanf("%d", &n);
+	a = 1;
+	b = 2;
+	c = 3;
+	d = 4;
+	e = a + b + c + d + n + 5 + 6;
+	k = 0;
+	while (((k < 50))) {
+		if (((k >= 10 && k < 40))) {
+			e = e + k % 7 + k / 4 + k * 2;
+		}
+		k = k + 3;
+	}
+	m = 100;
+	while (((m > n))) {
+		m = m - 7;
+	}
+	printf("e=%d k=%d m=%d\n", e,  k,  m);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#include <stdio.h>
+
+int main(void) {
+	int v;
+	int sum;
+	int count;
+
+	v = 1;
+	sum = 0;
+	count = 0;
+	while (((v != 0))) {
+		scanf("%d", &v);
+		if (((v > 0))) {
+			sum = sum + v % 10;
+		}
+		else  {
+			sum = sum - v / 3;
+		}
+		count = count + 1;
+	}
+	printf("sum=%d count=%d\n", sum,  count);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#include <stdio.h>
+
+int main(void) {
+	int f;
+	int b;
+
+	scanf("%d", &f);
+	if (((f > 0))) {
+		b = 112 % f;
+		printf("b=%d\n", b);
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#include <stdio.h>
+
+int main(void) {
+	int n;
+	int a;
+	int c;
+	int same;
+
+	scanf("%d", &n);
+	a = n * 2;
+	c = a;
+	same = n * 3 + a;
+	printf("c=%d\n", c);
+	printf("%d %d\n", same,  same);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#include <stdio.h>
+
+int main(void) {
+	int n;
+	int a;
+	int b;
+	int c;
+	int dead;
+	int same;
+	int again;
+
+	scanf("%d", &n);
+	a = n + 1;
+	a = n * 2;
+	b = a;
+	c = b + 0;
+	dead = c * 5;
+	same = n * 3 + a;
+	again = n * 3 + a;
+	if (((1 < 2))) {
+		printf("c=%d\n", c);
+	}
+	else  {
+		printf("never\n");
+	}
+	while (((0))) {
+		dead = dead + 1;
+	}
+	printf("%d %d\n", same,  again);
+	return 0;
+}
\ No newline at end of file
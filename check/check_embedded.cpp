@@ -0,0 +1,101 @@
+/*
+File: check_embedded.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Checks that embedded.h builds and runs the example from the Readme. Run
+this with `make check-embedded`, which also checks that a program with an
+error in it (embedded_error.cpp) doesn't compile.
+
+The example is run twice: once at compile time with a constexpr host, and
+once when this program runs with a host that prints through stdio, the same
+as the Readme does.
+*/
+
+
+#include <cstdio>
+#include <string_view>
+
+#include "embedded.h"
+
+// The program from the Readme
+constexpr auto countdown = embedProgram<R"(
+    let n = 3;
+    while (n > 0) { print(n, "\n"); n = n - 1; }
+)">();
+
+// What the program prints
+static constexpr std::string_view EXPECTED = "3\n2\n1\n";
+
+// A host that keeps what a program prints, so the output can be checked at
+// compile time. The programs here never read.
+struct RecordingHost
+{
+    constexpr void print(std::string_view text)
+    {
+        for (char c : text)
+            append(c);
+    }
+
+    constexpr void print(int value)
+    {
+        // Write the digits backwards, then put them in order
+        char digits[12] = {};
+        size_t count = 0;
+        bool negative = value < 0;
+        unsigned int rest = negative ? 0u - static_cast<unsigned int>(value)
+            : static_cast<unsigned int>(value);
+        do
+        {
+            digits[count++] = static_cast<char>('0' + rest % 10);
+            rest /= 10;
+        } while (rest > 0);
+
+        if (negative)
+            append('-');
+        while (count > 0)
+            append(digits[--count]);
+    }
+
+    constexpr bool read(int&) { return false; }
+
+    constexpr void append(char c)
+    {
+        if (length < sizeof(printed))
+            printed[length++] = c;
+    }
+
+    constexpr std::string_view output() const
+    {
+        return std::string_view(printed, length);
+    }
+
+    char printed[64] = {};
+    size_t length = 0;
+};
+
+// Runs the program at compile time and gets what it printed
+constexpr bool printsExpected()
+{
+    RecordingHost host;
+    runEmbedded(countdown, host);
+    return host.output() == EXPECTED;
+}
+
+static_assert(printsExpected(), "The embedded program printed the wrong thing");
+
+int main()
+{
+    RecordingHost recorded;
+    runEmbedded(countdown, recorded);
+    if (recorded.output() != EXPECTED)
+    {
+        std::printf("The embedded program printed the wrong thing\n");
+        return 1;
+    }
+
+    // Run it the way the Readme does
+    StdioHost host;
+    runEmbedded(countdown, host);
+    return 0;
+}
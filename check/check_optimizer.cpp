@@ -0,0 +1,229 @@
+/*
+File: check_optimizer.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Checks that the optimizer doesn't change what a program does. Run these with
+`make check-optimizer`.
+
+Each program is compiled twice, with and without optimizing, and both
+versions of the generated C are built with the C compiler named on the
+command line. Both are run on the same input, and have to print the same
+thing and exit with the same status. The programs lean on the parts of the
+language the optimizer reasons about: input it can't know, loops, and
+division and remainder that are only safe behind a condition.
+*/
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "compiler.h"
+
+// A program along with the input it is run on
+struct CheckProgram
+{
+    const char* name;
+    const char* source;
+    const char* input;
+};
+
+// A program that divides by what it reads, behind conditions, so it is run
+// on several inputs
+static const char* DIVISION =
+    "let a; let b; read(a); read(b);\n"
+    "let q = 0; let r = 0;\n"
+    "if (b != 0) { q = a / b; r = a % b; }\n"
+    "print(\"q=\", q, \" r=\", r, \"\\n\");\n"
+    "if (b > 0 and a >= 0) {\n"
+    "    let s = a * 8; let t = a / 8; let u = a % 8;\n"
+    "    let w = a % b; let x = 100 % b;\n"
+    "    print(s, \" \", t, \" \", u, \" \", w, \" \", x, \"\\n\");\n"
+    "}\n"
+    "let c = 0;\n"
+    "while (c < 20) {\n"
+    "    if (c > 0) { r = a / c + a % c; print(r, \" \"); }\n"
+    "    c = c + 1;\n"
+    "}\n"
+    "print(\"\\n\");\n";
+
+static const CheckProgram PROGRAMS[] = {
+    {"remainder",
+        "let f; read(f);\n"
+        "if (f > 0) { let b = 112 % f; print(\"b=\", b, \"\\n\"); }\n",
+        "5"},
+    {"loops",
+        "let n; read(n);\n"
+        "let i = 0; let total = 0;\n"
+        "while (i < n) {\n"
+        "    let j = 0;\n"
+        "    while (j < i) { total = total + j * 2; j = j + 1; }\n"
+        "    i = i + 1;\n"
+        "}\n"
+        "print(\"total=\", total, \"\\n\");\n"
+        "let count = 0;\n"
+        "dotimes (n) { count = count + 3; }\n"
+        "dotimes (5) { count = count + 1; }\n"
+        "dotimes (37) { count = count + 2; print(count, \" \"); }\n"
+        "print(\"\\ncount=\", count, \"\\n\");\n",
+        "9"},
+    {"failing_division",
+        "let a; let d; read(a); read(d);\n"
+        "let unused = a / d;\n"
+        "print(\"a=\", a, \"\\n\");\n",
+        "7 0"},
+    {"invariants",
+        "let a; let b; let v; read(a); read(b); read(v);\n"
+        "let i = 0; let x = 0;\n"
+        "while (i < 10) {\n"
+        "    x = x + a * b + (a - b);\n"
+        "    if (v > 0) { print(\"v \", i, \"\\n\"); }\n"
+        "    else { print(\"nv \", i, \"\\n\"); }\n"
+        "    i = i + 1;\n"
+        "}\n"
+        "dotimes (a) { x = x + b / 3; }\n"
+        "print(x, \"\\n\");\n",
+        "4 11 0"},
+    {"ranges",
+        "let n; read(n);\n"
+        "let a = 1; let b = 2; let c = 3; let d = 4;\n"
+        "let e = a + b + c + d + n + 5 + 6;\n"
+        "let k = 0;\n"
+        "while (k < 50) {\n"
+        "    if (k >= 10 and k < 40) { e = e + k % 7 + k / 4 + k * 2; }\n"
+        "    k = k + 3;\n"
+        "}\n"
+        "let m = 100;\n"
+        "while (m > n) { m = m - 7; }\n"
+        "print(\"e=\", e, \" k=\", k, \" m=\", m, \"\\n\");\n",
+        "13"},
+    {"stores",
+        "let n; read(n);\n"
+        "let a = n + 1; a = n * 2;\n"
+        "let b = a; let c = b + 0; let dead = c * 5;\n"
+        "let same = n * 3 + a; let again = n * 3 + a;\n"
+        "if (1 < 2) { print(\"c=\", c, \"\\n\"); } else { print(\"never\\n\"); }\n"
+        "while (0) { dead = dead + 1; }\n"
+        "print(same, \" \", again, \"\\n\");\n",
+        "21"},
+    {"division", DIVISION, "87 6"},
+    {"division_by_zero", DIVISION, "87 0"},
+    {"division_negative", DIVISION, "-87 5"},
+    {"read_loop",
+        "let v = 1; let sum = 0; let count = 0;\n"
+        "while (v != 0) {\n"
+        "    read(v);\n"
+        "    if (v > 0) { sum = sum + v % 10; } else { sum = sum - v / 3; }\n"
+        "    count = count + 1;\n"
+        "}\n"
+        "print(\"sum=\", sum, \" count=\", count, \"\\n\");\n",
+        "12 7 -9 33 0"},
+};
+
+// Runs a shell command, stopping the check if it fails
+static void runOrExit(const std::string& command)
+{
+    if (std::system(command.c_str()) != 0)
+    {
+        std::printf("Failed to run: %s\n", command.c_str());
+        std::exit(2);
+    }
+}
+
+// Compiles a program to C and builds it into `path`. Returns false if the
+// program didn't compile.
+static bool build(const CheckProgram& program, bool optimize,
+    const std::string& cc, const std::string& path)
+{
+    CompileOptions options;
+    options.optimize = optimize;
+    CompileResult result;
+    {
+        // The sink closes its file when it goes away
+        FileSink sink(path + ".c");
+        result = compile(program.source, options, sink);
+    }
+
+    if (result.status != COMPILE_OK)
+    {
+        std::printf("FAIL: %s didn't compile%s\n", program.name,
+            optimize ? " with optimizing" : "");
+        for (const Diagnostic& diagnostic : result.diagnostics)
+            std::printf("    %s\n", diagnostic.message.c_str());
+        return false;
+    }
+
+    runOrExit(cc + " -w -o " + path + " " + path + ".c");
+    return true;
+}
+
+// Runs a built program on an input file, returning what it printed along
+// with its exit status
+static std::string run(const std::string& path, const std::string& input)
+{
+    std::string out;
+    FILE* pipe = popen(("exec " + path + " < " + input).c_str(), "r");
+    if (pipe == nullptr)
+    {
+        std::printf("Failed to run: %s\n", path.c_str());
+        std::exit(2);
+    }
+
+    char buffer[4096];
+    size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+        out.append(buffer, count);
+
+    int status = pclose(pipe);
+    out += "\nstatus " + std::to_string(status) + "\n";
+    return out;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        std::printf("Usage: %s <c compiler> <work directory>\n", argv[0]);
+        return 2;
+    }
+
+    std::string cc = argv[1];
+    std::string dir = argv[2];
+    runOrExit("mkdir -p " + dir);
+
+    int failures = 0;
+    for (const CheckProgram& program : PROGRAMS)
+    {
+        std::string base = dir + "/" + program.name;
+        std::string input = base + ".in";
+        std::ofstream(input) << program.input << "\n";
+
+        if (!build(program, false, cc, base + "_plain")
+            || !build(program, true, cc, base + "_optimized"))
+        {
+            failures++;
+            continue;
+        }
+
+        std::string expected = run(base + "_plain", input);
+        std::string actual = run(base + "_optimized", input);
+        if (actual != expected)
+        {
+            std::printf("FAIL: %s on input \"%s\"\nexpected:\n%sgot:\n%s",
+                program.name, program.input, expected.c_str(),
+                actual.c_str());
+            failures++;
+        }
+    }
+
+    if (failures > 0)
+    {
+        std::printf("%d optimized programs didn't match\n", failures);
+        return 1;
+    }
+
+    std::printf("All optimized programs matched\n");
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+File: check_stream.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Checks that streamed input is lexed the same way as input that is read all
+at once. Run these with `make check-stream`.
+
+Each program is written into a pipe and lexed in chunks of every size from
+1 to MAX_CHUNK_SIZE bytes, so the chunk boundaries land on every character
+of the program, including at the very end of the input. The tokens, or the
+error, have to match what the lexer gives for the whole program in memory.
+It also checks that input that can't be read at all is reported as an
+error rather than ending the program.
+*/
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+#include "compiler.h"
+#include "lexer.h"
+#include "source.h"
+
+// The largest chunk size the programs are streamed in
+static const size_t MAX_CHUNK_SIZE = 7;
+
+// Programs that end in the middle of each kind of token, along with a few
+// that end with whitespace, a comment or an error
+static const char* PROGRAMS[] = {
+    "let a = 1; let b = a",
+    "let a = 1; while",
+    "let a = 1; a = 12345",
+    "let a = 1; if (a <= 2) { a = a + 1; }",
+    "let alpha = 1;\nprint(\"alpha is \", alpha, \"\\n\");",
+    "let a = 1; a = a >= 1",
+    "let a = 1;   \n\t",
+    "let a = 1; # a comment",
+    "let a = 1; dotimes (a) { print(\"x\"); }",
+    "let a = 1; a = @",
+    "print(\"not closed",
+};
+
+// Lexes a program, writing each token's type and lexeme on its own line.
+// An error is written in place of the rest of the tokens.
+static std::string describe(Lexer& lexer)
+{
+    std::string out;
+    try
+    {
+        Token token;
+        do
+        {
+            token = lexer.getToken();
+            out += std::to_string(token.type());
+            out += ' ';
+            out += token.lexeme();
+            out += '\n';
+        } while (!Token::isKind(token, T_EOF));
+    }
+    catch (const LexError& e)
+    {
+        out += "error: ";
+        out += e.what();
+        out += '\n';
+    }
+    return out;
+}
+
+// Lexes a program from a pipe, reading `chunkSize` bytes at a time. The
+// programs are small enough to fit in the pipe, so it can be written all at
+// once before lexing starts.
+static std::string describeStreamed(std::string_view program, size_t chunkSize)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        std::perror("pipe");
+        std::exit(2);
+    }
+    if (write(fds[1], program.data(), program.size())
+        != static_cast<ssize_t>(program.size()))
+    {
+        std::perror("write");
+        std::exit(2);
+    }
+    close(fds[1]);
+
+    Lexer lexer(fds[0], chunkSize);
+    std::string out = describe(lexer);
+    close(fds[0]);
+    return out;
+}
+
+int main()
+{
+    int failures = 0;
+    for (const char* program : PROGRAMS)
+    {
+        Lexer whole(std::make_shared<SourceBuffer>(std::string_view(program)));
+        std::string expected = describe(whole);
+
+        for (size_t chunkSize = 1; chunkSize <= MAX_CHUNK_SIZE; chunkSize++)
+        {
+            std::string actual = describeStreamed(program, chunkSize);
+            if (actual != expected)
+            {
+                std::printf("FAIL: \"%s\" in chunks of %zu bytes\n"
+                    "expected:\n%sgot:\n%s", program, chunkSize,
+                    expected.c_str(), actual.c_str());
+                failures++;
+            }
+        }
+    }
+
+    // A descriptor that can't be read from, such as a directory, fails on
+    // the very first read. That has to come back as a diagnostic, the same
+    // as any other error in the input.
+    int directory = open(".", O_RDONLY);
+    CompileResult result = checkStream(directory, CompileOptions());
+    close(directory);
+    if (result.status != COMPILE_FAILED || result.diagnostics.empty()
+        || result.diagnostics[0].kind != D_LEXING)
+    {
+        std::printf("FAIL: a failed first read wasn't reported as a "
+            "diagnostic\n");
+        failures++;
+    }
+
+    if (failures > 0)
+    {
+        std::printf("%d streamed lexes didn't match\n", failures);
+        return 1;
+    }
+
+    std::printf("All streamed lexes matched\n");
+    return 0;
+}
@@ -0,0 +1,23 @@
+/*
+File: embedded_error.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+An embedded program with an error in it. `make check-embedded` checks that
+this fails to compile, with the error pointing at `embeddedProgramError`.
+*/
+
+
+#include "embedded.h"
+
+// `m` is never declared
+constexpr auto undeclared = embedProgram<R"(
+    let n = 3;
+    print(m);
+)">();
+
+int main()
+{
+    StdioHost host;
+    runEmbedded(undeclared, host);
+}
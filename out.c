@@ -0,0 +1,11 @@
+#include <stdio.h>
+
+int main(void) {
+	int a;
+	int b;
+
+	a = 1;
+	b = a;
+	printf("%d", b);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+/*
+File: ast.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `Ast` class.
+*/
+
+
+#include "ast.h"
+
+#include <cstring>
+
+Ast::Ast(size_t expectedNodes)
+    : m_arena(new Node[expectedNodes > 0 ? expectedNodes : 1]),
+    m_capacity(expectedNodes > 0 ? expectedNodes : 1)
+{
+    m_nodes = m_arena.get();
+    m_stringData = m_strings.data();
+}
+
+Ast::Ast(Node* nodes, size_t count, std::string_view strings, NodeId root)
+    : m_nodes(nodes), m_count(count), m_capacity(count), 
+    m_stringData(strings.data()), m_stringsLength(strings.size()),
+    m_borrowedStrings(true), m_root(root)
+{
+}
+
+NodeId Ast::add(NodeKind kind, uint32_t a, uint32_t b, uint32_t c)
+{
+    if (m_count == m_capacity)
+        grow(m_count + 1);
+
+    NodeId id = static_cast<NodeId>(m_count++);
+    Node& node = m_nodes[id];
+    node.kind = kind;
+    node.flags = 0;
+    node.op = 0;
+    node.a = a;
+    node.b = b;
+    node.c = c;
+    node.next = NO_NODE;
+    return id;
+}
+
+void Ast::grow(size_t count)
+{
+    // Grow the arena by doubling it. Nodes only refer to each other by
+    // index, so moving them doesn't break any links. Borrowed nodes are
+    // copied into an arena the same way.
+    size_t capacity = m_capacity > 0 ? m_capacity : 1;
+    while (capacity < count)
+        capacity *= 2;
+
+    std::unique_ptr<Node[]> nodes(new Node[capacity]);
+    std::memcpy(nodes.get(), m_nodes, m_count * sizeof(Node));
+    m_arena.swap(nodes);
+    m_nodes = m_arena.get();
+    m_capacity = capacity;
+}
+
+void Ast::ownStrings()
+{
+    if (!m_borrowedStrings)
+        return;
+
+    m_strings.assign(m_stringData, m_stringsLength);
+    m_stringData = m_strings.data();
+    m_borrowedStrings = false;
+}
+
+NodeId Ast::reserve(size_t count)
+{
+    if (m_count + count > m_capacity)
+        grow(m_count + count);
+
+    NodeId base = static_cast<NodeId>(m_count);
+    m_count += count;
+    return base;
+}
+
+uint32_t Ast::reserveStrings(size_t length)
+{
+    ownStrings();
+    uint32_t base = static_cast<uint32_t>(m_strings.size());
+    m_strings.resize(m_strings.size() + length);
+    m_stringData = m_strings.data();
+    m_stringsLength = m_strings.size();
+    return base;
+}
+
+void Ast::relocate(const Ast& from, NodeId base, uint32_t stringBase,
+    const std::vector<SymbolId>& symbols)
+{
+    auto link = [base](uint32_t id) {
+        return id == NO_NODE ? NO_NODE : id + base;
+    };
+
+    for (size_t i = 0; i < from.m_count; i++)
+    {
+        Node node = from.m_nodes[i];
+        switch (node.kind)
+        {
+            case N_DECLARE:
+            case N_ASSIGN:
+                node.a = symbols[node.a];
+                node.b = link(node.b);
+                break;
+            case N_READ:
+            case N_VAR:
+                node.a = symbols[node.a];
+                break;
+            case N_IF:
+                node.c = link(node.c);
+                // Fall through, the other links are the same as a loop's
+                [[fallthrough]];
+            case N_WHILE:
+            case N_DOTIMES:
+            case N_BINARY:
+                node.a = link(node.a);
+                node.b = link(node.b);
+                break;
+            case N_PRINT:
+            case N_NOT:
+            case N_PAREN:
+                node.a = link(node.a);
+                break;
+            case N_STRING:
+                node.a += stringBase;
+                break;
+            case N_NUM:
+                break;
+        }
+        node.next = link(node.next);
+        m_nodes[base + i] = node;
+    }
+
+    if (from.m_stringsLength > 0)
+        std::memcpy(&m_strings[stringBase], from.m_stringData, 
+            from.m_stringsLength);
+}
+
+NodeId Ast::addBinary(TokenType op, NodeId left, NodeId right)
+{
+    NodeId id = add(N_BINARY, left, right);
+    m_nodes[id].op = static_cast<int16_t>(op);
+    return id;
+}
+
+NodeId Ast::addString(std::string_view text)
+{
+    uint32_t offset = addStringText(text);
+    return add(N_STRING, offset, static_cast<uint32_t>(text.size()));
+}
+
+uint32_t Ast::addStringText(std::string_view text)
+{
+    ownStrings();
+    uint32_t offset = static_cast<uint32_t>(m_strings.size());
+    m_strings.append(text.data(), text.size());
+    m_stringData = m_strings.data();
+    m_stringsLength = m_strings.size();
+    return offset;
+}
+
+const char* opText(int op)
+{
+    switch (op)
+    {
+        case T_PLUS: return "+";
+        case T_MINUS: return "-";
+        case T_MUL: return "*";
+        case T_DIV: return "/";
+        case T_MOD: return "%";
+        case T_SHL: return "<<";
+        case T_SHR: return ">>";
+        case T_BITAND: return "&";
+        case T_EQEQ: return "==";
+        case T_NEQ: return "!=";
+        case T_LT: return "<";
+        case T_GT: return ">";
+        case T_LTEQ: return "<=";
+        case T_GTEQ: return ">=";
+        case T_AND: return "&&";
+        case T_OR: return "||";
+        default: return "?";
+    }
+}
@@ -0,0 +1,229 @@
+/*
+File: ast.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the abstract syntax tree (AST) built by the parser.
+*/
+
+
+#ifndef __AST_H__
+#define __AST_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "symbol_table.h"
+#include "token_type.h"
+
+// Identifies a node in the AST. Nodes refer to each other by their index in
+// the arena rather than by pointer.
+typedef uint32_t NodeId;
+
+// Marks a missing node, such as an empty block or a declaration without a
+// value
+const NodeId NO_NODE = UINT32_MAX;
+
+// The kinds of nodes in the AST. The comment on each kind describes how it
+// uses the fields of a `Node`.
+enum NodeKind : uint8_t
+{
+    // Statements. Statements in the same block are linked through `next`.
+    N_DECLARE,  // let: a = symbol, b = value (or NO_NODE)
+    N_ASSIGN,   // a = symbol, b = value
+    N_IF,       // a = condition, b = first statement of the if block,
+                // c = first statement of the else block
+    N_WHILE,    // a = condition, b = first statement of the body
+    N_DOTIMES,  // a = count (N_NUM or N_VAR), b = first statement of the body
+    N_PRINT,    // a = first argument, arguments are linked through `next`
+    N_READ,     // a = symbol
+
+    // Expressions
+    N_NUM,      // a = value
+    N_VAR,      // a = symbol
+    N_STRING,   // a = offset in the string pool, b = length
+    N_BINARY,   // op = operator, a = left operand, b = right operand
+    N_NOT,      // a = operand
+    N_PAREN,    // a = the expression inside of a set of parentheses
+};
+
+// Flags stored on a node
+enum NodeFlags : uint8_t
+{
+    F_HAS_ELSE = 1,     // N_IF: an else block was given (it may be empty)
+};
+
+// A single node of the AST. Every kind of node has the same layout, so the
+// whole tree is a flat array of these.
+struct Node
+{
+    NodeKind kind;
+    uint8_t flags;
+    int16_t op;     // The operator of an N_BINARY, as a TokenType
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    NodeId next;    // The next statement in a block, or the next argument
+};
+
+/*
+The `Ast` class holds the nodes of a program. Nodes are bump allocated from
+a single arena and refer to each other by index, so the arena can grow
+without invalidating any links, and the whole tree is released at once. The
+AST also keeps its own pool of string literal text, so it doesn't depend on
+the source buffer once parsing is done.
+*/
+class Ast
+{
+public:
+    // Creates an empty AST. `expectedNodes` is a hint for the initial size
+    // of the arena.
+    Ast(size_t expectedNodes = 1024);
+
+    // Creates an AST over nodes and string text that are already in memory,
+    // such as a mapped .bbc file. Nothing is copied until a node or string
+    // is added, so the memory must outlive the AST. Nodes may be changed in
+    // place, so they must be writable.
+    Ast(Node* nodes, size_t count, std::string_view strings, NodeId root);
+
+    // An AST can't be copied, since it may borrow its nodes
+    Ast(const Ast&) = delete;
+    Ast& operator=(const Ast&) = delete;
+
+    // Allocates a node and returns its ID
+    NodeId add(NodeKind kind, uint32_t a = 0, uint32_t b = 0,
+        uint32_t c = 0);
+
+    // Allocates an N_BINARY node
+    NodeId addBinary(TokenType op, NodeId left, NodeId right);
+
+    // Allocates an N_STRING node, copying the text into the string pool
+    NodeId addString(std::string_view text);
+
+    // Copies text into the string pool without making a node for it, and
+    // returns its offset
+    uint32_t addStringText(std::string_view text);
+
+    // Reserves room for `count` nodes at the end of the arena without
+    // filling them in, and returns the ID of the first one. They must be
+    // filled in with `relocate` before the AST is used.
+    NodeId reserve(size_t count);
+
+    // Reserves room for `length` characters at the end of the string pool,
+    // and returns the offset of the first one
+    uint32_t reserveStrings(size_t length);
+
+    // Copies every node of another AST into space reserved with `reserve`
+    // and `reserveStrings`, starting at node `base` and string offset
+    // `stringBase`. Links between the nodes are moved along with them, and
+    // the symbols they refer to are mapped through `symbols`. Copies into
+    // separate reserved spaces can be made from different threads at once.
+    void relocate(const Ast& from, NodeId base, uint32_t stringBase,
+        const std::vector<SymbolId>& symbols);
+
+    // Gets a node. References are invalidated when a node is added.
+    Node& operator[](NodeId id) { return m_nodes[id]; }
+    const Node& operator[](NodeId id) const { return m_nodes[id]; }
+
+    // Gets the text of an N_STRING node
+    std::string_view string(NodeId id) const
+    {
+        const Node& node = m_nodes[id];
+        return std::string_view(m_stringData + node.a, node.b);
+    }
+
+    // Gets the number of nodes
+    size_t size() const { return m_count; }
+
+    // Gets the number of characters in the string pool
+    size_t stringsSize() const { return m_stringsLength; }
+
+    // Gets every node, in order
+    const Node* nodes() const { return m_nodes; }
+
+    // Gets the whole string pool
+    std::string_view strings() const 
+    { 
+        return std::string_view(m_stringData, m_stringsLength); 
+    }
+
+    // Gets or sets the first statement of the program
+    NodeId root() const { return m_root; }
+    void setRoot(NodeId root) { m_root = root; }
+
+private:
+    // Grows the arena to hold at least `count` nodes
+    void grow(size_t count);
+
+    // Copies borrowed string text into the string pool before it changes
+    void ownStrings();
+
+    // The nodes, either in the arena or in borrowed memory
+    Node* m_nodes;
+
+    // The arena the nodes are allocated from. This is empty while the nodes
+    // are borrowed.
+    std::unique_ptr<Node[]> m_arena;
+
+    // The number of nodes allocated
+    size_t m_count = 0;
+
+    // The number of nodes the arena can hold before it needs to grow
+    size_t m_capacity = 0;
+
+    // The text of every string literal, stored back to back. This is empty
+    // while the text is borrowed.
+    std::string m_strings;
+
+    // The string text, either in `m_strings` or in borrowed memory
+    const char* m_stringData;
+    size_t m_stringsLength = 0;
+    bool m_borrowedStrings = false;
+
+    // The first statement of the program
+    NodeId m_root = NO_NODE;
+};
+
+/*
+A `Program` is everything the parser produces: the AST along with the
+symbol table for the variables it declares.
+*/
+struct Program
+{
+    Program() = default;
+
+    // Creates a program over an AST and symbol table that are already in
+    // memory (see the borrowing constructors of `Ast` and `SymbolTable`)
+    Program(Node* nodes, size_t count, std::string_view strings, NodeId root,
+        const SymbolTable::Layout& layout)
+        : ast(nodes, count, strings, root), symbols(layout) {}
+
+    Ast ast;
+    SymbolTable symbols;
+};
+
+// Helpers for working with the operators of N_BINARY nodes
+
+// Checks if an operator is one of the arithmetic operators, including the
+// ones only the optimizer makes
+constexpr bool isArithmeticOp(int op)
+{
+    return op == T_PLUS || op == T_MINUS || op == T_MUL || op == T_DIV
+        || op == T_MOD || op == T_SHL || op == T_SHR || op == T_BITAND;
+}
+
+// Checks if an operator is one of the comparison operators
+constexpr bool isComparisonOp(int op)
+{
+    return op == T_EQEQ || op == T_NEQ || op == T_LT || op == T_GT
+        || op == T_LTEQ || op == T_GTEQ;
+}
+
+// Gets the C spelling of an operator
+const char* opText(int op);
+
+#endif
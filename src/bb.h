@@ -11,8 +11,11 @@ as well as some helpers for printing debug information.
 #ifndef __BB_H__
 #define __BB_H__
 
-// Uncomment this line to enable debug output
+// Uncomment this line to enable debug output. Builds that must not print 
+// anything, such as the benchmarks, can turn it off with -DBB_NO_DEBUG.
+#ifndef BB_NO_DEBUG
 #define DEBUG
+#endif
 
 // If this line is uncommented "pretty print mode" will be enabled. This simply
 // appends a newline to the end of each line (after a `;`) in the generated 
@@ -0,0 +1,194 @@
+/*
+File: bbc.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for reading and writing .bbc files.
+*/
+
+
+#include "bbc.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+// The magic number at the start of every file
+static const char BBC_MAGIC[4] = { 'B', 'B', 'C', '\0' };
+
+// Written to each file so a reader can tell if it has the same byte order
+static const uint32_t BBC_BYTE_ORDER = 0x01020304;
+
+// Every array in a file starts on a multiple of this
+static const uint64_t BBC_ALIGNMENT = 8;
+
+// Rounds an offset up to the next array boundary
+static uint64_t align(uint64_t offset)
+{
+    return (offset + BBC_ALIGNMENT - 1) & ~(BBC_ALIGNMENT - 1);
+}
+
+// A program along with the mapping its arrays are borrowed from
+struct MappedProgram
+{
+    MappedProgram(void* address, size_t length, const BbcHeader& header,
+        const SymbolTable::Layout& symbols);
+    ~MappedProgram() { munmap(mapping, size); }
+
+    void* mapping;
+    size_t size;
+    Program program;
+};
+
+MappedProgram::MappedProgram(void* address, size_t length, 
+    const BbcHeader& header, const SymbolTable::Layout& symbols)
+    : mapping(address), size(length), 
+    program(reinterpret_cast<Node*>(static_cast<char*>(address) 
+        + header.nodes), header.nodeCount, 
+        std::string_view(static_cast<char*>(address) + header.strings, 
+        header.stringsLength), header.root, symbols)
+{
+}
+
+void writeBbc(const Program& program, std::ostream& output)
+{
+    const Ast& ast = program.ast;
+    const SymbolTable::Layout& symbols = program.symbols.layout();
+
+    // Lay out the arrays one after another
+    BbcHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BBC_MAGIC, sizeof(header.magic));
+    header.version = BBC_VERSION;
+    header.byteOrder = BBC_BYTE_ORDER;
+    header.nodeSize = sizeof(Node);
+    header.root = ast.root();
+
+    header.nodeCount = ast.size();
+    header.nodes = align(sizeof(BbcHeader));
+    header.stringsLength = ast.stringsSize();
+    header.strings = align(header.nodes + header.nodeCount * sizeof(Node));
+
+    header.symbolCount = symbols.count;
+    header.slotCount = symbols.slotCount;
+    header.namesLength = symbols.namesLength;
+    header.names = align(header.strings + header.stringsLength);
+    header.offsets = align(header.names + header.namesLength);
+    header.lengths = align(header.offsets 
+        + header.symbolCount * sizeof(uint64_t));
+    header.hashes = align(header.lengths 
+        + header.symbolCount * sizeof(uint32_t));
+    header.slots = align(header.hashes 
+        + header.symbolCount * sizeof(uint64_t));
+
+    // Writes an array at its offset, padding up to it first
+    uint64_t position = 0;
+    auto write = [&](uint64_t offset, const void* data, uint64_t length) {
+        static const char padding[BBC_ALIGNMENT] = {};
+        output.write(padding, static_cast<std::streamsize>(offset - position));
+        output.write(static_cast<const char*>(data), 
+            static_cast<std::streamsize>(length));
+        position = offset + length;
+    };
+
+    write(0, &header, sizeof(header));
+    write(header.nodes, ast.nodes(), header.nodeCount * sizeof(Node));
+    write(header.strings, ast.strings().data(), header.stringsLength);
+    write(header.names, symbols.names, header.namesLength);
+    write(header.offsets, symbols.offsets, 
+        header.symbolCount * sizeof(uint64_t));
+    write(header.lengths, symbols.lengths, 
+        header.symbolCount * sizeof(uint32_t));
+    write(header.hashes, symbols.hashes, 
+        header.symbolCount * sizeof(uint64_t));
+    write(header.slots, symbols.slots, header.slotCount * sizeof(SymbolId));
+    output.flush();
+}
+
+// Checks that an array of `count` items of `size` bytes at `offset` lies
+// within a file, and starts on an array boundary
+static bool fits(uint64_t offset, uint64_t count, uint64_t size, 
+    uint64_t fileSize)
+{
+    return offset % BBC_ALIGNMENT == 0 && offset <= fileSize
+        && count <= (fileSize - offset) / size;
+}
+
+std::shared_ptr<Program> loadBbc(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size < sizeof(BbcHeader))
+    {
+        close(fd);
+        throw BbcError("The file is too small to be a .bbc file.");
+    }
+
+    // The mapping is private and writable so that the program can be changed
+    // in place without changing the file
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+        fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return nullptr;
+
+    const BbcHeader& header = *static_cast<const BbcHeader*>(mapping);
+    const char* problem = nullptr;
+    if (std::memcmp(header.magic, BBC_MAGIC, sizeof(header.magic)) != 0)
+        problem = "The file isn't a .bbc file.";
+    else if (header.version != BBC_VERSION)
+        problem = "The file was written by a different version of bb.";
+    else if (header.byteOrder != BBC_BYTE_ORDER 
+        || header.nodeSize != sizeof(Node))
+        problem = "The file was written on a different kind of machine.";
+    else if (!fits(header.nodes, header.nodeCount, sizeof(Node), size)
+        || !fits(header.strings, header.stringsLength, 1, size)
+        || !fits(header.names, header.namesLength, 1, size)
+        || !fits(header.offsets, header.symbolCount, sizeof(uint64_t), size)
+        || !fits(header.lengths, header.symbolCount, sizeof(uint32_t), size)
+        || !fits(header.hashes, header.symbolCount, sizeof(uint64_t), size)
+        || !fits(header.slots, header.slotCount, sizeof(SymbolId), size))
+        problem = "The file is truncated.";
+    else if (header.nodeCount >= NO_NODE 
+        || (header.root != NO_NODE && header.root >= header.nodeCount))
+        problem = "The file has an invalid AST.";
+    else if (header.slotCount <= header.symbolCount
+        || (header.slotCount & (header.slotCount - 1)) != 0)
+        problem = "The file has an invalid symbol table.";
+
+    if (problem != nullptr)
+    {
+        munmap(mapping, size);
+        throw BbcError(problem);
+    }
+
+    const char* base = static_cast<const char*>(mapping);
+    SymbolTable::Layout symbols;
+    symbols.slots = reinterpret_cast<const SymbolId*>(base + header.slots);
+    symbols.slotCount = header.slotCount;
+    symbols.names = base + header.names;
+    symbols.namesLength = header.namesLength;
+    symbols.offsets = reinterpret_cast<const uint64_t*>(base + header.offsets);
+    symbols.lengths = reinterpret_cast<const uint32_t*>(base + header.lengths);
+    symbols.hashes = reinterpret_cast<const uint64_t*>(base + header.hashes);
+    symbols.count = header.symbolCount;
+
+    // The program is returned through a pointer that shares ownership of the
+    // mapping, so the mapping is released along with the program
+    auto mapped = std::make_shared<MappedProgram>(mapping, size, header, 
+        symbols);
+    return std::shared_ptr<Program>(mapped, &mapped->program);
+}
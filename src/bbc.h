@@ -0,0 +1,80 @@
+/*
+File: bbc.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the .bbc format, which holds a parsed program so it can be
+compiled again without lexing or parsing it.
+*/
+
+
+#ifndef __BBC_H__
+#define __BBC_H__
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+
+#include "ast.h"
+
+// The version of the format. This changes whenever the layout of a file, 
+// the layout of a `Node`, or the hash of a symbol name does.
+const uint32_t BBC_VERSION = 1;
+
+/*
+A .bbc file is this header followed by the arrays of a `Program`, exactly as
+they are laid out in memory. Each array starts on an 8 byte boundary. The
+offsets in the header are from the start of the file.
+
+Files are written in the byte order of the machine that wrote them, and are
+only meant to be read back on the same kind of machine.
+*/
+struct BbcHeader
+{
+    char magic[4];          // "BBC" followed by a 0
+    uint32_t version;       // BBC_VERSION
+    uint32_t byteOrder;     // 0x01020304, as written by the writer
+    uint32_t nodeSize;      // sizeof(Node)
+    uint32_t root;          // The first statement of the program
+    uint32_t reserved;
+
+    // The AST
+    uint64_t nodeCount;
+    uint64_t nodes;
+    uint64_t stringsLength;
+    uint64_t strings;
+
+    // The symbol table (see `SymbolTable::Layout`)
+    uint64_t symbolCount;
+    uint64_t slotCount;
+    uint64_t namesLength;
+    uint64_t names;
+    uint64_t offsets;
+    uint64_t lengths;
+    uint64_t hashes;
+    uint64_t slots;
+};
+
+// Thrown when a file isn't a valid .bbc file
+class BbcError : public std::runtime_error
+{
+public:
+    BbcError(const char* msg) : std::runtime_error(msg) {}
+};
+
+// Writes a program to a stream in the .bbc format
+void writeBbc(const Program& program, std::ostream& output);
+
+// Maps a .bbc file into memory and returns the program in it. The program 
+// reads its nodes and symbols straight from the mapping, which stays open 
+// for as long as the program does. Changes made to the program are private 
+// to it, and pages are only copied when they are changed.
+//
+// Returns null if the file can't be read. Throws a `BbcError` if the file
+// isn't a valid .bbc file. Only the header and the bounds of each array are
+// checked; the nodes themselves are trusted, since checking them would take
+// the pass over the program that the format exists to avoid.
+std::shared_ptr<Program> loadBbc(const char* path);
+
+#endif
@@ -0,0 +1,133 @@
+/*
+File: branch_eliminator.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `BranchEliminator` class.
+*/
+
+
+#include "branch_eliminator.h"
+
+BranchEliminator::BranchEliminator(Program& program) : m_ast(program.ast)
+{
+}
+
+void BranchEliminator::run()
+{
+    // Blocks are cleaned up one at a time from a stack, rather than by
+    // recursing into nested blocks. The nodes never move, since none are
+    // added, so links into them stay valid.
+    NodeId root = m_ast.root();
+    m_work.push_back(CleanTask{&root, NO_NODE});
+    while (!m_work.empty())
+    {
+        CleanTask task = m_work.back();
+        m_work.pop_back();
+        if (task.id == NO_NODE)
+        {
+            cleanBlock(task.link);
+            continue;
+        }
+
+        // The statement's blocks have been cleaned up, and so have the
+        // statements after it, so it can be unlinked through the link to it
+        const Node& node = m_ast[task.id];
+        if (isEmpty(node))
+            *task.link = node.next;
+    }
+    m_ast.setRoot(root);
+}
+
+void BranchEliminator::cleanBlock(NodeId* head)
+{
+    NodeId* link = head;
+    NodeId id = *head;
+    while (id != NO_NODE)
+    {
+        Node& node = m_ast[id];
+        NodeId next = node.next;
+        int value = 0;
+
+        if (node.kind == N_IF && knownValue(node.a, value))
+        {
+            // Splice the branch that is taken in place of the if. Its
+            // statements are cleaned up along with the rest of this block.
+            NodeId taken = NO_NODE;
+            if (value != 0)
+                taken = node.b;
+            else if (node.flags & F_HAS_ELSE)
+                taken = node.c;
+
+            if (taken == NO_NODE)
+            {
+                id = next;
+                continue;
+            }
+
+            NodeId last = taken;
+            while (m_ast[last].next != NO_NODE)
+                last = m_ast[last].next;
+            m_ast[last].next = next;
+            id = taken;
+            continue;
+        }
+
+        bool neverRuns = false;
+        if (node.kind == N_WHILE && knownValue(node.a, value))
+            neverRuns = value == 0;
+        else if (node.kind == N_DOTIMES && knownValue(node.a, value))
+            neverRuns = value <= 0;
+
+        if (neverRuns || isEmpty(node))
+        {
+            id = next;
+            continue;
+        }
+
+        // Keep the statement, and clean up any blocks it has. It is checked
+        // again once they are done, in case they end up empty.
+        if (node.kind == N_IF || node.kind == N_DOTIMES)
+            m_work.push_back(CleanTask{link, id});
+        *link = id;
+        link = &node.next;
+        if (node.kind == N_IF)
+        {
+            m_work.push_back(CleanTask{&node.b, NO_NODE});
+            if (node.flags & F_HAS_ELSE)
+                m_work.push_back(CleanTask{&node.c, NO_NODE});
+        }
+        else if (node.kind == N_WHILE || node.kind == N_DOTIMES)
+        {
+            m_work.push_back(CleanTask{&node.b, NO_NODE});
+        }
+
+        // Nothing after a loop that never ends can run
+        if (node.kind == N_WHILE && knownValue(node.a, value) && value != 0)
+            break;
+
+        id = next;
+    }
+
+    *link = NO_NODE;
+}
+
+bool BranchEliminator::isEmpty(const Node& node) const
+{
+    // A while loop with an empty body still runs until its condition is
+    // false, which may be never
+    if (node.kind == N_IF)
+        return node.b == NO_NODE 
+            && (!(node.flags & F_HAS_ELSE) || node.c == NO_NODE);
+    return node.kind == N_DOTIMES && node.b == NO_NODE;
+}
+
+bool BranchEliminator::knownValue(NodeId id, int& value) const
+{
+    const Node& node = m_ast[id];
+    if (node.kind != N_NUM)
+        return false;
+
+    value = static_cast<int>(node.a);
+    return true;
+}
@@ -0,0 +1,73 @@
+/*
+File: branch_eliminator.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the dead branch elimination pass.
+*/
+
+
+#ifndef __BRANCH_ELIMINATOR_H__
+#define __BRANCH_ELIMINATOR_H__
+
+#include <vector>
+
+#include "ast.h"
+
+/*
+The `BranchEliminator` class removes code that can never run, and the
+branches around code that always runs. It relies on constant folding to
+have turned conditions that are known when the program is compiled into
+N_NUM nodes, so it runs after the `ConstantFolder`:
+
+* An if whose condition is known is replaced by the statements of the
+  branch that is taken, which are spliced into the block around the if.
+* A while loop whose condition is known to be false, or a dotimes loop whose
+  count is known to be zero or less, is removed.
+* An if with nothing in either of its blocks, or a dotimes loop with
+  nothing in its body, is removed, since conditions and counts can't have
+  side effects. This includes blocks that are emptied by this pass.
+* A while loop whose condition is known to be true never ends, so the
+  statements after it in its block are removed.
+
+Statements are unlinked from their blocks rather than freed, so the nodes
+stay in the arena without anything referring to them.
+*/
+class BranchEliminator
+{
+public:
+    BranchEliminator(Program& program);
+
+    // Runs the pass
+    void run();
+
+private:
+    Ast& m_ast;
+
+    // A step of work left to do
+    struct CleanTask
+    {
+        // The link the first statement of a block is stored in, or the link
+        // to the statement `id`
+        NodeId* link;
+
+        // A statement to check once its blocks have been cleaned up, or
+        // NO_NODE to clean up the block at `link`
+        NodeId id;
+    };
+
+    // The work left to do
+    std::vector<CleanTask> m_work;
+
+    // Cleans up the statements of a block, linking the statements that are
+    // kept through `head`
+    void cleanBlock(NodeId* head);
+
+    // Checks if a statement does nothing
+    bool isEmpty(const Node& node) const;
+
+    // Gets the value of a condition or dotimes count, if it is known
+    bool knownValue(NodeId id, int& value) const;
+};
+
+#endif
@@ -0,0 +1,115 @@
+/*
+File: char_class.h
+Author: Adam Thompson
+Course: CSC 407
+
+This file contains the character tables that drive the lexer. Each table has
+an entry for every possible byte and is built at compile time.
+*/
+
+
+#ifndef __CHAR_CLASS_H__
+#define __CHAR_CLASS_H__
+
+#include <array>
+#include <cstdint>
+
+#include "token_type.h"
+
+// The classes of characters that can start a token
+enum CharClass : uint8_t
+{
+    C_OTHER,    // Not valid at the start of a token
+    C_END,      // '\0', marks the end of the input
+    C_NEWLINE,  // '\n'
+    C_SINGLE,   // A single character token, such as '+' or '{'
+    C_PAIR,     // A token that may be followed by a '=' to form a second token
+    C_QUOTE,    // '"', the start of a string literal
+    C_DIGIT,    // 0-9, the start of a number literal
+    C_ALPHA,    // A-Z and a-z, the start of an identifier or keyword
+};
+
+// Builds the character class table
+constexpr std::array<CharClass, 256> buildCharClasses()
+{
+    std::array<CharClass, 256> table = {};
+    for (int c = 0; c < 256; c++)
+        table[c] = C_OTHER;
+
+    table['\0'] = C_END;
+    table['\n'] = C_NEWLINE;
+    table['"'] = C_QUOTE;
+    for (int c = '0'; c <= '9'; c++)
+        table[c] = C_DIGIT;
+    for (int c = 'a'; c <= 'z'; c++)
+        table[c] = C_ALPHA;
+    for (int c = 'A'; c <= 'Z'; c++)
+        table[c] = C_ALPHA;
+
+    for (char c : { '+', '-', '*', '/', '%', '(', ')', '[', ']', '{', '}', 
+        ';', ',' })
+        table[static_cast<unsigned char>(c)] = C_SINGLE;
+    for (char c : { '=', '<', '>', '!' })
+        table[static_cast<unsigned char>(c)] = C_PAIR;
+
+    return table;
+}
+
+constexpr std::array<CharClass, 256> CHAR_CLASSES = buildCharClasses();
+
+// Builds the table of token types for a character on its own. This is the
+// accepting state for C_SINGLE characters, and for C_PAIR characters that 
+// aren't followed by a '='.
+constexpr std::array<TokenType, 256> buildSingleTokens()
+{
+    std::array<TokenType, 256> table = {};
+    for (int c = 0; c < 256; c++)
+        table[c] = T_UNKNOWN;
+
+    table['+'] = T_PLUS;
+    table['-'] = T_MINUS;
+    table['*'] = T_MUL;
+    table['/'] = T_DIV;
+    table['%'] = T_MOD;
+    table['('] = T_LPAREN;
+    table[')'] = T_RPAREN;
+    table['['] = T_LBRACKET;
+    table[']'] = T_RBRACKET;
+    table['{'] = T_LBRACE;
+    table['}'] = T_RBRACE;
+    table[';'] = T_SEMICOLON;
+    table[','] = T_COMMA;
+    table['='] = T_EQ;
+    table['<'] = T_LT;
+    table['>'] = T_GT;
+    table['!'] = T_NOT;
+
+    return table;
+}
+
+constexpr std::array<TokenType, 256> SINGLE_TOKENS = buildSingleTokens();
+
+// Builds the table of token types for a C_PAIR character followed by a '='
+constexpr std::array<TokenType, 256> buildPairTokens()
+{
+    std::array<TokenType, 256> table = {};
+    for (int c = 0; c < 256; c++)
+        table[c] = T_UNKNOWN;
+
+    table['='] = T_EQEQ;
+    table['<'] = T_LTEQ;
+    table['>'] = T_GTEQ;
+    table['!'] = T_NEQ;
+
+    return table;
+}
+
+constexpr std::array<TokenType, 256> PAIR_TOKENS = buildPairTokens();
+
+// Gets the class of a character
+inline CharClass charClass(char c)
+{
+    return CHAR_CLASSES[static_cast<unsigned char>(c)];
+}
+
+#endif
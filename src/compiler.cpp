@@ -0,0 +1,194 @@
+/*
+File: compiler.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation of the libbb interface.
+*/
+
+
+#include "compiler.h"
+
+#include <memory>
+
+#include "ast.h"
+#include "bbc.h"
+#include "generator.h"
+#include "lexer.h"
+#include "optimizer.h"
+#include "parallel_parser.h"
+#include "parser.h"
+#include "source.h"
+#include "token_pipeline.h"
+#include "token_stream.h"
+
+// Records a failed compile
+static void fail(CompileResult& result, DiagnosticKind kind, 
+    std::string message, std::string token = std::string())
+{
+    result.status = COMPILE_FAILED;
+    result.diagnostics.push_back(Diagnostic{kind, message, token});
+}
+
+// Parses a program with a front end, handing it to a parser built with the
+// given sink. The parallel front end always builds the program's AST.
+template <typename Sink>
+static std::shared_ptr<Program> parse(std::shared_ptr<Lexer> lexer,
+    std::shared_ptr<SourceBuffer> source, FrontEnd frontEnd, size_t threads)
+{
+    switch (frontEnd)
+    {
+        case FRONT_END_PRELEX:
+            return BasicParser<Sink>(std::make_shared<TokenStream>(lexer))
+                .parse();
+        case FRONT_END_PIPELINE:
+            return BasicParser<Sink>(std::make_shared<TokenPipeline>(lexer))
+                .parse();
+        case FRONT_END_PARALLEL:
+            return ParallelParser(source, threads).parse();
+        default:
+            return BasicParser<Sink>(lexer).parse();
+    }
+}
+
+// Writes a parsed program to an output in the format the options ask for,
+// optimizing it first if they ask for that
+static void emit(Program& program, const CompileOptions& options,
+    std::ostream& stream)
+{
+    if (options.optimize)
+        optimize(program, options.unrollFactor);
+
+    if (options.format == OUTPUT_BBC)
+        writeBbc(program, stream);
+    else
+        Generator(stream).emitProgram(program);
+}
+
+// Runs a compile once the lexer has been set up. `source` is only used by
+// the parallel front end, and may be null for streamed input. If `output` is
+// null the program is only checked, and nothing is written.
+static CompileResult run(std::shared_ptr<Lexer> lexer, 
+    std::shared_ptr<SourceBuffer> source, FrontEnd frontEnd, 
+    const CompileOptions& options, OutputSink* output)
+{
+    CompileResult result;
+    if (lexer->isEmpty())
+    {
+        result.status = COMPILE_EMPTY_INPUT;
+        return result;
+    }
+
+    std::ostream* stream = output != nullptr ? output->open() : nullptr;
+    if (output != nullptr && stream == nullptr)
+    {
+        fail(result, D_OUTPUT, "Failed to open the output");
+        return result;
+    }
+
+    try
+    {
+        // A program that is only being checked isn't built
+        std::shared_ptr<Program> program = stream != nullptr
+            ? parse<AstSink>(lexer, source, frontEnd, options.threads)
+            : parse<NullSink>(lexer, source, frontEnd, options.threads);
+
+        if (stream != nullptr)
+            emit(*program, options, *stream);
+    }
+    catch (const LexError& error)
+    {
+        fail(result, D_LEXING, error.what());
+    }
+    catch (const ParseError& error)
+    {
+        fail(result, D_PARSING, error.what(), 
+            std::string(error.token.lexeme()));
+    }
+
+    return result;
+}
+
+// Starts lexing a streamed input. The lexer reads the first chunk as soon as
+// it is made, so a failed read is recorded as a lexing error in `result`,
+// and null is returned.
+static std::shared_ptr<Lexer> startStream(int fd, CompileResult& result)
+{
+    try
+    {
+        return std::make_shared<Lexer>(fd);
+    }
+    catch (const LexError& error)
+    {
+        fail(result, D_LEXING, error.what());
+        return nullptr;
+    }
+}
+
+CompileResult compile(std::string_view source, const CompileOptions& options,
+    OutputSink& output)
+{
+    auto buffer = std::make_shared<SourceBuffer>(source);
+    return run(std::make_shared<Lexer>(buffer), buffer, options.frontEnd, 
+        options, &output);
+}
+
+CompileResult compileStream(int fd, const CompileOptions& options, 
+    OutputSink& output)
+{
+    CompileResult result;
+    std::shared_ptr<Lexer> lexer = startStream(fd, result);
+    if (lexer == nullptr)
+        return result;
+
+    return run(lexer, nullptr, FRONT_END_ON_DEMAND, options, &output);
+}
+
+CompileResult compileBbc(const char* path, const CompileOptions& options,
+    OutputSink& output)
+{
+    CompileResult result;
+    std::shared_ptr<Program> program;
+    try
+    {
+        program = loadBbc(path);
+    }
+    catch (const BbcError& error)
+    {
+        fail(result, D_FORMAT, error.what());
+        return result;
+    }
+
+    if (program == nullptr)
+    {
+        fail(result, D_INPUT, "Cannot access the input file");
+        return result;
+    }
+
+    std::ostream* stream = output.open();
+    if (stream == nullptr)
+    {
+        fail(result, D_OUTPUT, "Failed to open the output");
+        return result;
+    }
+
+    emit(*program, options, *stream);
+    return result;
+}
+
+CompileResult check(std::string_view source, const CompileOptions& options)
+{
+    auto buffer = std::make_shared<SourceBuffer>(source);
+    return run(std::make_shared<Lexer>(buffer), buffer, options.frontEnd, 
+        options, nullptr);
+}
+
+CompileResult checkStream(int fd, const CompileOptions& options)
+{
+    CompileResult result;
+    std::shared_ptr<Lexer> lexer = startStream(fd, result);
+    if (lexer == nullptr)
+        return result;
+
+    return run(lexer, nullptr, FRONT_END_ON_DEMAND, options, nullptr);
+}
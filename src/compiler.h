@@ -0,0 +1,175 @@
+/*
+File: compiler.h
+Author: Adam Thompson
+Course: CSC 407
+
+The interface to libbb, the library the compiler is built from. Programs that
+want to compile Bare Bones code without running the `bb` driver can link
+against the library and include this file.
+*/
+
+
+#ifndef __COMPILER_H__
+#define __COMPILER_H__
+
+#include <cstddef>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The ways the input can be lexed and parsed
+enum FrontEnd
+{
+    FRONT_END_ON_DEMAND,    // Lex each token as the parser needs it
+    FRONT_END_PRELEX,       // Lex the whole input before parsing
+    FRONT_END_PIPELINE,     // Lex on a separate thread while parsing
+    FRONT_END_PARALLEL,     // Parse pieces of the input on several threads
+};
+
+// What a compile writes to its output
+enum OutputFormat
+{
+    OUTPUT_C,       // C code
+    OUTPUT_BBC,     // The parsed program, in the .bbc format (see bbc.h)
+};
+
+// Options for a compile
+struct CompileOptions
+{
+    // How the input is lexed and parsed
+    FrontEnd frontEnd = FRONT_END_ON_DEMAND;
+
+    // What is written to the output
+    OutputFormat format = OUTPUT_C;
+
+    // The number of threads used by the parallel front end. A count of 0 
+    // uses one thread per hardware thread.
+    size_t threads = 0;
+
+    // Runs the optimizer over the program before it is written (see
+    // optimizer.h). A program that is only being checked isn't optimized.
+    bool optimize = false;
+
+    // The number of copies of its body each pass through a partly unrolled
+    // dotimes loop runs when optimizing. A factor of 1 turns partial
+    // unrolling off.
+    size_t unrollFactor = 4;
+};
+
+// The kinds of problems a compile can report
+enum DiagnosticKind
+{
+    D_LEXING,   // The input has an invalid token
+    D_PARSING,  // The input isn't a valid program
+    D_OUTPUT,   // The output couldn't be opened
+    D_INPUT,    // A .bbc file couldn't be read
+    D_FORMAT,   // A .bbc file is invalid
+};
+
+// A problem found while compiling
+struct Diagnostic
+{
+    DiagnosticKind kind;
+
+    // What went wrong
+    std::string message;
+
+    // The text of the token a parsing error was found on
+    std::string token;
+};
+
+// How a compile turned out
+enum CompileStatus
+{
+    COMPILE_OK,             // The output was written
+    COMPILE_EMPTY_INPUT,    // There was nothing to compile
+    COMPILE_FAILED,         // See the diagnostics
+};
+
+// The result of a compile
+struct CompileResult
+{
+    CompileStatus status = COMPILE_OK;
+
+    // The problems found. Compiling stops at the first error, so a failed
+    // compile has exactly one.
+    std::vector<Diagnostic> diagnostics;
+};
+
+/*
+An `OutputSink` is where the generated code is written. The compiler opens
+the sink once it knows the input isn't empty, before parsing starts, and only
+writes to it once the whole program has parsed.
+*/
+class OutputSink
+{
+public:
+    virtual ~OutputSink() = default;
+
+    // Opens the sink and returns the stream to write to, or nullptr if it
+    // can't be opened
+    virtual std::ostream* open() = 0;
+};
+
+// A sink that writes to a stream the caller already has open
+class StreamSink : public OutputSink
+{
+public:
+    StreamSink(std::ostream& stream) : m_stream(stream) {}
+
+    std::ostream* open() override { return &m_stream; }
+
+private:
+    std::ostream& m_stream;
+};
+
+// A sink that creates (or truncates) a file when it is opened
+class FileSink : public OutputSink
+{
+public:
+    FileSink(const std::string& path) : m_path(path) {}
+
+    std::ostream* open() override
+    {
+        m_file.open(m_path);
+        return m_file.is_open() ? &m_file : nullptr;
+    }
+
+    // Gets the path of the file
+    const std::string& path() const { return m_path; }
+
+private:
+    std::string m_path;
+    std::ofstream m_file;
+};
+
+// Compiles a program held in memory, writing the generated code to `output`.
+// The compiler keeps no state between calls, so any number of compiles can
+// run at once on different threads.
+CompileResult compile(std::string_view source, const CompileOptions& options,
+    OutputSink& output);
+
+// Compiles a program streamed from a file descriptor, such as stdin or a
+// pipe. The input is always lexed on demand, whatever front end the options
+// ask for. The descriptor isn't closed.
+CompileResult compileStream(int fd, const CompileOptions& options, 
+    OutputSink& output);
+
+// Compiles a program that was precompiled into a .bbc file. The file is
+// mapped into memory and used in place, so nothing is lexed or parsed. The
+// front end options are ignored.
+CompileResult compileBbc(const char* path, const CompileOptions& options,
+    OutputSink& output);
+
+// Checks that a program held in memory is valid, without generating any
+// code. This lexes and parses the program, and checks that every variable is
+// declared before it is used.
+CompileResult check(std::string_view source, const CompileOptions& options);
+
+// Checks that a program streamed from a file descriptor is valid, in the
+// same way as `compileStream` reads it
+CompileResult checkStream(int fd, const CompileOptions& options);
+
+#endif
@@ -0,0 +1,338 @@
+/*
+File: constant_folder.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `ConstantFolder` class.
+*/
+
+
+#include "constant_folder.h"
+
+#include <charconv>
+#include <climits>
+
+#include "optimizer.h"
+#include "token_type.h"
+
+ConstantFolder::ConstantFolder(Program& program)
+    : m_program(program), m_ast(program.ast)
+{
+}
+
+void ConstantFolder::run()
+{
+    findLoopAssigns(m_ast, m_ast.root(), m_loopAssigns);
+
+    // No variable has a known value before it is assigned
+    size_t symbols = m_program.symbols.size();
+    m_values.assign(symbols, Value{false, 0});
+    m_stamps.assign(symbols, 0);
+    m_slots.assign(symbols, 0);
+
+    m_work.push_back(WalkTask{W_STATEMENTS, m_ast.root(), 0, 0});
+    while (!m_work.empty())
+    {
+        WalkTask task = m_work.back();
+        m_work.pop_back();
+        switch (task.step)
+        {
+            case W_STATEMENTS:
+                // Leave the rest of the list for after this statement
+                if (task.id != NO_NODE)
+                {
+                    m_work.push_back(WalkTask{W_STATEMENTS,
+                        m_ast[task.id].next, 0, 0});
+                    visit(task.id);
+                }
+                break;
+            case W_IF_THEN:
+            {
+                // Put the if block's values aside and walk the else block
+                // from the values before the if
+                const Node& node = m_ast[task.id];
+                size_t thenValues = m_branchValues.size();
+                collectChanges(task.mark);
+                undo(task.mark);
+                m_work.push_back(WalkTask{W_IF_ELSE, task.id, task.mark,
+                    thenValues});
+                if (node.flags & F_HAS_ELSE)
+                    m_work.push_back(WalkTask{W_STATEMENTS, node.c, 0, 0});
+                break;
+            }
+            case W_IF_ELSE:
+                joinBranches(task);
+                m_openBlocks--;
+                break;
+            case W_LOOP:
+                // The values at the end of the body only hold for one pass
+                // through it
+                undo(task.mark);
+                m_openBlocks--;
+                break;
+        }
+    }
+}
+
+void ConstantFolder::visit(NodeId id)
+{
+    Node& node = m_ast[id];
+    switch (node.kind)
+    {
+        case N_DECLARE:
+            // A declaration without a value leaves the variable as it was
+            if (node.b != NO_NODE)
+                set(node.a, fold(node.b));
+            break;
+        case N_ASSIGN:
+            set(node.a, fold(node.b));
+            break;
+        case N_READ:
+            set(node.a, Value{false, 0});
+            break;
+        case N_PRINT:
+            for (NodeId arg = node.a; arg != NO_NODE; arg = m_ast[arg].next)
+            {
+                Node& item = m_ast[arg];
+                if (item.kind == N_VAR && m_values[item.a].known)
+                    printValue(item, m_values[item.a].value);
+            }
+            break;
+        case N_IF:
+        {
+            // Only the branch that is taken is walked when the condition is
+            // known. Otherwise both are, and their values joined.
+            Value condition = fold(node.a);
+            if (condition.known)
+            {
+                NodeId taken = NO_NODE;
+                if (condition.value != 0)
+                    taken = node.b;
+                else if (node.flags & F_HAS_ELSE)
+                    taken = node.c;
+                m_work.push_back(WalkTask{W_STATEMENTS, taken, 0, 0});
+                break;
+            }
+
+            m_openBlocks++;
+            m_work.push_back(WalkTask{W_IF_THEN, id, m_trail.size(), 0});
+            m_work.push_back(WalkTask{W_STATEMENTS, node.b, 0, 0});
+            break;
+        }
+        case N_WHILE:
+            enterLoop(id, node.a, node.b, false);
+            break;
+        case N_DOTIMES:
+            enterLoop(id, node.a, node.b, true);
+            break;
+        default:
+            break;
+    }
+}
+
+void ConstantFolder::enterLoop(NodeId id, NodeId test, NodeId body,
+    bool dotimes)
+{
+    // A loop that is known not to run on the way in never runs at all, so
+    // its test can be folded with the values from before the loop
+    Value entry = evaluate(test, false);
+    if (entry.known && (dotimes ? entry.value <= 0 : entry.value == 0))
+    {
+        fold(test);
+        return;
+    }
+
+    // Otherwise, the test runs again after every pass through the body
+    for (SymbolId symbol : m_loopAssigns[id])
+        set(symbol, Value{false, 0});
+    fold(test);
+
+    m_openBlocks++;
+    m_work.push_back(WalkTask{W_LOOP, id, m_trail.size(), 0});
+    m_work.push_back(WalkTask{W_STATEMENTS, body, 0, 0});
+}
+
+void ConstantFolder::joinBranches(const WalkTask& task)
+{
+    // Put the else block's values after the if block's, then go back to the
+    // values from before the if
+    size_t elseValues = m_branchValues.size();
+    collectChanges(task.mark);
+    undo(task.mark);
+
+    auto join = [](Value a, Value b) {
+        return a.known && b.known && a.value == b.value ? a : Value{false, 0};
+    };
+
+    // Match each variable the else block changed with its value from the
+    // if block, or from before the if if the if block didn't change it
+    uint32_t stamp = ++m_stamp;
+    for (size_t i = task.thenValues; i < elseValues; i++)
+    {
+        SymbolId symbol = m_branchValues[i].first;
+        m_stamps[symbol] = stamp;
+        m_slots[symbol] = i;
+    }
+
+    std::vector<std::pair<SymbolId, Value>> joined;
+    for (size_t i = elseValues; i < m_branchValues.size(); i++)
+    {
+        SymbolId symbol = m_branchValues[i].first;
+        Value thenValue = m_values[symbol];
+        if (m_stamps[symbol] == stamp)
+        {
+            thenValue = m_branchValues[m_slots[symbol]].second;
+            m_stamps[symbol] = 0;
+        }
+        joined.emplace_back(symbol, join(thenValue,
+            m_branchValues[i].second));
+    }
+
+    // The rest were only changed by the if block
+    for (size_t i = task.thenValues; i < elseValues; i++)
+    {
+        SymbolId symbol = m_branchValues[i].first;
+        if (m_stamps[symbol] == stamp)
+            joined.emplace_back(symbol, join(m_branchValues[i].second,
+                m_values[symbol]));
+    }
+
+    m_branchValues.resize(task.thenValues);
+    for (const auto& [symbol, value] : joined)
+        set(symbol, value);
+}
+
+ConstantFolder::Value ConstantFolder::fold(NodeId root)
+{
+    // The C compiler is free to assume that a division never fails, so an
+    // expression it can see more of might lose a division that fails. Such
+    // expressions are left as they are, so they still fail when they run.
+    Value value = evaluate(root, false);
+    if (m_mayFail)
+        return value;
+    return evaluate(root, true);
+}
+
+ConstantFolder::Value ConstantFolder::evaluate(NodeId root, bool rewrite)
+{
+    // Operands are evaluated before the operators that use them, with the
+    // values kept on a stack
+    m_mayFail = false;
+    m_expressionWork.clear();
+    m_operands.clear();
+    m_expressionWork.push_back(ExpressionTask{root, false});
+    while (!m_expressionWork.empty())
+    {
+        ExpressionTask task = m_expressionWork.back();
+        m_expressionWork.pop_back();
+
+        Node& node = m_ast[task.id];
+        if (!task.operandsDone && (node.kind == N_PAREN
+            || node.kind == N_NOT || node.kind == N_BINARY))
+        {
+            m_expressionWork.push_back(ExpressionTask{task.id, true});
+            if (node.kind == N_BINARY)
+                m_expressionWork.push_back(ExpressionTask{node.b, false});
+            m_expressionWork.push_back(ExpressionTask{node.a, false});
+            continue;
+        }
+
+        Value value{false, 0};
+        switch (node.kind)
+        {
+            case N_NUM:
+                m_operands.push_back(Value{true, static_cast<int>(node.a)});
+                continue;
+            case N_VAR:
+                value = m_values[node.a];
+                break;
+            case N_PAREN:
+                value = m_operands.back();
+                m_operands.pop_back();
+                break;
+            case N_NOT:
+                value = m_operands.back();
+                m_operands.pop_back();
+                value.value = !value.value;
+                break;
+            case N_BINARY:
+            {
+                Value right = m_operands.back();
+                m_operands.pop_back();
+                Value left = m_operands.back();
+                m_operands.pop_back();
+
+                // A division fails unless its divisor is known not to be 0,
+                // and not to be -1 when dividing the smallest int
+                if ((node.op == T_DIV || node.op == T_MOD) 
+                    && !(right.known && right.value != 0 && (right.value != -1
+                        || (left.known && left.value != INT_MIN))))
+                    m_mayFail = true;
+
+                // The right operand of `and` and `or` isn't evaluated when
+                // the left one decides the result
+                if (left.known && right.known)
+                    value.known = evaluateBinary(node.op, left.value,
+                        right.value, value.value);
+                else if (node.op == T_AND && left.known && left.value == 0)
+                    value = Value{true, 0};
+                else if (node.op == T_OR && left.known && left.value != 0)
+                    value = Value{true, 1};
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (!value.known)
+            value.value = 0;
+        else if (rewrite)
+            makeNumber(node, value.value);
+        m_operands.push_back(value);
+    }
+
+    return m_operands.back();
+}
+
+void ConstantFolder::set(SymbolId symbol, Value value)
+{
+    if (m_openBlocks > 0)
+        m_trail.emplace_back(symbol, m_values[symbol]);
+    m_values[symbol] = value;
+}
+
+void ConstantFolder::undo(size_t mark)
+{
+    while (m_trail.size() > mark)
+    {
+        m_values[m_trail.back().first] = m_trail.back().second;
+        m_trail.pop_back();
+    }
+}
+
+void ConstantFolder::collectChanges(size_t mark)
+{
+    uint32_t stamp = ++m_stamp;
+    for (size_t i = mark; i < m_trail.size(); i++)
+    {
+        SymbolId symbol = m_trail[i].first;
+        if (m_stamps[symbol] != stamp)
+        {
+            m_stamps[symbol] = stamp;
+            m_branchValues.emplace_back(symbol, m_values[symbol]);
+        }
+    }
+}
+
+void ConstantFolder::printValue(Node& node, int value)
+{
+    char digits[16];
+    std::to_chars_result result = std::to_chars(digits,
+        digits + sizeof(digits), value);
+    std::string_view text(digits, result.ptr - digits);
+
+    // The node keeps its place in the list of arguments
+    node.kind = N_STRING;
+    node.a = m_ast.addStringText(text);
+    node.b = static_cast<uint32_t>(text.size());
+}
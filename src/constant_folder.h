@@ -0,0 +1,151 @@
+/*
+File: constant_folder.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the constant folding and propagation pass.
+*/
+
+
+#ifndef __CONSTANT_FOLDER_H__
+#define __CONSTANT_FOLDER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ast.h"
+#include "symbol_table.h"
+
+/*
+The `ConstantFolder` class replaces expressions whose values are known when
+the program is compiled with those values. This covers arithmetic on
+literals, conditions of ifs and loops, the counts of dotimes loops, and
+variables that can only hold one value where they are used. A variable that
+is printed while it holds a known value becomes part of the print's text.
+
+The value of each variable is tracked as the statements are walked in the
+order they run. Where the two branches of an if meet, a variable keeps its
+value only if both branches agree on it. A variable that is assigned
+anywhere in a loop isn't known inside the loop or after it. Variables that
+are declared without a value, or read, aren't known.
+
+Nothing is folded that C leaves undefined, such as dividing by zero or
+arithmetic that overflows. Those are left for the program to do when it
+runs, and an expression with a division that may fail is left exactly as it
+was written.
+*/
+class ConstantFolder
+{
+public:
+    ConstantFolder(Program& program);
+
+    // Runs the pass
+    void run();
+
+private:
+    // What is known about a value
+    struct Value
+    {
+        bool known;
+        int value;
+    };
+
+    // The steps of work left to do while walking the statements
+    enum WalkStep : uint8_t
+    {
+        W_STATEMENTS,   // Walk the statements of a list, starting at `id`
+        W_IF_THEN,      // The if block of the if `id` has been walked
+        W_IF_ELSE,      // The else block of the if `id` has been walked
+        W_LOOP,         // The body of the loop `id` has been walked
+    };
+
+    // A single step of work
+    struct WalkTask
+    {
+        WalkStep step;
+        NodeId id;
+        size_t mark;        // The length of the trail when the block began
+        size_t thenValues;  // W_IF_ELSE: where the if block's values start
+    };
+
+    // A step of evaluating an expression
+    struct ExpressionTask
+    {
+        NodeId id;
+        bool operandsDone;
+    };
+
+    Program& m_program;
+    Ast& m_ast;
+
+    // The value of each variable at the point being walked
+    std::vector<Value> m_values;
+
+    // The earlier value of each variable that has been changed, so the
+    // changes made in a block can be undone
+    std::vector<std::pair<SymbolId, Value>> m_trail;
+
+    // The number of blocks that may be undone. Changes only need to go on
+    // the trail while there are some.
+    size_t m_openBlocks = 0;
+
+    // The values variables had at the end of if blocks whose else blocks
+    // are being walked
+    std::vector<std::pair<SymbolId, Value>> m_branchValues;
+
+    // Scratch space for matching up the variables changed by each branch
+    std::vector<uint32_t> m_stamps;
+    std::vector<size_t> m_slots;
+    uint32_t m_stamp = 0;
+
+    // The variables assigned anywhere in each loop
+    std::unordered_map<NodeId, std::vector<SymbolId>> m_loopAssigns;
+
+    // The work left to do while walking the statements
+    std::vector<WalkTask> m_work;
+
+    // The stacks used to evaluate expressions
+    std::vector<ExpressionTask> m_expressionWork;
+    std::vector<Value> m_operands;
+
+    // Set if the last expression evaluated has a division that may fail
+    bool m_mayFail = false;
+
+    // Walks a single statement
+    void visit(NodeId id);
+
+    // Walks the start of a loop. `test` is the loop's condition, or the
+    // count of a dotimes loop.
+    void enterLoop(NodeId id, NodeId test, NodeId body, bool dotimes);
+
+    // Joins the values from both branches of an if, once its else block
+    // has been walked
+    void joinBranches(const WalkTask& task);
+
+    // Gets the value of an expression and replaces every part of it that
+    // has a known value with that value
+    Value fold(NodeId root);
+
+    // Gets the value of an expression using the known values of variables.
+    // If `rewrite` is set, every part of the expression with a known value
+    // is replaced with that value.
+    Value evaluate(NodeId root, bool rewrite);
+
+    // Sets the value of a variable
+    void set(SymbolId symbol, Value value);
+
+    // Undoes the changes made since the trail had `mark` entries
+    void undo(size_t mark);
+
+    // Collects the variables changed since the trail had `mark` entries,
+    // along with their current values, into `m_branchValues`
+    void collectChanges(size_t mark);
+
+    // Replaces a variable in a print with the text of its value
+    void printValue(Node& node, int value);
+};
+
+#endif
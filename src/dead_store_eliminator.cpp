@@ -0,0 +1,391 @@
+/*
+File: dead_store_eliminator.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `DeadStoreEliminator` class.
+*/
+
+
+#include "dead_store_eliminator.h"
+
+#include <algorithm>
+
+#include "optimizer.h"
+#include "token_type.h"
+
+DeadStoreEliminator::DeadStoreEliminator(Program& program)
+    : m_program(program), m_ast(program.ast)
+{
+}
+
+void DeadStoreEliminator::run()
+{
+    findNeeded();
+    findDeadStores();
+    removeDeadStores();
+    removeUnusedSymbols();
+}
+
+void DeadStoreEliminator::findNeeded()
+{
+    size_t symbols = m_program.symbols.size();
+    m_needed.assign(symbols, false);
+    m_dependencies.assign(symbols, std::vector<SymbolId>());
+
+    // The variables found to be needed whose dependencies haven't been
+    // followed yet
+    std::vector<SymbolId> found;
+    auto need = [&](const std::vector<SymbolId>& uses) {
+        for (SymbolId symbol : uses)
+        {
+            if (!m_needed[symbol])
+            {
+                m_needed[symbol] = true;
+                found.push_back(symbol);
+            }
+        }
+    };
+
+    // The condition or count of a loop is checked before every pass, so it
+    // is used by the loop itself
+    findLoopSymbols(m_ast, m_ast.root(), m_loopUses,
+        [&](NodeId id, std::vector<SymbolId>& uses) {
+            const Node& node = m_ast[id];
+            m_uses.clear();
+            switch (node.kind)
+            {
+                case N_DECLARE:
+                case N_ASSIGN:
+                {
+                    // An assignment only needs the variables it uses if its
+                    // own variable is needed, unless it may fail
+                    if (node.b == NO_NODE)
+                        break;
+                    std::vector<SymbolId>& dependencies =
+                        m_dependencies[node.a];
+                    if (findUses(node.b))
+                        need(m_uses);
+                    else
+                        dependencies.insert(dependencies.end(),
+                            m_uses.begin(), m_uses.end());
+                    break;
+                }
+                case N_PRINT:
+                    for (NodeId arg = node.a; arg != NO_NODE;
+                        arg = m_ast[arg].next)
+                    {
+                        if (m_ast[arg].kind == N_VAR)
+                            m_uses.push_back(m_ast[arg].a);
+                    }
+                    need(m_uses);
+                    break;
+                case N_IF:
+                case N_WHILE:
+                case N_DOTIMES:
+                    findUses(node.a);
+                    need(m_uses);
+                    break;
+                default:
+                    break;
+            }
+            uses.insert(uses.end(), m_uses.begin(), m_uses.end());
+        });
+
+    // A needed variable needs every variable its assignments use
+    while (!found.empty())
+    {
+        SymbolId symbol = found.back();
+        found.pop_back();
+        need(m_dependencies[symbol]);
+    }
+}
+
+void DeadStoreEliminator::findDeadStores()
+{
+    // Nothing is live once the program ends
+    m_live.assign(m_program.symbols.size(), false);
+    m_dead.assign(m_ast.size(), false);
+    m_stamps.assign(m_program.symbols.size(), 0);
+
+    pushBlock(m_ast.root());
+    while (!m_work.empty())
+    {
+        WalkTask task = m_work.back();
+        m_work.pop_back();
+        switch (task.step)
+        {
+            case W_STATEMENT:
+                visit(task.id);
+                break;
+            case W_IF_THEN:
+            {
+                // Put aside what the if block changed and walk the else
+                // block from what is live after the if
+                const Node& node = m_ast[task.id];
+                size_t thenLive = m_branchLive.size();
+                for (size_t i = task.mark; i < m_trail.size(); i++)
+                {
+                    SymbolId symbol = m_trail[i].first;
+                    m_branchLive.push_back(std::make_pair(symbol, 
+                        static_cast<bool>(m_live[symbol])));
+                }
+                undo(task.mark);
+                m_work.push_back(WalkTask{W_IF_ELSE, task.id, task.mark,
+                    thenLive});
+                if (node.flags & F_HAS_ELSE)
+                    pushBlock(node.c);
+                break;
+            }
+            case W_IF_ELSE:
+                joinBranches(task);
+                m_openBlocks--;
+
+                // The condition is checked before either block
+                findUses(m_ast[task.id].a);
+                for (SymbolId symbol : m_uses)
+                    setLive(symbol, true);
+                break;
+            case W_LOOP:
+                // What is live before the loop is what was live at the end
+                // of its body
+                undo(task.mark);
+                m_openBlocks--;
+                break;
+        }
+    }
+}
+
+void DeadStoreEliminator::visit(NodeId id)
+{
+    const Node& node = m_ast[id];
+    switch (node.kind)
+    {
+        case N_DECLARE:
+        case N_ASSIGN:
+        {
+            // A declaration without a value doesn't assign anything
+            if (node.b == NO_NODE)
+                break;
+
+            bool mayFail = findUses(node.b);
+            if (!mayFail && (!m_needed[node.a] || !m_live[node.a]))
+            {
+                m_dead[id] = true;
+                break;
+            }
+
+            setLive(node.a, false);
+            for (SymbolId symbol : m_uses)
+                setLive(symbol, true);
+            break;
+        }
+        case N_PRINT:
+            for (NodeId arg = node.a; arg != NO_NODE; arg = m_ast[arg].next)
+            {
+                if (m_ast[arg].kind == N_VAR)
+                    setLive(m_ast[arg].a, true);
+            }
+            break;
+        case N_IF:
+            // The if block is walked first, then the else block, and the
+            // two are joined along with the condition
+            m_openBlocks++;
+            m_work.push_back(WalkTask{W_IF_THEN, id, m_trail.size(), 0});
+            pushBlock(node.b);
+            break;
+        case N_WHILE:
+        case N_DOTIMES:
+        {
+            // Anything the loop uses may be needed by a later pass through
+            // it, so it is live all the way through the loop
+            for (SymbolId symbol : m_loopUses[id])
+                setLive(symbol, true);
+            m_openBlocks++;
+            m_work.push_back(WalkTask{W_LOOP, id, m_trail.size(), 0});
+            pushBlock(node.b);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void DeadStoreEliminator::joinBranches(const WalkTask& task)
+{
+    // A variable is live before the if if it is live at the start of either
+    // block. The else block's liveness is the current one. A variable the
+    // if block didn't change is live at its start if it is live after the
+    // if, which is what the first change the else block made to it undoes.
+    m_stamp++;
+    for (size_t i = task.thenLive; i < m_branchLive.size(); i++)
+        m_stamps[m_branchLive[i].first] = m_stamp;
+
+    size_t end = m_trail.size();
+    for (size_t i = task.mark; i < end; i++)
+    {
+        SymbolId symbol = m_trail[i].first;
+        if (m_stamps[symbol] == m_stamp)
+            continue;
+        m_stamps[symbol] = m_stamp;
+        if (m_trail[i].second)
+            setLive(symbol, true);
+    }
+
+    for (size_t i = task.thenLive; i < m_branchLive.size(); i++)
+    {
+        if (m_branchLive[i].second)
+            setLive(m_branchLive[i].first, true);
+    }
+    m_branchLive.resize(task.thenLive);
+}
+
+void DeadStoreEliminator::pushBlock(NodeId first)
+{
+    for (NodeId id = first; id != NO_NODE; id = m_ast[id].next)
+        m_work.push_back(WalkTask{W_STATEMENT, id, 0, 0});
+}
+
+void DeadStoreEliminator::removeDeadStores()
+{
+    m_used.assign(m_program.symbols.size(), false);
+
+    // Each block is relinked without the statements that are removed. The
+    // nodes never move, since none are added, so links into them stay
+    // valid.
+    NodeId root = m_ast.root();
+    std::vector<NodeId*> blocks;
+    blocks.push_back(&root);
+    while (!blocks.empty())
+    {
+        NodeId* link = blocks.back();
+        blocks.pop_back();
+
+        for (NodeId id = *link; id != NO_NODE; id = m_ast[id].next)
+        {
+            Node& node = m_ast[id];
+            if (m_dead[id] || (node.kind == N_DECLARE && node.b == NO_NODE))
+                continue;
+
+            *link = id;
+            link = &node.next;
+
+            m_uses.clear();
+            switch (node.kind)
+            {
+                case N_DECLARE:
+                case N_ASSIGN:
+                    findUses(node.b);
+                    m_uses.push_back(node.a);
+                    break;
+                case N_READ:
+                    m_uses.push_back(node.a);
+                    break;
+                case N_PRINT:
+                    for (NodeId arg = node.a; arg != NO_NODE;
+                        arg = m_ast[arg].next)
+                    {
+                        if (m_ast[arg].kind == N_VAR)
+                            m_uses.push_back(m_ast[arg].a);
+                    }
+                    break;
+                case N_IF:
+                    findUses(node.a);
+                    blocks.push_back(&node.b);
+                    if (node.flags & F_HAS_ELSE)
+                        blocks.push_back(&node.c);
+                    break;
+                case N_WHILE:
+                case N_DOTIMES:
+                    findUses(node.a);
+                    blocks.push_back(&node.b);
+                    break;
+                default:
+                    break;
+            }
+
+            for (SymbolId symbol : m_uses)
+                m_used[symbol] = true;
+        }
+
+        *link = NO_NODE;
+    }
+    m_ast.setRoot(root);
+}
+
+void DeadStoreEliminator::removeUnusedSymbols()
+{
+    if (std::find(m_used.begin(), m_used.end(), false) == m_used.end())
+        return;
+
+    // Renumber the symbols in every node. Nodes that were unlinked may still
+    // refer to symbols that are gone, or were gone before this pass, but
+    // nothing reaches them any more.
+    std::vector<SymbolId> ids = m_program.symbols.retain(m_used);
+    for (NodeId id = 0; id < m_ast.size(); id++)
+    {
+        Node& node = m_ast[id];
+        bool refersToSymbol = node.kind == N_DECLARE
+            || node.kind == N_ASSIGN || node.kind == N_READ
+            || node.kind == N_VAR;
+        if (refersToSymbol && node.a < ids.size() 
+            && ids[node.a] != SymbolTable::NO_SYMBOL)
+            node.a = ids[node.a];
+    }
+}
+
+bool DeadStoreEliminator::findUses(NodeId root)
+{
+    bool mayFail = false;
+    m_uses.clear();
+    m_expressionWork.clear();
+    m_expressionWork.push_back(root);
+    while (!m_expressionWork.empty())
+    {
+        const Node& node = m_ast[m_expressionWork.back()];
+        m_expressionWork.pop_back();
+        switch (node.kind)
+        {
+            case N_VAR:
+                m_uses.push_back(node.a);
+                break;
+            case N_PAREN:
+            case N_NOT:
+                m_expressionWork.push_back(node.a);
+                break;
+            case N_BINARY:
+            {
+                m_expressionWork.push_back(node.a);
+                m_expressionWork.push_back(node.b);
+
+                // A division can only be removed if it can't fail
+                if ((node.op == T_DIV || node.op == T_MOD) 
+                    && !isSafeDivisor(m_ast, node.b))
+                    mayFail = true;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return mayFail;
+}
+
+void DeadStoreEliminator::setLive(SymbolId symbol, bool live)
+{
+    if (m_live[symbol] == live)
+        return;
+
+    if (m_openBlocks > 0)
+        m_trail.push_back(std::make_pair(symbol, !live));
+    m_live[symbol] = live;
+}
+
+void DeadStoreEliminator::undo(size_t mark)
+{
+    while (m_trail.size() > mark)
+    {
+        m_live[m_trail.back().first] = m_trail.back().second;
+        m_trail.pop_back();
+    }
+}
@@ -0,0 +1,156 @@
+/*
+File: dead_store_eliminator.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the dead store and unused variable elimination pass.
+*/
+
+
+#ifndef __DEAD_STORE_ELIMINATOR_H__
+#define __DEAD_STORE_ELIMINATOR_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ast.h"
+#include "symbol_table.h"
+
+/*
+The `DeadStoreEliminator` class removes assignments whose values are never
+seen, and the variables that are left with nothing to do. A value is seen
+when it is printed, or when it decides a condition or the count of a dotimes
+loop, either directly or through the other variables it is assigned to.
+
+This is worked out in two ways:
+
+* A variable whose value is never seen, no matter which way the program
+  runs, doesn't need any of its assignments. This catches variables that
+  only feed themselves, such as a counter that is never printed.
+* The statements are walked backwards to find which variables are live at
+  each point, meaning their values may be seen before they are assigned
+  again. An assignment to a variable that isn't live afterwards is removed.
+  A variable used anywhere in a loop is taken to be live throughout it, so
+  loops don't need to be walked more than once.
+
+Assignments with a division that may fail are kept, so the program still
+fails the same way. Reads are always kept, since they take input, but they
+don't hide the assignments before them, since a read leaves its variable
+alone once the input runs out. Once the stores are gone, declarations
+without a value are removed (they don't produce any code), and so are the
+symbols that nothing refers to any more, so they aren't declared in the
+generated code.
+*/
+class DeadStoreEliminator
+{
+public:
+    DeadStoreEliminator(Program& program);
+
+    // Runs the pass
+    void run();
+
+private:
+    // The steps of work left to do while walking the statements backwards
+    enum WalkStep : uint8_t
+    {
+        W_STATEMENT,    // Walk the statement `id`
+        W_IF_THEN,      // The if block of the if `id` has been walked
+        W_IF_ELSE,      // The else block of the if `id` has been walked
+        W_LOOP,         // The body of the loop `id` has been walked
+    };
+
+    // A single step of work
+    struct WalkTask
+    {
+        WalkStep step;
+        NodeId id;
+        size_t mark;        // The length of the trail when the block began
+        size_t thenLive;    // W_IF_ELSE: where the if block's changes start
+                            // in `m_branchLive`
+    };
+
+    Program& m_program;
+    Ast& m_ast;
+
+    // The variables whose values may be seen somewhere in the program
+    std::vector<bool> m_needed;
+
+    // The variables each variable's assignments use
+    std::vector<std::vector<SymbolId>> m_dependencies;
+
+    // The variables used anywhere in each loop, including its condition or
+    // count
+    std::unordered_map<NodeId, std::vector<SymbolId>> m_loopUses;
+
+    // The variables that are live at the point being walked
+    std::vector<bool> m_live;
+
+    // The earlier liveness of each variable that has been changed, so the
+    // changes made in a block can be undone
+    std::vector<std::pair<SymbolId, bool>> m_trail;
+
+    // The number of blocks that may be undone. Changes only need to go on
+    // the trail while there are some.
+    size_t m_openBlocks = 0;
+
+    // The liveness of the variables changed by if blocks whose else blocks
+    // are being walked
+    std::vector<std::pair<SymbolId, bool>> m_branchLive;
+
+    // Scratch space for matching up the variables changed by each branch
+    std::vector<uint32_t> m_stamps;
+    uint32_t m_stamp = 0;
+
+    // The assignments to remove, by node
+    std::vector<bool> m_dead;
+
+    // The symbols the remaining statements refer to
+    std::vector<bool> m_used;
+
+    // The work left to do while walking the statements
+    std::vector<WalkTask> m_work;
+
+    // Scratch space for finding the variables an expression uses
+    std::vector<NodeId> m_expressionWork;
+    std::vector<SymbolId> m_uses;
+
+    // Finds the variables whose values may be seen, along with the
+    // variables each loop uses
+    void findNeeded();
+
+    // Walks the statements backwards, marking the assignments whose values
+    // aren't live
+    void findDeadStores();
+
+    // Walks a single statement
+    void visit(NodeId id);
+
+    // Joins the liveness from both branches of an if, once its else block
+    // has been walked
+    void joinBranches(const WalkTask& task);
+
+    // Pushes the statements of a block so the last one is walked first
+    void pushBlock(NodeId first);
+
+    // Unlinks the assignments that were found to be dead, along with
+    // declarations without a value, and marks the symbols that are left
+    void removeDeadStores();
+
+    // Removes the symbols nothing refers to and renumbers the rest
+    void removeUnusedSymbols();
+
+    // Finds the variables an expression uses, leaving them in `m_uses`.
+    // Returns true if the expression has a division that may fail.
+    bool findUses(NodeId root);
+
+    // Marks a variable as live or not
+    void setLive(SymbolId symbol, bool live);
+
+    // Undoes the changes made since the trail had `mark` entries
+    void undo(size_t mark);
+};
+
+#endif
@@ -0,0 +1,1098 @@
+/*
+File: embedded.h
+Author: Adam Thompson
+Course: CSC 407
+
+A version of the compiler that runs entirely while a C++ program is being
+compiled, for programs that embed small, fixed Bare Bones programs. The
+program is lexed and parsed when the C++ code is compiled, and is run by an
+interpreter that the C++ compiler can inline into the code around it:
+
+    #include "embedded.h"
+
+    constexpr auto greeting = embedProgram<R"(
+        let n = 3;
+        dotimes (n) { print("hello\n"); }
+    )">();
+
+    StdioHost host;
+    runEmbedded(greeting, host);
+
+An error in an embedded program is a compile error. The error points at a
+call to `embeddedProgramError`, along with the message the compiler would
+have reported.
+
+This needs C++20, and only uses the lexer tables from the rest of the
+compiler. The lexer and parser below follow `Lexer` and `Parser` rule for
+rule, and the interpreter follows the C code the generator writes.
+*/
+
+
+#ifndef __EMBEDDED_H__
+#define __EMBEDDED_H__
+
+#if __cplusplus < 202002L
+#error "embedded.h needs C++20"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+#include "ast.h"
+#include "char_class.h"
+#include "keywords.h"
+#include "token_type.h"
+
+// Reports an error in an embedded program. This isn't constexpr, so reaching
+// it while a program is being embedded stops the build.
+inline void embeddedProgramError(const char* message)
+{
+    std::fprintf(stderr, "%s\n", message);
+}
+
+// The text of an embedded program, passed as a template argument
+template <size_t N>
+struct ProgramText
+{
+    constexpr ProgramText(const char (&literal)[N])
+    {
+        for (size_t i = 0; i < N; i++)
+            text[i] = literal[i];
+    }
+
+    constexpr std::string_view view() const
+    {
+        return std::string_view(text, N - 1);
+    }
+
+    char text[N] = {};
+};
+
+// A program that has been parsed at compile time. The nodes are laid out
+// the same as the nodes of an `Ast`, and string literals are kept with
+// their escape sequences already decoded.
+template <size_t NodeCount, size_t StringsLength, size_t SymbolCount>
+struct EmbeddedProgram
+{
+    static constexpr size_t NODES = NodeCount > 0 ? NodeCount : 1;
+    static constexpr size_t STRINGS = StringsLength > 0 ? StringsLength : 1;
+    static constexpr size_t SYMBOLS = SymbolCount > 0 ? SymbolCount : 1;
+
+    Node nodes[NODES] = {};
+    size_t nodeCount = 0;
+    NodeId root = NO_NODE;
+    char strings[STRINGS] = {};
+    size_t stringsLength = 0;
+    size_t symbolCount = 0;
+};
+
+// A token lexed at compile time. The lexeme is a span of the program text.
+struct EmbeddedToken
+{
+    TokenType type = T_UNKNOWN;
+    size_t start = 0;
+    size_t length = 0;
+    int value = 0;
+    bool overflow = false;
+};
+
+/*
+The `EmbeddedLexer` class lexes a program at compile time, the same way that
+`Lexer` does at run time.
+*/
+class EmbeddedLexer
+{
+public:
+    constexpr EmbeddedLexer(std::string_view text) : m_text(text) {}
+
+    // Gets the next token
+    constexpr EmbeddedToken next()
+    {
+        // Skip whitespace, and then a comment
+        while (at(m_pos) == ' ' || at(m_pos) == '\t' || at(m_pos) == '\r')
+            m_pos++;
+        if (at(m_pos) == '#')
+            while (at(m_pos) != '\n' && at(m_pos) != '\0')
+                m_pos++;
+
+        EmbeddedToken token;
+        token.start = m_pos;
+        token.length = 1;
+        char c = at(m_pos);
+        switch (CHAR_CLASSES[static_cast<unsigned char>(c)])
+        {
+            case C_SINGLE:
+                token.type = SINGLE_TOKENS[static_cast<unsigned char>(c)];
+                break;
+            case C_PAIR:
+                if (at(m_pos + 1) == '=')
+                {
+                    token.type = PAIR_TOKENS[static_cast<unsigned char>(c)];
+                    token.length = 2;
+                    m_pos++;
+                }
+                else
+                {
+                    token.type = SINGLE_TOKENS[static_cast<unsigned char>(c)];
+                }
+                break;
+            case C_NEWLINE:
+                token.type = T_NEWLINE;
+                break;
+            case C_END:
+                token.type = T_EOF;
+                break;
+            case C_QUOTE:
+                // A `\"` sequence doesn't end the string
+                m_pos++;
+                while (true)
+                {
+                    while (at(m_pos) != '"' && at(m_pos) != '\\'
+                        && at(m_pos) != '\0')
+                        m_pos++;
+                    if (at(m_pos) == '"')
+                        break;
+                    if (at(m_pos) == '\0')
+                        embeddedProgramError("Unterminated string literal.");
+                    if (at(m_pos + 1) == '"')
+                        m_pos++;
+                    m_pos++;
+                }
+                token.type = T_STRING;
+                token.start++;
+                token.length = m_pos - token.start;
+                break;
+            case C_DIGIT:
+            {
+                // Values that don't fit in an int are flagged and reported
+                // by the parser
+                token.type = T_NUM;
+                int64_t value = 0;
+                while (at(m_pos) >= '0' && at(m_pos) <= '9')
+                {
+                    if (!token.overflow)
+                        value = value * 10 + (at(m_pos) - '0');
+                    if (value > INT32_MAX)
+                        token.overflow = true;
+                    m_pos++;
+                }
+                m_pos--;
+                token.value = token.overflow ? 0 : static_cast<int>(value);
+                token.length = m_pos - token.start + 1;
+                break;
+            }
+            case C_ALPHA:
+                while (isAlnum(at(m_pos + 1)))
+                    m_pos++;
+                token.length = m_pos - token.start + 1;
+                token.type = lookupKeyword(m_text.substr(token.start,
+                    token.length));
+                break;
+            default:
+                token.type = T_UNKNOWN;
+                break;
+        }
+
+        m_pos++;
+        return token;
+    }
+
+private:
+    // The text being lexed
+    std::string_view m_text;
+
+    // The position of the current character
+    size_t m_pos = 0;
+
+    // Gets the character at a position, or '\0' past the end of the text
+    constexpr char at(size_t pos) const
+    {
+        return pos < m_text.size() ? m_text[pos] : '\0';
+    }
+
+    // Checks if a character can continue an identifier
+    static constexpr bool isAlnum(char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z')
+            || (c >= 'A' && c <= 'Z');
+    }
+};
+
+/*
+The `EmbeddedParser` class parses a program at compile time, the same way
+that `Parser` does at run time, with the same errors. Like `Parser` it never
+recurses; its stacks are arrays with room for one entry per character of the
+program, which bounds the number of tokens.
+*/
+template <size_t N>
+class EmbeddedParser
+{
+public:
+    // The program as it is parsed, with room for the largest possible one
+    typedef EmbeddedProgram<N, N, N> Program;
+
+    constexpr EmbeddedParser(std::string_view text, Program& program)
+        : m_text(text), m_lexer(text), m_program(program)
+    {
+        nextToken();
+    }
+
+    // Parses the whole program
+    constexpr void parse()
+    {
+        m_blocks[m_blockCount++] = BlockFrame{NO_NODE, B_PROGRAM, NO_NODE,
+            NO_NODE};
+        while (true)
+        {
+            if (m_blocks[m_blockCount - 1].part == B_PROGRAM)
+            {
+                if (m_token.type == T_EOF)
+                    break;
+            }
+            else if (m_token.type == T_RBRACE)
+            {
+                closeBlock();
+                continue;
+            }
+
+            size_t depth = m_blockCount - 1;
+            NodeId stmt = statement();
+
+            BlockFrame& block = m_blocks[depth];
+            if (block.last == NO_NODE)
+                block.first = stmt;
+            else
+                m_program.nodes[block.last].next = stmt;
+            block.last = stmt;
+        }
+
+        m_program.root = m_blocks[0].first;
+        m_program.symbolCount = m_symbolCount;
+    }
+
+private:
+    // The parts of a statement that hold a block of statements
+    enum BlockPart : uint8_t
+    {
+        B_PROGRAM,
+        B_IF,
+        B_ELSE,
+        B_BODY,
+    };
+
+    // A block that is still being parsed
+    struct BlockFrame
+    {
+        NodeId owner;
+        BlockPart part;
+        NodeId first;
+        NodeId last;
+    };
+
+    std::string_view m_text;
+    EmbeddedLexer m_lexer;
+    EmbeddedToken m_token;
+    Program& m_program;
+
+    // The name of each symbol, as a span of the text
+    size_t m_symbolStarts[N] = {};
+    size_t m_symbolLengths[N] = {};
+    size_t m_symbolCount = 0;
+
+    // The parser's stacks
+    BlockFrame m_blocks[N] = {};
+    size_t m_blockCount = 0;
+    NodeId m_operands[N] = {};
+    size_t m_operandCount = 0;
+    TokenType m_operators[N] = {};
+    size_t m_operatorCount = 0;
+
+    // Gets the text of the current token
+    constexpr std::string_view lexeme() const
+    {
+        return m_text.substr(m_token.start, m_token.length);
+    }
+
+    // Gets the next token, skipping newlines
+    constexpr void nextToken()
+    {
+        do
+        {
+            m_token = m_lexer.next();
+        } while (m_token.type == T_NEWLINE);
+    }
+
+    constexpr NodeId add(NodeKind kind, uint32_t a = 0, uint32_t b = 0,
+        uint32_t c = 0)
+    {
+        NodeId id = static_cast<NodeId>(m_program.nodeCount++);
+        m_program.nodes[id] = Node{kind, 0, 0, a, b, c, NO_NODE};
+        return id;
+    }
+
+    // Looks up the symbol for the current token
+    constexpr SymbolId find() const
+    {
+        std::string_view name = lexeme();
+        for (size_t i = 0; i < m_symbolCount; i++)
+            if (m_text.substr(m_symbolStarts[i], m_symbolLengths[i]) == name)
+                return static_cast<SymbolId>(i);
+        return SymbolTable::NO_SYMBOL;
+    }
+
+    constexpr SymbolId requireDeclared(const char* msg)
+    {
+        SymbolId symbol = find();
+        if (symbol == SymbolTable::NO_SYMBOL)
+            embeddedProgramError(msg);
+        return symbol;
+    }
+
+    constexpr SymbolId declare(const char* msg)
+    {
+        if (find() != SymbolTable::NO_SYMBOL)
+            embeddedProgramError(msg);
+        m_symbolStarts[m_symbolCount] = m_token.start;
+        m_symbolLengths[m_symbolCount] = m_token.length;
+        return static_cast<SymbolId>(m_symbolCount++);
+    }
+
+    // Checks that the current token is of a type and consumes it
+    constexpr void expect(TokenType type, const char* msg)
+    {
+        if (m_token.type != type)
+            embeddedProgramError(msg);
+        nextToken();
+    }
+
+    constexpr NodeId statement()
+    {
+        switch (m_token.type)
+        {
+            case T_LET:
+            {
+                nextToken();
+                if (m_token.type != T_IDENT)
+                    embeddedProgramError("Expected an identifier.");
+                SymbolId symbol = declare("Attempt to redclare a variable.");
+                nextToken();
+                if (m_token.type == T_EQ)
+                    return add(N_DECLARE, symbol, assignment());
+                expect(T_SEMICOLON, "Expected a ';'");
+                return add(N_DECLARE, symbol, NO_NODE);
+            }
+            case T_IF:
+            {
+                NodeId condition = header(true, "Expected a LPAREN.",
+                    "Expected an RPAREN.", "Expected a { token.");
+                NodeId node = add(N_IF, condition, NO_NODE, NO_NODE);
+                openBlock(node, B_IF);
+                return node;
+            }
+            case T_WHILE:
+            {
+                NodeId condition = header(true, "Expected a LPAREN.",
+                    "Expected a RPAREN.", "Expected a '{' token.");
+                NodeId node = add(N_WHILE, condition, NO_NODE);
+                openBlock(node, B_BODY);
+                return node;
+            }
+            case T_DOTIMES:
+            {
+                NodeId count = header(false, "Expected a LPAREN.",
+                    "Expected a RPAREN.", "Expected a '{' token.");
+                NodeId node = add(N_DOTIMES, count, NO_NODE);
+                openBlock(node, B_BODY);
+                return node;
+            }
+            case T_PRINT:
+                return output();
+            case T_READ:
+            {
+                nextToken();
+                expect(T_LPAREN, "Expected a L_PAREN.");
+                if (m_token.type != T_IDENT)
+                    embeddedProgramError("Expected an identifier to read into.");
+                SymbolId symbol = requireDeclared(
+                    "Attempt to reference an undeclared identifier.");
+                nextToken();
+                expect(T_RPAREN, "Expected a R_PAREN.");
+                expect(T_SEMICOLON, "Expected a ';'");
+                return add(N_READ, symbol);
+            }
+            case T_IDENT:
+            {
+                SymbolId symbol = requireDeclared(
+                    "Attempt to assign a value to an undeclared variable.");
+                nextToken();
+                return add(N_ASSIGN, symbol, assignment());
+            }
+            default:
+                embeddedProgramError("Invalid statement.");
+                return NO_NODE;
+        }
+    }
+
+    // Parses the `(...) {` header of an if or a loop. The parentheses hold
+    // a boolean expression, or the count of a dotimes loop.
+    constexpr NodeId header(bool condition, const char* lparen,
+        const char* rparen, const char* lbrace)
+    {
+        nextToken();
+        expect(T_LPAREN, lparen);
+
+        NodeId value = NO_NODE;
+        if (condition)
+        {
+            value = boolean_expression();
+        }
+        else
+        {
+            if (m_token.type == T_IDENT)
+                value = add(N_VAR, requireDeclared(
+                    "Attempt to reference an undeclared identifier."));
+            else if (m_token.type == T_NUM && !m_token.overflow)
+                value = add(N_NUM, static_cast<uint32_t>(m_token.value));
+            else if (m_token.type == T_NUM)
+                embeddedProgramError("Integer overflow resulted.");
+            else
+                embeddedProgramError(
+                    "Expected an identifier or literal value.");
+            nextToken();
+        }
+
+        expect(T_RPAREN, rparen);
+        if (m_token.type != T_LBRACE)
+            embeddedProgramError(lbrace);
+        return value;
+    }
+
+    constexpr void openBlock(NodeId owner, BlockPart part)
+    {
+        nextToken();
+        m_blocks[m_blockCount++] = BlockFrame{owner, part, NO_NODE, NO_NODE};
+    }
+
+    constexpr void closeBlock()
+    {
+        BlockFrame block = m_blocks[--m_blockCount];
+        nextToken();
+
+        Node& owner = m_program.nodes[block.owner];
+        if (block.part == B_ELSE)
+        {
+            owner.c = block.first;
+            return;
+        }
+
+        owner.b = block.first;
+        if (block.part == B_IF && m_token.type == T_ELSE)
+        {
+            nextToken();
+            if (m_token.type != T_LBRACE)
+                embeddedProgramError("Expected a '{' token.");
+            owner.flags |= F_HAS_ELSE;
+            openBlock(block.owner, B_ELSE);
+        }
+    }
+
+    // Parses the value of an assignment, from the '=' to the ';'
+    constexpr NodeId assignment()
+    {
+        if (m_token.type != T_EQ)
+            embeddedProgramError("Expected an '=' for the assignment.");
+        nextToken();
+        NodeId value = arithmetic_expression();
+        expect(T_SEMICOLON, "Expected a ';'");
+        return value;
+    }
+
+    constexpr NodeId output()
+    {
+        nextToken();
+        if (m_token.type != T_LPAREN)
+            embeddedProgramError("Expected L_PAREN for the call to `print`");
+        nextToken();
+
+        NodeId first = printItem();
+        NodeId last = first;
+        while (m_token.type == T_COMMA)
+        {
+            nextToken();
+            NodeId item = printItem();
+            m_program.nodes[last].next = item;
+            last = item;
+        }
+
+        expect(T_RPAREN, "Expected a R_PAREN for the call to `print`");
+        expect(T_SEMICOLON, "Expected a ';'");
+        return add(N_PRINT, first);
+    }
+
+    // Parses one of the items passed to print()
+    constexpr NodeId printItem()
+    {
+        NodeId node = NO_NODE;
+        if (m_token.type == T_IDENT)
+            node = add(N_VAR, requireDeclared(
+                "Attempt to print an undeclared variable."));
+        else if (m_token.type == T_STRING)
+            node = addString(lexeme());
+        else
+            embeddedProgramError(
+                "Expected a string literal or identifier for print().");
+        nextToken();
+        return node;
+    }
+
+    // Adds a string literal, decoding its escape sequences the way a C
+    // compiler would
+    constexpr NodeId addString(std::string_view text)
+    {
+        size_t start = m_program.stringsLength;
+        char* out = m_program.strings;
+        size_t& length = m_program.stringsLength;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            char c = text[i];
+            if (c != '\\' || i + 1 == text.size())
+            {
+                out[length++] = c;
+                continue;
+            }
+
+            c = text[++i];
+            switch (c)
+            {
+                case 'a': out[length++] = '\a'; break;
+                case 'b': out[length++] = '\b'; break;
+                case 'f': out[length++] = '\f'; break;
+                case 'n': out[length++] = '\n'; break;
+                case 'r': out[length++] = '\r'; break;
+                case 't': out[length++] = '\t'; break;
+                case 'v': out[length++] = '\v'; break;
+                case 'x':
+                {
+                    unsigned value = 0;
+                    while (i + 1 < text.size() && hexDigit(text[i + 1]) >= 0)
+                        value = value * 16 + hexDigit(text[++i]);
+                    out[length++] = static_cast<char>(value);
+                    break;
+                }
+                default:
+                    if (c >= '0' && c <= '7')
+                    {
+                        unsigned value = c - '0';
+                        for (int digits = 1; digits < 3 && i + 1 < text.size()
+                            && text[i + 1] >= '0' && text[i + 1] <= '7';
+                            digits++)
+                            value = value * 8 + (text[++i] - '0');
+                        out[length++] = static_cast<char>(value);
+                    }
+                    else
+                    {
+                        // \\, \", \' and \? are the character itself
+                        out[length++] = c;
+                    }
+                    break;
+            }
+        }
+
+        return add(N_STRING, static_cast<uint32_t>(start),
+            static_cast<uint32_t>(length - start));
+    }
+
+    static constexpr int hexDigit(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    constexpr NodeId numeric_value()
+    {
+        if (m_token.type != T_NUM)
+            embeddedProgramError("Expected a numeric value.");
+        if (m_token.overflow)
+            embeddedProgramError("Integer overflow resulted.");
+        NodeId node = add(N_NUM, static_cast<uint32_t>(m_token.value));
+        nextToken();
+        return node;
+    }
+
+    constexpr NodeId factor()
+    {
+        if (m_token.type == T_NUM)
+            return numeric_value();
+        if (m_token.type != T_IDENT)
+            embeddedProgramError("Malformed arithmetic expression.");
+        NodeId node = add(N_VAR, requireDeclared("Variable does not exist."));
+        nextToken();
+        return node;
+    }
+
+    constexpr NodeId arithmetic_expression()
+    {
+        size_t base = m_operatorCount;
+        size_t openParens = 0;
+        while (true)
+        {
+            while (m_token.type == T_LPAREN)
+            {
+                m_operators[m_operatorCount++] = T_LPAREN;
+                ++openParens;
+                nextToken();
+            }
+
+            m_operands[m_operandCount++] = factor();
+
+            while (openParens > 0 && m_token.type == T_RPAREN)
+            {
+                reduceWhile(base, 0);
+                closeParen();
+                --openParens;
+                nextToken();
+            }
+
+            int precedence = 0;
+            if (m_token.type == T_PLUS || m_token.type == T_MINUS)
+                precedence = 1;
+            else if (m_token.type == T_MUL || m_token.type == T_DIV
+                || m_token.type == T_MOD)
+                precedence = 2;
+            else
+                break;
+
+            reduceWhile(base, precedence);
+            m_operators[m_operatorCount++] = m_token.type;
+            nextToken();
+        }
+
+        if (openParens > 0)
+            embeddedProgramError("Expected a R_PAREN");
+
+        reduceWhile(base, 0);
+        return m_operands[--m_operandCount];
+    }
+
+    constexpr NodeId boolean_expression()
+    {
+        size_t base = m_operatorCount;
+        size_t openParens = 0;
+        while (true)
+        {
+            while (m_token.type == T_NOT || m_token.type == T_LPAREN)
+            {
+                if (m_token.type == T_LPAREN)
+                    ++openParens;
+                m_operators[m_operatorCount++] = m_token.type;
+                nextToken();
+            }
+
+            if (m_token.type == T_IDENT)
+            {
+                m_operands[m_operandCount++] = add(N_VAR, requireDeclared(
+                    "Attempt to reference an undeclared identifier."));
+                nextToken();
+            }
+            else if (m_token.type == T_NUM)
+            {
+                m_operands[m_operandCount++] = numeric_value();
+            }
+            else
+            {
+                embeddedProgramError(
+                    "Unexpected token encountered in boolean expression.");
+            }
+            applyNots(base);
+
+            while (openParens > 0 && m_token.type == T_RPAREN)
+            {
+                reduceWhile(base, 0);
+                closeParen();
+                --openParens;
+                nextToken();
+                applyNots(base);
+            }
+
+            // A second comparison ends the expression, as it does in `Parser`
+            int precedence = 0;
+            if (isComparisonOp(m_token.type))
+            {
+                if (m_operatorCount > base
+                    && isComparisonOp(m_operators[m_operatorCount - 1]))
+                    break;
+                precedence = 3;
+            }
+            else if (m_token.type == T_AND)
+            {
+                precedence = 2;
+            }
+            else if (m_token.type == T_OR)
+            {
+                precedence = 1;
+            }
+            else
+            {
+                break;
+            }
+
+            reduceWhile(base, precedence);
+            m_operators[m_operatorCount++] = m_token.type;
+            nextToken();
+        }
+
+        if (openParens > 0)
+            embeddedProgramError("Expected a RPAREN.");
+
+        reduceWhile(base, 0);
+        return m_operands[--m_operandCount];
+    }
+
+    // Gets how tightly a binary operator binds. Markers don't bind at all.
+    static constexpr int precedenceOf(TokenType op)
+    {
+        switch (op)
+        {
+            case T_OR: return 1;
+            case T_AND: return 2;
+            case T_PLUS: case T_MINUS: return 1;
+            case T_MUL: case T_DIV: case T_MOD: return 2;
+            default: return isComparisonOp(op) ? 3 : -1;
+        }
+    }
+
+    constexpr void reduceWhile(size_t base, int precedence)
+    {
+        while (m_operatorCount > base
+            && precedenceOf(m_operators[m_operatorCount - 1]) >= precedence)
+        {
+            TokenType op = m_operators[--m_operatorCount];
+            NodeId right = m_operands[--m_operandCount];
+            NodeId left = m_operands[m_operandCount - 1];
+            NodeId node = add(N_BINARY, left, right);
+            m_program.nodes[node].op = static_cast<int16_t>(op);
+            m_operands[m_operandCount - 1] = node;
+        }
+    }
+
+    constexpr void closeParen()
+    {
+        m_operatorCount--;
+        m_operands[m_operandCount - 1] = add(N_PAREN,
+            m_operands[m_operandCount - 1]);
+    }
+
+    constexpr void applyNots(size_t base)
+    {
+        while (m_operatorCount > base
+            && m_operators[m_operatorCount - 1] == T_NOT)
+        {
+            m_operatorCount--;
+            m_operands[m_operandCount - 1] = add(N_NOT,
+                m_operands[m_operandCount - 1]);
+        }
+    }
+};
+
+// The sizes of an embedded program
+struct EmbeddedSizes
+{
+    size_t nodes;
+    size_t strings;
+    size_t symbols;
+};
+
+// Parses a program with room for the largest one its text could hold, and
+// gets the sizes it really needs
+template <ProgramText Text>
+consteval EmbeddedSizes measureProgram()
+{
+    constexpr size_t N = sizeof(Text.text);
+    typename EmbeddedParser<N>::Program program;
+    EmbeddedParser<N>(Text.view(), program).parse();
+    return EmbeddedSizes{program.nodeCount, program.stringsLength,
+        program.symbolCount};
+}
+
+// Lexes and parses a program at compile time. The program is checked the
+// same way the compiler checks it, and any error stops the build.
+template <ProgramText Text>
+consteval auto embedProgram()
+{
+    constexpr size_t N = sizeof(Text.text);
+    constexpr EmbeddedSizes sizes = measureProgram<Text>();
+
+    typename EmbeddedParser<N>::Program parsed;
+    EmbeddedParser<N>(Text.view(), parsed).parse();
+
+    EmbeddedProgram<sizes.nodes, sizes.strings, sizes.symbols> program;
+    for (size_t i = 0; i < sizes.nodes; i++)
+        program.nodes[i] = parsed.nodes[i];
+    for (size_t i = 0; i < sizes.strings; i++)
+        program.strings[i] = parsed.strings[i];
+    program.nodeCount = sizes.nodes;
+    program.stringsLength = sizes.strings;
+    program.symbolCount = sizes.symbols;
+    program.root = parsed.root;
+    return program;
+}
+
+// A host that runs an embedded program's I/O through stdio, the same as the
+// generated C code does. A host is anything with these three methods, and
+// may be constexpr so a program can be run at compile time.
+struct StdioHost
+{
+    // Prints text from a string literal
+    void print(std::string_view text)
+    {
+        std::fwrite(text.data(), 1, text.size(), stdout);
+    }
+
+    // Prints the value of a variable
+    void print(int value) { std::printf("%d", value); }
+
+    // Reads a value into a variable. Returns false, leaving the variable
+    // alone, if no value could be read.
+    bool read(int& value) { return std::scanf("%d", &value) == 1; }
+};
+
+/*
+The `EmbeddedInterpreter` class runs an embedded program. It never recurses:
+the loops and blocks being run, and the expressions being evaluated, are
+kept on stacks sized for the program. Values follow the generated C code,
+except that variables start at 0 and arithmetic that overflows wraps around.
+*/
+template <typename Program, typename Host>
+class EmbeddedInterpreter
+{
+public:
+    constexpr EmbeddedInterpreter(const Program& program, Host& host)
+        : m_program(program), m_host(host) {}
+
+    // Runs the whole program
+    constexpr void run()
+    {
+        m_frames[m_frameCount++] = Frame{NO_NODE, m_program.root, 0};
+        while (m_frameCount > 0)
+        {
+            Frame& frame = m_frames[m_frameCount - 1];
+            if (frame.next == NO_NODE)
+            {
+                // The end of a block. A loop goes around again if it can.
+                if (frame.loop == NO_NODE || !repeat(frame))
+                    m_frameCount--;
+                continue;
+            }
+
+            NodeId id = frame.next;
+            frame.next = m_program.nodes[id].next;
+            execute(id);
+        }
+    }
+
+    // Gets the value of a variable
+    constexpr int variable(SymbolId symbol) const { return m_variables[symbol]; }
+
+private:
+    // A block being run. `loop` is the while or dotimes the block is the body
+    // of, or NO_NODE.
+    struct Frame
+    {
+        NodeId loop;
+        NodeId next;
+        int counter;
+    };
+
+    // A step of evaluating an expression
+    struct Task
+    {
+        NodeId id;
+        bool operandsDone;
+    };
+
+    const Program& m_program;
+    Host& m_host;
+    int m_variables[Program::SYMBOLS] = {};
+    Frame m_frames[Program::NODES + 1] = {};
+    size_t m_frameCount = 0;
+    Task m_tasks[2 * Program::NODES] = {};
+    int m_values[Program::NODES] = {};
+
+    // Runs a single statement
+    constexpr void execute(NodeId id)
+    {
+        const Node& node = m_program.nodes[id];
+        switch (node.kind)
+        {
+            case N_DECLARE:
+                if (node.b != NO_NODE)
+                    m_variables[node.a] = evaluate(node.b);
+                break;
+            case N_ASSIGN:
+                m_variables[node.a] = evaluate(node.b);
+                break;
+            case N_IF:
+                if (evaluate(node.a))
+                    m_frames[m_frameCount++] = Frame{NO_NODE, node.b, 0};
+                else if (node.flags & F_HAS_ELSE)
+                    m_frames[m_frameCount++] = Frame{NO_NODE, node.c, 0};
+                break;
+            case N_WHILE:
+                if (evaluate(node.a))
+                    m_frames[m_frameCount++] = Frame{id, node.b, 0};
+                break;
+            case N_DOTIMES:
+                if (0 < evaluate(node.a))
+                    m_frames[m_frameCount++] = Frame{id, node.b, 0};
+                break;
+            case N_PRINT:
+                print(node.a);
+                break;
+            case N_READ:
+            {
+                int value = m_variables[node.a];
+                if (m_host.read(value))
+                    m_variables[node.a] = value;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // Checks if a loop should run its body again, and restarts it if so
+    constexpr bool repeat(Frame& frame)
+    {
+        const Node& loop = m_program.nodes[frame.loop];
+        if (loop.kind == N_DOTIMES)
+        {
+            // The count is checked on every pass, as the C for loop does
+            if (++frame.counter >= evaluate(loop.a))
+                return false;
+        }
+        else if (!evaluate(loop.a))
+        {
+            return false;
+        }
+
+        frame.next = loop.b;
+        return true;
+    }
+
+    // Prints the arguments of a print(). The arguments form a printf format
+    // string, so a '\0' in a string literal ends the output there.
+    constexpr void print(NodeId first)
+    {
+        for (NodeId id = first; id != NO_NODE; id = m_program.nodes[id].next)
+        {
+            const Node& node = m_program.nodes[id];
+            if (node.kind == N_VAR)
+            {
+                m_host.print(m_variables[node.a]);
+                continue;
+            }
+
+            std::string_view text(m_program.strings + node.a, node.b);
+            size_t end = text.find('\0');
+            m_host.print(text.substr(0, end));
+            if (end != std::string_view::npos)
+                return;
+        }
+    }
+
+    // Evaluates an expression. Operands are evaluated before the operator
+    // that uses them, with the work kept on a stack.
+    constexpr int evaluate(NodeId root)
+    {
+        size_t taskCount = 0;
+        size_t valueCount = 0;
+        m_tasks[taskCount++] = Task{root, false};
+        while (taskCount > 0)
+        {
+            Task task = m_tasks[--taskCount];
+            const Node& node = m_program.nodes[task.id];
+            switch (node.kind)
+            {
+                case N_NUM:
+                    m_values[valueCount++] = static_cast<int>(node.a);
+                    break;
+                case N_VAR:
+                    m_values[valueCount++] = m_variables[node.a];
+                    break;
+                case N_PAREN:
+                    m_tasks[taskCount++] = Task{node.a, false};
+                    break;
+                case N_NOT:
+                    if (task.operandsDone)
+                    {
+                        m_values[valueCount - 1] = !m_values[valueCount - 1];
+                    }
+                    else
+                    {
+                        m_tasks[taskCount++] = Task{task.id, true};
+                        m_tasks[taskCount++] = Task{node.a, false};
+                    }
+                    break;
+                case N_BINARY:
+                    if (task.operandsDone)
+                    {
+                        int right = m_values[--valueCount];
+                        int& left = m_values[valueCount - 1];
+                        left = apply(node.op, left, right);
+                    }
+                    else
+                    {
+                        m_tasks[taskCount++] = Task{task.id, true};
+                        m_tasks[taskCount++] = Task{node.b, false};
+                        m_tasks[taskCount++] = Task{node.a, false};
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        return m_values[0];
+    }
+
+    // Applies a binary operator
+    static constexpr int apply(int op, int left, int right)
+    {
+        // Wrap around rather than overflow
+        uint32_t l = static_cast<uint32_t>(left);
+        uint32_t r = static_cast<uint32_t>(right);
+        switch (op)
+        {
+            case T_PLUS: return static_cast<int>(l + r);
+            case T_MINUS: return static_cast<int>(l - r);
+            case T_MUL: return static_cast<int>(l * r);
+            case T_DIV: return left / right;
+            case T_MOD: return left % right;
+            case T_EQEQ: return left == right;
+            case T_NEQ: return left != right;
+            case T_LT: return left < right;
+            case T_GT: return left > right;
+            case T_LTEQ: return left <= right;
+            case T_GTEQ: return left >= right;
+            case T_AND: return left && right;
+            case T_OR: return left || right;
+            default: return 0;
+        }
+    }
+};
+
+// Runs an embedded program, with its I/O going through a host. This is
+// constexpr, so with a constexpr host a program can be run at compile time.
+template <typename Program, typename Host>
+constexpr void runEmbedded(const Program& program, Host& host)
+{
+    EmbeddedInterpreter<Program, Host>(program, host).run();
+}
+
+#endif
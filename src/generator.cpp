@@ -9,268 +9,544 @@ Contains the implementation for the `Generator` class.
 
 #include "generator.h"
 
-#include <cstdlib>
-#include <iostream>
+#include <charconv>
+#include <climits>
 
 #include "token_type.h"
 
-Generator::Generator(const char* path)
+Generator::Generator(std::ostream& output) : m_output(output)
 {
-    // Open the output file
-    m_file.open(path);
-    if (!m_file.is_open())
-    {
-        // Failed to create the output file
-        std::cerr << "Failed to open the output " << path << std::endl;
-        std::cerr << "Aborting..." << std::endl;
-        exit(-1);
-    }   
 }
 
-Generator::~Generator()
+void Generator::emitProgram(const Program& program)
 {
-    // Close the output file
-    m_file.close();
-}
+    // Walk the program and build up the lines of output
+    m_program = &program;
+    emitStatements(program.ast.root());
 
-void Generator::emitProgram(const std::vector<std::string>& identifierMap)
-{
     // Start by writing the necessary includes
-    m_file << "#include <stdio.h>\n";
+    m_output << "#include <stdio.h>\n";
     pprint_fileLineEnd();
 
     // Start the main entry point using its standard C signature
-    m_file << "int main(void) {";
+    m_output << "int main(void) {";
     pprint_fileLineEndStart();
 
     // Initialize the identifiers
-    emitInitializations(identifierMap);
+    emitInitializations(program.symbols);
 
     // Emit the remaining lines of the program
     emitOutput();
 
     // Finish main with a successful exit status
     pprint_fileLineStart();
-    m_file << "return 0;";
+    m_output << "return 0;";
     pprint_fileLineEnd();
 
     // Close main
-    m_file << "}";
+    m_output << "}";
 
-    // Ensure the changes get flushed to disk
-    m_file.flush();
+    // Ensure the changes get flushed to the output
+    m_output.flush();
 }
 
 void Generator::emitOutput()
 {
-    // Iterate over the lines and emit them to disk
-    for (int i=0; i < m_lines.size(); i++)
-    {
-        m_file << m_lines[i];
-    }
+    // Emit the buffered lines to disk
+    m_output << m_lines;
 }
 
-void Generator::emitInitializations(const std::vector<std::string> identifierMap)
+void Generator::emitInitializations(const SymbolTable& symbols)
 {
-    // Iterate over all of the identifiers and declare them in the output
-    for (int i=0; i < identifierMap.size(); i++)
+    // Iterate over all of the symbols, in the order they were declared, and
+    // declare them in the output
+    for (SymbolId id = 0; id < symbols.size(); id++)
     {
         pprint_fileLineStart();
-        m_file << "int " << identifierMap[i] << ";";
+        m_output << "int " << symbols.name(id) << ";";
         pprint_fileLineEnd();
     }
 
     pprint_fileLineEnd();
 }
 
-void Generator::emitPrint(const std::string& str, const std::vector<std::string>& idents)
+void Generator::emitStatements(NodeId first)
+{
+    push(W_STATEMENTS, first);
+    while (!m_work.empty())
+    {
+        WalkTask task = m_work.back();
+        m_work.pop_back();
+        runStep(task);
+    }
+}
+
+void Generator::runStep(const WalkTask& task)
+{
+    switch (task.step)
+    {
+        case W_STATEMENTS:
+            // Leave the rest of the list for after this statement
+            if (task.id != NO_NODE)
+            {
+                push(W_STATEMENTS, m_program->ast[task.id].next);
+                emitStatement(task.id);
+            }
+            break;
+        case W_BLOCK:
+            emitBlock(task.id);
+            break;
+        case W_BLOCK_END:
+            emitBlockEnd();
+            break;
+        case W_ELSE:
+            emit("else");
+            pprint_space();
+            emitBlock(task.id);
+            break;
+        case W_LINE_END:
+            emitLineEnd();
+            break;
+        case W_TEXT:
+            emitTight(task.text);
+            break;
+        case W_OPERATOR:
+            emitOperator(task.op);
+            break;
+        case W_EXPRESSION:
+            emitExpression(task.id);
+            break;
+        case W_OPERAND:
+            emitOperand(task.id, task.op, task.right);
+            break;
+        case W_CONDITION:
+            emitCondition(task.id);
+            break;
+        case W_OR_TERMS:
+            emitOrTerms(task.id);
+            break;
+        case W_AND_LEVEL:
+            emitAndLevel(task.id);
+            break;
+        case W_AND_TERMS:
+            emitAndTerms(task.id);
+            break;
+        case W_COMPARISON:
+            emitComparison(task.id);
+            break;
+        case W_PRIMARY:
+            emitBooleanPrimary(task.id);
+            break;
+    }
+}
+
+void Generator::emitStatement(NodeId id)
+{
+    const Node& node = m_program->ast[id];
+    switch (node.kind)
+    {
+        case N_DECLARE:
+            // Every variable is declared at the start of main, so only a
+            // declaration with a value produces any code here
+            if (node.b != NO_NODE)
+                emitAssignment(node.a, node.b);
+            break;
+        case N_ASSIGN:
+            emitAssignment(node.a, node.b);
+            break;
+        case N_IF:
+            emit("if");
+            pprint_space();
+            emitTight("(");
+            if (node.flags & F_HAS_ELSE)
+                push(W_ELSE, node.c);
+            push(W_BLOCK, node.b);
+            pushText(")");
+            push(W_CONDITION, node.a);
+            break;
+        case N_WHILE:
+            emit("while");
+            pprint_space();
+            emitTight("(");
+            push(W_BLOCK, node.b);
+            pushText(")");
+            push(W_CONDITION, node.a);
+            break;
+        case N_DOTIMES:
+            emitDoTimes(node.a);
+            push(W_BLOCK, node.b);
+            break;
+        case N_PRINT:
+            // Our print() is implemented with printf
+            emit("printf");
+            emitTight("(");
+            emitPrint(node.a);
+            emitTight(")");
+            emitLineEnd();
+            break;
+        case N_READ:
+            emitRead(node.a);
+            break;
+        default:
+            break;
+    }
+}
+
+void Generator::emitBlock(NodeId first)
+{
+    emitBlockStart();
+    push(W_BLOCK_END);
+    push(W_STATEMENTS, first);
+}
+
+void Generator::emitAssignment(SymbolId symbol, NodeId value)
+{
+    emit(name(symbol));
+    emitOperator(T_EQ);
+    push(W_LINE_END);
+    push(W_EXPRESSION, value);
+}
+
+void Generator::emitPrint(NodeId first)
 {
-    std::stringstream ss;
+    // Build the format string and the list of variables to print. String
+    // literals become part of the format string. Escape any user-provided
+    // '%' so it remains literal text rather than introducing a conversion
+    // that has no corresponding argument. The format specifier for a 
+    // variable is extremely simple since our language only deals with 
+    // integers.
+    std::string ss;
+    std::vector<SymbolId> idents;
+
     // Start by pushing the opening/closing `"` and the print string to the output
-    ss << "\"";
-    ss << str;
-    ss << "\"";
+    ss += '"';
+    for (NodeId id = first; id != NO_NODE; id = m_program->ast[id].next)
+    {
+        const Node& node = m_program->ast[id];
+        if (node.kind == N_STRING)
+        {
+            for (char character : m_program->ast.string(id))
+            {
+                if (character == '%')
+                    ss += "%%";
+                else
+                    ss += character;
+            }
+        }
+        else
+        {
+            ss += "%d";
+            idents.push_back(node.a);
+        }
+    }
+    ss += '"';
     
     // Next, append the identifiers
-    for (int i=0; i < idents.size(); i++)
+    for (size_t i=0; i < idents.size(); i++)
     {
         // The first identifer needs a comma prepended
         if (i == 0)
-            ss << ',';
+            ss += ',';
 
 #ifdef PRETTY_PRINT
-            ss << ' ';
+            ss += ' ';
 #endif
 
-        ss << idents[i];
+        ss += name(idents[i]);
 
         // Append a comma on all except the last identifier
         if (i < idents.size() - 1)
 #ifdef PRETTY_PRINT
-            ss << ", ";
+            ss += ", ";
 #else
-            ss << ',';
+            ss += ',';
 #endif
     }
 
     // Emit the output
-    emitTight(ss.str().c_str());
+    emitTight(ss);
 }
 
-void Generator::emitDoTimes(Token token)
+void Generator::emitDoTimes(NodeId count)
 {
     // Output the start of the resulting for loop
     pprint_lineStart();
 
-    m_line << "for (int i_dotimes_loop_counter_var=0; i_dotimes_loop_counter_var<";
-    m_line << token.lexeme();
-    m_line << "; i_dotimes_loop_counter_var++)"; 
+    m_line += "for (int i_dotimes_loop_counter_var=0; i_dotimes_loop_counter_var<";
+    const Node& node = m_program->ast[count];
+    if (node.kind == N_VAR)
+        m_line += name(node.a);
+    else
+        emitNumber(static_cast<int>(node.a));
+    m_line += "; i_dotimes_loop_counter_var++)"; 
 }
 
-void Generator::emitRead(Token identifier)
+void Generator::emitRead(SymbolId symbol)
 {
     pprint_lineStart();
 
-    m_line << "scanf(\"%d\", &";
-    m_line << identifier.lexeme();
-    m_line << ");";
+    m_line += "scanf(\"%d\", &";
+    m_line += name(symbol);
+    m_line += ");";
     pprint_lineEnd();
     flushLine(true);
 }
 
-void Generator::emit(const char* sequence)
+void Generator::emitExpression(NodeId id)
 {
-    pprint_lineStart();
-
-    // Write the output
-    m_line << sequence;
-    m_startOfLine = false;
+    const Node& node = m_program->ast[id];
+    switch (node.kind)
+    {
+        case N_NUM:
+            emitNumber(static_cast<int>(node.a));
+            break;
+        case N_VAR:
+            emit(name(node.a));
+            break;
+        case N_PAREN:
+            emitTight("(");
+            pushText(")");
+            push(W_EXPRESSION, node.a);
+            break;
+        case N_BINARY:
+            if (isArithmeticOp(node.op))
+            {
+                push(W_OPERAND, node.b, node.op, true);
+                push(W_OPERATOR, NO_NODE, node.op);
+                push(W_OPERAND, node.a, node.op, false);
+                break;
+            }
+            // Fall through, a boolean operator is treated as a condition
+            [[fallthrough]];
+        default:
+            // A condition used as a value is 1 when it is true and 0 when it
+            // is false, the same as in C
+            emitTight("(");
+            pushText(")");
+            push(W_CONDITION, id);
+            break;
+    }
 }
 
-void Generator::emitTight(const char* sequence)
+// Gets the precedence of an arithmetic operator in C. Higher binds tighter.
+static int precedence(int op)
 {
-    m_line << sequence;
+    switch (op)
+    {
+        case T_BITAND: return 0;
+        case T_SHL:
+        case T_SHR: return 1;
+        case T_PLUS:
+        case T_MINUS: return 2;
+        default: return 3;
+    }
 }
 
-void Generator::emitBlockStart()
+void Generator::emitOperand(NodeId id, int parentOp, bool right)
 {
-    pprint_space();
-    m_line << "{";
+    // The parser builds operators with the same precedence and grouping as
+    // C, so its trees never need extra parentheses. Trees that have been
+    // rewritten might, such as a right operand with the same precedence
+    // as its parent.
+    const Node& node = m_program->ast[id];
+    bool wrap = node.kind == N_BINARY && isArithmeticOp(node.op)
+        && (precedence(node.op) < precedence(parentOp) 
+            || (right && precedence(node.op) == precedence(parentOp)));
+
+    if (wrap)
+    {
+        emitTight("(");
+        pushText(")");
+        push(W_EXPRESSION, id);
+    }
+    else
+    {
+        emitExpression(id);
+    }
+}
 
-#ifdef PRETTY_PRINT
-    // The pretty print option is enabled in `bb.h`, add a newline for easier
-    // output debugging
-    m_line << "\n";
-    m_indentLevel++;
-    m_startOfLine = true;
-    flushLine(false);
-#endif
-}   
+void Generator::emitCondition(NodeId id)
+{
+    // Make the parsed precedence explicit in the generated C output.
+    emitTight("(");
+    pushText(")");
+    push(W_OR_TERMS, id);
+}
 
-void Generator::emitBlockEnd()
+void Generator::emitOrTerms(NodeId id)
 {
-    pprint_lineStartEnd();
-    m_line << "}";
-    pprint_lineEnd();
-    flushLine(false);
+    const Node& node = m_program->ast[id];
+    if (node.kind == N_BINARY && node.op == T_OR)
+    {
+        push(W_AND_LEVEL, node.b);
+        push(W_OPERATOR, NO_NODE, T_OR);
+        push(W_OR_TERMS, node.a);
+    }
+    else
+    {
+        emitAndLevel(id);
+    }
 }
 
-void Generator::emitLineEnd()
+void Generator::emitAndLevel(NodeId id)
 {
-    m_line << ";";
-    pprint_lineEndStart();
-    flushLine(false);
+    emitTight("(");
+    pushText(")");
+    push(W_AND_TERMS, id);
 }
 
-void Generator::emitToken(Token token)
+void Generator::emitAndTerms(NodeId id)
 {
-    if (Token::isKeyword(token))
+    const Node& node = m_program->ast[id];
+    if (node.kind == N_BINARY && node.op == T_AND)
     {
-        // Emit a keyword to the output
-        emitKeyword(token);
+        push(W_COMPARISON, node.b);
+        push(W_OPERATOR, NO_NODE, T_AND);
+        push(W_AND_TERMS, node.a);
     }
-    else if (Token::isKind(token, T_IDENT))
+    else
     {
-        // Emit an identifier to the output
-        emit(token.lexeme().c_str());
-    } 
-    else if (Token::isArithmeticOperator(token)
-        || Token::isAssignmentOperator(token))
-    {
-        // Emit an operator to the output
-        emitOperator(token);
-    } 
-    else if (Token::isComparisonOperator(token)
-        || Token::isLogicalOperator(token))
-    {
-        pprint_space();
-
-        if (Token::isKind(token, T_AND))
-            emit("&&");
-        else if (Token::isKind(token, T_OR))
-            emit("||");
-        else
-            emit(token.lexeme().c_str());
+        emitComparison(id);
+    }
+}
 
-        pprint_space();
+void Generator::emitComparison(NodeId id)
+{
+    const Node& node = m_program->ast[id];
+    if (node.kind == N_BINARY && isComparisonOp(node.op))
+    {
+        push(W_PRIMARY, node.b);
+        push(W_OPERATOR, NO_NODE, node.op);
+        push(W_PRIMARY, node.a);
     }
-    else 
+    else
     {
-        if (Token::isKind(token, T_LPAREN) 
-            || Token::isKind(token, T_RPAREN))
-        {
-            // Keep the output a bit more clean
-            emitTight(token.lexeme().c_str());
-        }
-        else
-        {
-            // Just write the token as-is
-            emitTight(token.lexeme().c_str());
-        }
+        emitBooleanPrimary(id);
     }
 }
 
-void Generator::emitKeyword(Token token)
+void Generator::emitBooleanPrimary(NodeId id)
 {
-    switch (token.type())
+    const Node& node = m_program->ast[id];
+    switch (node.kind)
     {
-        // Most of the keywords can be written as-is as they are the same as
-        // they are in our output language (C).
-        case T_IF:
-        case T_ELSE:
-        case T_WHILE:
-            emit(token.lexeme().c_str());
-            pprint_space();
+        case N_NOT:
+            emitTight("!");
+            push(W_PRIMARY, node.a);
             break;
-        // A few need special treatment, however
-        case T_LET:
-            // In the case of our simple language, the only data type is `int`,
-            // so this is a very easy case to implement
-            emit("int");
+        case N_PAREN:
+        {
+            const Node& inner = m_program->ast[node.a];
+            emitTight("(");
+            pushText(")");
+            if (inner.kind == N_BINARY && isArithmeticOp(inner.op))
+                push(W_EXPRESSION, node.a);
+            else
+                push(W_CONDITION, node.a);
             break;
-        case T_PRINT:
-            // Handles the print keyword
-            emit("printf");
+        }
+        case N_VAR:
+            emit(name(node.a));
+            break;
+        case N_NUM:
+            emitNumber(static_cast<int>(node.a));
+            break;
+        default:
+            // Anything else is kept together with parentheses
+            emitTight("(");
+            pushText(")");
+            if (node.kind == N_BINARY && isArithmeticOp(node.op))
+                push(W_EXPRESSION, id);
+            else
+                push(W_CONDITION, id);
             break;
     }
 }
 
-void Generator::emitOperator(Token token)
+void Generator::emitNumber(int value)
 {
-     switch (token.type())
-     {
-        // Handle the operators that are identical to those in C
-        default:
-           pprint_space();
-           emit(token.lexeme().c_str()); 
-           pprint_space();
-     }
+    // A negative value is wrapped in parentheses so it can't merge with an
+    // operator before it. The smallest int can't be written as a literal in
+    // C, since the literal without its sign doesn't fit in an int.
+    if (value == INT_MIN)
+    {
+        emitTight("(-2147483647 - 1)");
+        return;
+    }
+
+    char digits[16];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits),
+        value);
+    std::string_view text(digits, result.ptr - digits);
+    if (value < 0)
+    {
+        emitTight("(");
+        emitTight(text);
+        emitTight(")");
+    }
+    else
+    {
+        emitTight(text);
+    }
+}
+
+void Generator::emitOperator(int op)
+{
+    pprint_space();
+    if (op == T_EQ)
+        emit("=");
+    else
+        emit(opText(op));
+    pprint_space();
+}
+
+void Generator::emit(std::string_view sequence)
+{
+    pprint_lineStart();
+
+    // Write the output
+    m_line += sequence;
+    m_startOfLine = false;
+}
+
+void Generator::emitTight(std::string_view sequence)
+{
+    m_line += sequence;
+}
+
+void Generator::emitBlockStart()
+{
+    pprint_space();
+    m_line += '{';
+
+#ifdef PRETTY_PRINT
+    // The pretty print option is enabled in `bb.h`, add a newline for easier
+    // output debugging
+    m_line += '\n';
+    m_indentLevel++;
+    m_startOfLine = true;
+    flushLine(false);
+#endif
+}   
+
+void Generator::emitBlockEnd()
+{
+    pprint_lineStartEnd();
+    m_line += '}';
+    pprint_lineEnd();
+    flushLine(false);
+}
+
+void Generator::emitLineEnd()
+{
+    m_line += ';';
+    pprint_lineEndStart();
+    flushLine(false);
 }
 
 void Generator::flushLine(bool startOfLine)
 {
-    m_lines.push_back(m_line.str());
-    m_line.str("");
+    m_lines += m_line;
     m_line.clear();
 
     if (startOfLine)
@@ -10,34 +10,136 @@ This file contains definitions for the code generator.
 #ifndef __GENERATOR_H__
 #define __GENERATOR_H__
 
-#include <fstream>
-#include <sstream>
+#include <ostream>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "ast.h"
 #include "bb.h"
-#include "token.h"
+#include "symbol_table.h"
 
 /*
 The `Generator` class is responsible for writing the correctly formatted 
-code output for the language. This code generator emits C code, but it 
-would be pretty straightforward to implement other language generators. 
+code output for the language. It walks the AST built by the parser and
+emits C code, but it would be pretty straightforward to implement other
+language generators. 
 */
 class Generator
 {
 public:
-    // Initializes the code generator with an output file path
-    Generator(const char* path);
+    // Initializes the code generator with the stream to write the output to
+    Generator(std::ostream& output);
 
-    // Cleanup
-    ~Generator();
+    // Generates the code for a program and flushes it to the output
+    void emitProgram(const Program& program);
 
-    // Finalizes the program generation and flushes the output ot disk
-    // The identifier map is a stack of identifiers that need to be initialized
-    // at the start of the program.
-    void emitProgram(const std::vector<std::string>& identifierMap);
+private:
+    // The stream the output is written to
+    std::ostream& m_output;
+
+    // Stores the lines of the output during generation. Completed lines are
+    // appended to a single buffer so that flushing a line doesn't allocate.
+    std::string m_lines;
+
+    // Used for building individual lines
+    std::string m_line;
+
+    // The program being generated
+    const Program* m_program = nullptr;
+
+    // Tracks if we are at the start of a line. This is used to prevent a space
+    // from being added to the start of each line. While this isn't strictly 
+    // necessary, it does result in a slightly nicer/cleaner output
+    bool m_startOfLine = true;
+
+    // Tracks the indent level for when pretty print mode is enabled
+    int m_indentLevel = 1;
+
+    // Flushes a line to the output buffer
+    void flushLine(bool startOfLine);
+
+    // Emits a given sequence to the output
+    void emit(std::string_view sequence);    
+
+    // Writes a given sequence without adding any space
+    void emitTight(std::string_view sequence);
+
+    // Emits the identifier initializations
+    void emitInitializations(const SymbolTable& symbols);
+
+    // Emits the generated program output
+    void emitOutput();
+
+    /*
+     * The following walk the AST and emit the code for each kind of node.
+     * 
+     * The walk doesn't recurse. Each of the emit methods below writes the
+     * code that comes before the node's children and then pushes the rest of
+     * its work onto `m_work`, so deeply nested programs can't overflow the
+     * call stack. The work is pushed in reverse, since the last step pushed
+     * is the first to run.
+     */
+
+    // The steps of work left to do while walking the AST
+    enum WalkStep : uint8_t
+    {
+        W_STATEMENTS,   // Emit the statements of a list, starting at `id`
+        W_BLOCK,        // Emit a block of statements, starting at `id`
+        W_BLOCK_END,    // Emit the end of a block
+        W_ELSE,         // Emit an else clause with the block starting at `id`
+        W_LINE_END,     // Emit a line ending
+        W_TEXT,         // Emit `text` without adding any space
+        W_OPERATOR,     // Emit the operator `op`
+        W_EXPRESSION,   // Emit the arithmetic expression `id`
+        W_OPERAND,      // Emit the operand `id` of the operator `op`
+        W_CONDITION,    // Emit the boolean expression `id`
+        W_OR_TERMS,     // Emit the `or` operands of `id`
+        W_AND_LEVEL,    // Emit the `and` level `id`
+        W_AND_TERMS,    // Emit the `and` operands of `id`
+        W_COMPARISON,   // Emit the comparison `id`
+        W_PRIMARY,      // Emit the comparison operand `id`
+    };
+
+    // A single step of work
+    struct WalkTask
+    {
+        WalkStep step;
+        bool right;         // W_OPERAND: this is the right operand
+        int16_t op;
+        NodeId id;
+        const char* text;
+    };
+
+    // The work left to do while walking the AST
+    std::vector<WalkTask> m_work;
+
+    // Pushes a step of work
+    void push(WalkStep step, NodeId id = NO_NODE, int op = 0, 
+        bool right = false)
+    {
+        m_work.push_back(WalkTask{step, right, static_cast<int16_t>(op), id,
+            nullptr});
+    }
+
+    // Pushes text to be written without adding any space
+    void pushText(const char* text)
+    {
+        m_work.push_back(WalkTask{W_TEXT, false, 0, NO_NODE, text});
+    }
 
-    // Writes a given token to the output
-    void emitToken(Token token);
+    // Emits a list of statements, starting with the given statement. This
+    // runs the walk until all of its work is done.
+    void emitStatements(NodeId first);
+
+    // Runs a single step of work
+    void runStep(const WalkTask& task);
+
+    // Emits a single statement
+    void emitStatement(NodeId id);
+
+    // Emits a block of statements wrapped in braces
+    void emitBlock(NodeId first);
 
     // Emits the start of a code block
     void emitBlockStart();
@@ -48,53 +150,56 @@ public:
     // Writes a line ending character
     void emitLineEnd();
 
-    // Emits the dotimes loop to the output.
-    void emitDoTimes(Token token);
+    // Emits an assignment of a value to a variable
+    void emitAssignment(SymbolId symbol, NodeId value);
+
+    // Emits the dotimes loop header to the output.
+    void emitDoTimes(NodeId count);
 
     // Emits a read(<identifier>) to the output
-    void emitRead(Token identifier);
+    void emitRead(SymbolId symbol);
 
     // Emits the internal portion of a printf for the implementation of our
     // print() call
-    void emitPrint(const std::string& str, const std::vector<std::string>& idents);
-private:
-    // The file object for writing
-    std::ofstream m_file;
+    void emitPrint(NodeId first);
 
-    // Stores the lines of the output during generation
-    std::vector<std::string> m_lines;
+    // Emits an arithmetic expression
+    void emitExpression(NodeId id);
 
-    // Used for building individual lines
-    std::stringstream m_line;
+    // Emits an operand of an arithmetic operator, adding parentheses if
+    // they are needed to keep the operator's precedence in C
+    void emitOperand(NodeId id, int parentOp, bool right);
 
-    // Tracks if we are at the start of a line. This is used to prevent a space
-    // from being added to the start of each line. While this isn't strictly 
-    // necessary, it does result in a slightly nicer/cleaner output
-    bool m_startOfLine = true;
+    // Emits a boolean expression. Each level of the boolean precedence is
+    // wrapped in parentheses to make the parsed precedence explicit in C.
+    void emitCondition(NodeId id);
 
-    // Tracks the indent level for when pretty print mode is enabled
-    int m_indentLevel = 1;
+    // Emits the operands of the `or` operators of a boolean expression
+    void emitOrTerms(NodeId id);
 
-    // Flushes a line to the output buffer
-    void flushLine(bool startOfLine);
+    // Emits an `and` level of a boolean expression
+    void emitAndLevel(NodeId id);
 
-    // Emits a given sequence to the output
-    void emit(const char* sequence);    
+    // Emits the operands of the `and` operators of a boolean expression
+    void emitAndTerms(NodeId id);
 
-    // Writes a given sequence without adding any space
-    void emitTight(const char* sequence);
+    // Emits a comparison, or a lone operand of a boolean expression
+    void emitComparison(NodeId id);
 
-    // Emits the identifier initializations
-    void emitInitializations(const std::vector<std::string> identifierMap);
+    // Emits an operand of a comparison
+    void emitBooleanPrimary(NodeId id);
 
-    // Emits the generated program output
-    void emitOutput();
+    // Emits a number literal
+    void emitNumber(int value);
 
-    // emits a keyword to the output
-    void emitKeyword(Token token);
+    // Emits a binary operator surrounded by spaces
+    void emitOperator(int op);
 
-    // emits an operator to the output
-    void emitOperator(Token token);
+    // Gets the name of a variable
+    std::string_view name(SymbolId symbol) const
+    {
+        return m_program->symbols.name(symbol);
+    }
 
     /*
      * The following are helper methods for dealing with formatting when the PRETTY_PRINT option
@@ -111,7 +216,7 @@ private:
 #ifdef PRETTY_PRINT
         if (m_startOfLine)
             for (int i = 0; i < m_indentLevel; i++)
-                m_line << "\t";
+                m_line += '\t';
 #endif
     }
 
@@ -128,7 +233,7 @@ private:
     inline void pprint_lineEnd()
     {
 #ifdef PRETTY_PRINT
-        m_line << "\n";
+        m_line += '\n';
 #endif
     }
 
@@ -146,7 +251,7 @@ private:
     inline void pprint_space()
     {
 #ifdef PRETTY_PRINT
-        m_line << " ";
+        m_line += ' ';
 #endif
     }
 
@@ -154,7 +259,7 @@ private:
     inline void pprint_fileLineEnd()
     {
 #ifdef PRETTY_PRINT
-        m_file << "\n";
+        m_output << "\n";
 #endif
     }
 
@@ -173,7 +278,7 @@ private:
     {
 #ifdef PRETTY_PRINT
         if (m_startOfLine)
-            m_file << "\t";
+            m_output << "\t";
 #endif
     }
 };
@@ -0,0 +1,234 @@
+/*
+File: invariant_hoister.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `InvariantHoister` class.
+*/
+
+
+#include "invariant_hoister.h"
+
+#include <string>
+
+#include "optimizer.h"
+#include "token_type.h"
+
+InvariantHoister::InvariantHoister(Program& program)
+    : m_program(program), m_ast(program.ast)
+{
+}
+
+void InvariantHoister::run()
+{
+    findLoopAssigns(m_ast, m_ast.root(), m_loopAssigns);
+    m_assigned.assign(m_program.symbols.size(), false);
+
+    // Walk every statement. Outer loops are done before the loops inside
+    // them, so a computation moves out of the outermost loop it can.
+    m_work.push_back(m_ast.root());
+    while (!m_work.empty())
+    {
+        NodeId id = m_work.back();
+        m_work.pop_back();
+        if (id == NO_NODE)
+            continue;
+
+        m_work.push_back(m_ast[id].next);
+        const Node& node = m_ast[id];
+        if (node.kind == N_IF)
+        {
+            m_work.push_back(node.b);
+            if (node.flags & F_HAS_ELSE)
+                m_work.push_back(node.c);
+        }
+        else if (node.kind == N_WHILE || node.kind == N_DOTIMES)
+        {
+            NodeId loop = hoist(id);
+            m_work.push_back(m_ast[loop].b);
+        }
+    }
+}
+
+NodeId InvariantHoister::hoist(NodeId loop)
+{
+    // Find the invariant parts of the assignments that run on every pass
+    for (SymbolId symbol : m_loopAssigns[loop])
+        m_assigned[symbol] = true;
+
+    m_hoisted.clear();
+    for (NodeId id = m_ast[loop].b; id != NO_NODE; id = m_ast[id].next)
+    {
+        const Node& node = m_ast[id];
+        if (node.kind == N_WHILE || node.kind == N_DOTIMES)
+            break;
+        if ((node.kind == N_ASSIGN || node.kind == N_DECLARE)
+            && node.b != NO_NODE)
+            findInvariant(node.b);
+    }
+
+    for (SymbolId symbol : m_loopAssigns[loop])
+        m_assigned[symbol] = false;
+
+    if (m_hoisted.empty())
+        return loop;
+
+    // Move each invariant expression into an assignment to a temporary,
+    // leaving the temporary where it was
+    NodeId first = NO_NODE;
+    NodeId last = NO_NODE;
+    for (NodeId id : m_hoisted)
+    {
+        SymbolId temporary = addTemporary();
+        Node expression = m_ast[id];
+        NodeId moved = m_ast.add(expression.kind, expression.a, expression.b,
+            expression.c);
+        m_ast[moved].flags = expression.flags;
+        m_ast[moved].op = expression.op;
+
+        Node& node = m_ast[id];
+        node.kind = N_VAR;
+        node.flags = 0;
+        node.op = 0;
+        node.a = temporary;
+        node.b = 0;
+        node.c = 0;
+
+        NodeId assign = m_ast.add(N_ASSIGN, temporary, moved);
+        if (first == NO_NODE)
+            first = assign;
+        else
+            m_ast[last].next = assign;
+        last = assign;
+    }
+
+    // The loop moves to a new node after the assignments, and its old node
+    // is taken over by what comes first, so it keeps its place in its block
+    Node loopNode = m_ast[loop];
+    NodeId movedLoop = m_ast.add(loopNode.kind, loopNode.a, loopNode.b,
+        loopNode.c);
+    m_ast[movedLoop].flags = loopNode.flags;
+    m_ast[last].next = movedLoop;
+
+    std::vector<SymbolId> assigns = std::move(m_loopAssigns[loop]);
+    m_loopAssigns.erase(loop);
+    m_loopAssigns[movedLoop] = std::move(assigns);
+
+    const Node& test = m_ast[loopNode.a];
+    bool runs = test.kind == N_NUM && (loopNode.kind == N_WHILE
+        ? test.a != 0 : static_cast<int>(test.a) > 0);
+    if (runs)
+    {
+        m_ast[movedLoop].next = loopNode.next;
+        m_ast[loop] = m_ast[first];
+        return movedLoop;
+    }
+
+    // Only set the temporaries if the loop runs at least once. A dotimes
+    // loop runs if its count is more than 0.
+    NodeId guard = cloneTree(m_ast, loopNode.a);
+    if (loopNode.kind == N_DOTIMES)
+        guard = m_ast.addBinary(T_GT, guard, m_ast.add(N_NUM, 0));
+
+    Node& node = m_ast[loop];
+    node.kind = N_IF;
+    node.flags = 0;
+    node.op = 0;
+    node.a = guard;
+    node.b = first;
+    node.c = NO_NODE;
+    return movedLoop;
+}
+
+void InvariantHoister::findInvariant(NodeId root)
+{
+    // Work out which nodes are invariant, operands first
+    m_invariant.resize(m_ast.size());
+    m_order.clear();
+    bool mayFail = false;
+    m_expressionWork.clear();
+    m_expressionWork.emplace_back(root, false);
+    while (!m_expressionWork.empty())
+    {
+        auto [id, operandsDone] = m_expressionWork.back();
+        m_expressionWork.pop_back();
+
+        const Node& node = m_ast[id];
+        if (!operandsDone && (node.kind == N_PAREN || node.kind == N_NOT
+            || node.kind == N_BINARY))
+        {
+            m_expressionWork.emplace_back(id, true);
+            m_expressionWork.emplace_back(node.a, false);
+            if (node.kind == N_BINARY)
+                m_expressionWork.emplace_back(node.b, false);
+            continue;
+        }
+
+        bool invariant = false;
+        switch (node.kind)
+        {
+            case N_NUM:
+                invariant = true;
+                break;
+            case N_VAR:
+                invariant = !m_assigned[node.a];
+                break;
+            case N_PAREN:
+            case N_NOT:
+                invariant = m_invariant[node.a];
+                break;
+            case N_BINARY:
+                invariant = m_invariant[node.a] && m_invariant[node.b];
+                if ((node.op == T_DIV || node.op == T_MOD)
+                    && !isSafeDivisor(m_ast, node.b))
+                    mayFail = true;
+                break;
+            default:
+                break;
+        }
+        m_invariant[id] = invariant;
+    }
+
+    // An expression with a division that may fail is left exactly as it
+    // was written, the same as in constant folding
+    if (mayFail)
+        return;
+
+    // Take the largest invariant parts that compute something. A number or
+    // a variable on its own isn't worth a temporary.
+    m_order.push_back(root);
+    while (!m_order.empty())
+    {
+        NodeId id = m_order.back();
+        m_order.pop_back();
+
+        const Node& node = m_ast[id];
+        NodeId inner = id;
+        while (m_ast[inner].kind == N_PAREN)
+            inner = m_ast[inner].a;
+        NodeKind kind = m_ast[inner].kind;
+        if (m_invariant[id] && (kind == N_BINARY || kind == N_NOT))
+        {
+            m_hoisted.push_back(id);
+            continue;
+        }
+
+        if (node.kind == N_PAREN || node.kind == N_NOT
+            || node.kind == N_BINARY)
+            m_order.push_back(node.a);
+        if (node.kind == N_BINARY)
+            m_order.push_back(node.b);
+    }
+}
+
+SymbolId InvariantHoister::addTemporary()
+{
+    std::string name;
+    do
+    {
+        name = "t_hoisted_" + std::to_string(m_nextTemporary++);
+    } while (m_program.symbols.find(name) != SymbolTable::NO_SYMBOL);
+
+    m_assigned.push_back(false);
+    return m_program.symbols.add(name);
+}
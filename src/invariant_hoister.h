@@ -0,0 +1,89 @@
+/*
+File: invariant_hoister.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the loop-invariant code motion pass.
+*/
+
+
+#ifndef __INVARIANT_HOISTER_H__
+#define __INVARIANT_HOISTER_H__
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ast.h"
+#include "symbol_table.h"
+
+/*
+The `InvariantHoister` class moves computations that give the same result
+on every pass through a loop out of it. An expression is invariant if it
+only uses variables the loop doesn't assign. The largest invariant parts of
+the loop's assignments are computed once into new temporary variables
+before the loop, and the loop uses the temporaries instead:
+
+    while (i < n) { x = x + a * b; i = i + 1; }
+
+becomes
+
+    if (i < n) { t_hoisted_0 = a * b; while (i < n) { ... } }
+
+with `x = x + t_hoisted_0;` in the body.
+
+Nothing is computed ahead of time that the loop wouldn't have computed, so
+nothing new can overflow. The temporaries are only set when the loop runs
+at least once, which is what the if around the loop is for. It is left out
+when the loop is known to run. Only assignments that run on every pass are
+looked at: those directly in the loop's body, before any loop inside it
+(which might not end). Expressions with a division that may fail are left in
+the loop, so they fail where they did.
+*/
+class InvariantHoister
+{
+public:
+    InvariantHoister(Program& program);
+
+    // Runs the pass
+    void run();
+
+private:
+    Program& m_program;
+    Ast& m_ast;
+
+    // The variables assigned anywhere in each loop
+    std::unordered_map<NodeId, std::vector<SymbolId>> m_loopAssigns;
+
+    // Marks the variables assigned by the loop being looked at
+    std::vector<bool> m_assigned;
+
+    // The statement lists left to walk
+    std::vector<NodeId> m_work;
+
+    // The expressions to move out of the loop being looked at
+    std::vector<NodeId> m_hoisted;
+
+    // Scratch space for finding the invariant parts of an expression. Each
+    // entry is a node and whether its operands have been looked at.
+    std::vector<std::pair<NodeId, bool>> m_expressionWork;
+    std::vector<bool> m_invariant;
+    std::vector<NodeId> m_order;
+
+    // The number to give the next temporary variable
+    uint32_t m_nextTemporary = 0;
+
+    // Moves the invariant computations out of a loop. Returns the loop's
+    // new node, since the loop's old node is taken over by what comes
+    // before it.
+    NodeId hoist(NodeId loop);
+
+    // Adds the largest invariant parts of an expression to `m_hoisted`
+    void findInvariant(NodeId root);
+
+    // Adds a temporary variable with a name that isn't taken
+    SymbolId addTemporary();
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*
+File: keywords.h
+Author: Adam Thompson
+Course: CSC 407
+
+This file contains the keyword table used by the lexer. The table is a
+perfect hash that is built entirely at compile time.
+*/
+
+
+#ifndef __KEYWORDS_H__
+#define __KEYWORDS_H__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "token_type.h"
+
+// A reserved word in the language along with the token type it produces
+struct Keyword
+{
+    std::string_view text;
+    TokenType type;
+};
+
+// Every word the lexer must treat as something other than an identifier. The
+// logical operators `and` and `or` are spelled as words, so they live here 
+// alongside the statement keywords.
+constexpr Keyword KEYWORDS[] = {
+    { "let", T_LET },
+    { "if", T_IF },
+    { "else", T_ELSE },
+    { "while", T_WHILE },
+    { "print", T_PRINT },
+    { "dotimes", T_DOTIMES },
+    { "read", T_READ },
+    { "and", T_AND },
+    { "or", T_OR },
+};
+
+constexpr size_t KEYWORD_COUNT = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]);
+
+// The number of slots in the hash table. This must be a power of two.
+constexpr size_t KEYWORD_TABLE_SIZE = 16;
+
+static_assert(KEYWORD_COUNT <= KEYWORD_TABLE_SIZE, 
+    "The keyword hash table is too small for the number of keywords");
+
+// Hashes a (non-empty) word. Only the length and the first and last 
+// characters are mixed in, so hashing costs the same for any length of
+// identifier. The seed is chosen at compile time to make this collision free
+// for the keywords.
+constexpr size_t keywordHash(std::string_view word, uint32_t seed)
+{
+    uint32_t h = seed ^ static_cast<uint32_t>(word.size());
+    h = (h ^ static_cast<unsigned char>(word.front())) * 0x01000193u;
+    h = (h ^ static_cast<unsigned char>(word.back())) * 0x01000193u;
+    h ^= h >> 15;
+    return h & (KEYWORD_TABLE_SIZE - 1);
+}
+
+// Checks if a seed places every keyword in its own slot
+constexpr bool keywordSeedIsPerfect(uint32_t seed)
+{
+    bool used[KEYWORD_TABLE_SIZE] = {};
+    for (size_t i = 0; i < KEYWORD_COUNT; i++)
+    {
+        size_t slot = keywordHash(KEYWORDS[i].text, seed);
+        if (used[slot])
+            return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+// Searches for the first seed that gives a perfect hash. Returns 0 if none
+// was found.
+constexpr uint32_t findKeywordSeed()
+{
+    for (uint32_t seed = 1; seed < 65536; seed++)
+        if (keywordSeedIsPerfect(seed))
+            return seed;
+    return 0;
+}
+
+constexpr uint32_t KEYWORD_SEED = findKeywordSeed();
+
+static_assert(KEYWORD_SEED != 0, 
+    "No perfect hash seed was found, increase KEYWORD_TABLE_SIZE");
+
+// Builds the hash table. Empty slots hold an empty word, which can never
+// match a lexeme.
+constexpr std::array<Keyword, KEYWORD_TABLE_SIZE> buildKeywordTable()
+{
+    std::array<Keyword, KEYWORD_TABLE_SIZE> table = {};
+    for (size_t i = 0; i < KEYWORD_TABLE_SIZE; i++)
+        table[i] = Keyword{ std::string_view(), T_IDENT };
+    for (size_t i = 0; i < KEYWORD_COUNT; i++)
+        table[keywordHash(KEYWORDS[i].text, KEYWORD_SEED)] = KEYWORDS[i];
+    return table;
+}
+
+constexpr std::array<Keyword, KEYWORD_TABLE_SIZE> KEYWORD_TABLE = 
+    buildKeywordTable();
+
+// Looks up the token type for a word. Returns T_IDENT if the word isn't a
+// keyword. This takes one hash and one length checked comparison.
+constexpr TokenType lookupKeyword(std::string_view word)
+{
+    const Keyword& slot = KEYWORD_TABLE[keywordHash(word, KEYWORD_SEED)];
+    return slot.text == word ? slot.type : T_IDENT;
+}
+
+// Checks that a token type has a spelling in the keyword table
+constexpr bool keywordIsListed(TokenType type)
+{
+    for (size_t i = 0; i < KEYWORD_COUNT; i++)
+        if (KEYWORDS[i].type == type)
+            return true;
+    return false;
+}
+
+// Checks that every keyword declared in `token_type.h` can be lexed, and that
+// every keyword in the table is found by the lookup
+constexpr bool keywordTableIsComplete()
+{
+    for (int type = T_LET; type <= T_LAST_KEYWORD; type++)
+        if (!keywordIsListed(static_cast<TokenType>(type)))
+            return false;
+    for (size_t i = 0; i < KEYWORD_COUNT; i++)
+        if (lookupKeyword(KEYWORDS[i].text) != KEYWORDS[i].type)
+            return false;
+    return true;
+}
+
+static_assert(keywordTableIsComplete(),
+    "Every keyword in token_type.h needs an entry in KEYWORDS");
+
+#endif
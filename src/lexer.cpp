@@ -10,39 +10,72 @@ Contains the implementation for the `Lexer` class.
 #include "lexer.h"
 
 #include "bb.h"
+#include "char_class.h"
+#include "keywords.h"
+#include "scan.h"
 
-#include <cctype>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <locale>
-#include <sstream>
 #include <string>
+#include <system_error>
 
 Lexer::Lexer(std::ifstream& file) 
+    : Lexer(std::make_shared<SourceBuffer>(file))
 {
-    // Read the input file into a buffer
-    //std::ifstream file(path);
-    std::ostringstream ss;
-    ss << file.rdbuf();
-    const std::string& s = ss.str();
-    m_inputBuffer = std::vector<char>(s.begin(), s.end());
-
-    // Check for an empty buffer, which would correspond to an empty input file
-    if (m_inputBuffer.size() == 0)
-    {
-        std::cerr << "Empty input file provided. Nothing to do." << std::endl;
-        exit(0);
-    }
+}
 
-    // Initialize the lexer state
-    m_bufferLength = m_inputBuffer.size();
+Lexer::Lexer(std::shared_ptr<SourceBuffer> source) 
+    : Lexer(source, 0, source->size())
+{
+}
+
+Lexer::Lexer(std::shared_ptr<SourceBuffer> source, size_t start, size_t end)
+    : m_source(source)
+{
+    // Initialize the lexer state. An empty input is left for the caller to
+    // check with `isEmpty`.
+    m_inputBuffer = m_source->data() + start;
+    m_bufferLength = end - start;
     m_currentPos = 0;
-    m_currentChar = m_inputBuffer[0];
+    m_currentChar = m_bufferLength > 0 ? m_inputBuffer[0] : '\0';
+}
+
+Lexer::Lexer(int fd, size_t chunkSize) : m_fd(fd), m_chunkSize(chunkSize)
+{
+    // Start with an empty window and read the first chunk into it
+    m_inputBuffer = m_window.data();
+    m_bufferLength = 0;
+    m_currentPos = 0;
+    size_t discarded;
+    refill(discarded);
+
+    // An empty stream is left for the caller to check with `isEmpty`
+    m_currentChar = m_bufferLength > 0 ? m_inputBuffer[0] : '\0';
 }
 
 void Lexer::nextChar() 
 {
-    m_currentPos++;
+    advanceTo(m_currentPos + 1);
+}
+
+void Lexer::advanceTo(size_t pos)
+{
+    m_currentPos = pos;
+
+    // When streaming, running off the end of the window means we need to
+    // read the next chunk
+    if (m_currentPos >= m_bufferLength && m_fd >= 0)
+    {
+        size_t discarded;
+        refill(discarded);
+    }
+
     if (m_currentPos >= m_bufferLength)
         m_currentChar = '\0'; // Marks the end of the input
     else
@@ -54,120 +87,54 @@ Token Lexer::getToken()
     // Skip comments and whitespace
     skipWhitespace();
     skipComments();
-    Token token("", T_UNKNOWN);
+    Token token;
+
+    // Everything from here on is part of the token, so it must be kept in the
+    // window if we need to read another chunk
+    m_tokenStart = m_currentPos;
     
-    // Start by looking at the first character to try and determine what token
-    // we are currently looking at. In the case where a character could be the 
-    // start of a multi-character token, we look ahead with peek to try and 
-    // determine what token this is. This logic is basically just an 
-    // implementation of a simple FSM.
-    switch (m_currentChar)
+    // Start by looking at the class of the first character to try and 
+    // determine what token we are currently looking at. Single character 
+    // tokens come straight out of a table. The characters that can start a
+    // two character operator (==, <=, >=, !=) form a small DFA: the first
+    // character picks the state and a following '=' is the only transition,
+    // so looking ahead with peek is enough to pick the accepting state.
+    switch (charClass(m_currentChar))
     {
-        case '+':
-           TOKEN(m_currentChar, T_PLUS);
-           break; 
-        case '-':
-            TOKEN(m_currentChar, T_MINUS);
-            break;
-        case '*':
-            TOKEN(m_currentChar, T_MUL);
-            break;
-        case '/':
-            TOKEN(m_currentChar, T_DIV);
-            break;
-        case '%':
-            TOKEN(m_currentChar, T_MOD);
-            break;
-        case '=':
-            // Check if this is part of a '=='
-            if (peek() == '=')
-            {
-                // This is a '==' token
-                TOKEN(getTwoCharToken(), T_EQEQ);
-            }
-            else
-            {
-                // This is just a '=' token
-                TOKEN(m_currentChar, T_EQ);
-            }
-            break;
-        case '>':
-            // Check if this is part of a '>='
-            if (peek() == '=') 
-            {
-                // This is '>=' token
-                TOKEN(getTwoCharToken(), T_GTEQ);
-            }
-            else 
-            {
-                // This is just a '>' token
-                TOKEN(m_currentChar, T_GT);
-            }
+        case C_SINGLE:
+            TOKEN(currentSpan(1), singleToken(m_currentChar));
             break;
-        case '<':
-            // Check if this is part of a '<='
+        case C_PAIR:
             if (peek() == '=')
             {
-                // This is a '<=' token
-                TOKEN(getTwoCharToken(), T_LTEQ);
-            }
-            else 
-            {
-                // This is just a '<' token
-                TOKEN(m_currentChar, T_LT);
-            }
-            break;
-        case '!':
-            // Check if this is part of a '!='
-            if (peek() == '=')
-            {
-                // This is a '!=' token 
-                TOKEN(getTwoCharToken(), T_NEQ);
+                TokenType type = pairToken(m_currentChar);
+                TOKEN(getTwoCharToken(), type);
             }
             else
             {
-                // This is just a '!' token
-                TOKEN(m_currentChar, T_NOT);
+                TOKEN(currentSpan(1), singleToken(m_currentChar));
             }
             break;
-        case '(':
-            TOKEN(m_currentChar, T_LPAREN);
-            break;
-        case ')':
-            TOKEN(m_currentChar, T_RPAREN);
+        case C_NEWLINE:
+            TOKEN("newline", T_NEWLINE);
             break;
-        case '[':
-            TOKEN(m_currentChar, T_LBRACKET);
+        case C_END: // EOF marker
+            TOKEN("EOF", T_EOF);
             break;
-        case ']':
-            TOKEN(m_currentChar, T_RBRACKET);
-            break;
-        case '{':
-            TOKEN(m_currentChar, T_LBRACE);
-            break;
-        case '}':
-            TOKEN(m_currentChar, T_RBRACE);
-            break;
-        case '\n':
-            TOKEN(std::string("newline"), T_NEWLINE);
-            break;
-        case '\0': // EOF marker
-            TOKEN(std::string("EOF"), T_EOF);
-            break;
-        case ';': 
-            TOKEN(m_currentChar, T_SEMICOLON);
-            break;
-        case ',':
-            TOKEN(m_currentChar, T_COMMA);
-            break;
-        case '"':
+        case C_QUOTE:
             {
                 // This is the start/end of a string literal, build the string 
                 // contained within the `"` chars
                 nextChar();
-                int start = m_currentPos;
-                while (m_currentChar != '"')
+                while (true)
                 {
+                    // Jump straight to the next character that could end the
+                    // string
+                    advanceTo(scanFrom(scanStringSpecial, m_currentPos, true));
+
+                    if (m_currentChar == '"')
+                        break;
+
                     // Reaching the end of the input before a closing quote is a
                     // malformed string.
                     if (m_currentChar == '\0')
@@ -179,123 +146,100 @@ Token Lexer::getToken()
                     // the `\"` sequence is a special case in which the `"` 
                     // should be treated as part of the string and not as the 
                     // terminating symbol of this string
-                    if (m_currentChar == '\\' && peek() == '"')
-                    {
-                        // Skip the next two chars
-                        nextChar();
+                    if (peek() == '"')
                         nextChar();
-
-                        // Continue parsing out the string literal
-                        continue;
-                    }
-
                     nextChar();
                 }
 
-                // Build the string literal
-                std::stringstream ss;
-                for (int i = start; i <= m_currentPos - 1; i++)
-                    ss << m_inputBuffer[i];
-                TOKEN(ss.str(), T_STRING);
+                // The string literal is the span between the quotes
+                size_t start = m_tokenStart + 1;
+                if (m_currentPos - start > UINT32_MAX)
+                {
+                    std::string msg = "String literal is too long.";
+                    abort(msg);
+                }
+                TOKEN(span(start, m_currentPos - start), T_STRING);
             }
             break;
-        default:
-            // Deal with number literals
-            if (isdigit(m_currentChar))
+        case C_DIGIT:
             {
                 // We are reading the start of a number, since our language is 
                 // so primitive that it only recognizes ints, this is pretty 
                 // trivial. Simply continue reading until we hit something that 
                 // is not a digit.
-                int start = m_currentPos; 
-                while (isdigit(peek()))
-                    nextChar();
-                // Build the full number string
-                std::stringstream ss;
-                for (int i = start; i <= m_currentPos; i++)
-                    ss << m_inputBuffer[i]; 
-                TOKEN(ss.str(), T_NUM);
-                break;
+                advanceTo(scanFrom(scanDigits, m_currentPos + 1, true) - 1);
+
+                // Decode the value once here so the parser never has to parse
+                // the lexeme again. Values that don't fit in an int are 
+                // flagged and reported by the parser.
+                std::string_view digits = span(m_tokenStart, 
+                    m_currentPos - m_tokenStart + 1);
+                int value = 0;
+                std::from_chars_result result = std::from_chars(digits.data(),
+                    digits.data() + digits.size(), value);
+                bool overflow = result.ec == std::errc::result_out_of_range;
+                token = Token(digits, overflow ? 0 : value, overflow);
+                print_lex(token);
             }
-            else if (isalpha(m_currentChar))
+            break;
+        case C_ALPHA:
             {
                 // This token begins with a letter, so it must be an identifier
-                // or a keyword. Start by building the full string
-                int start = m_currentPos;
-                while (isalnum(peek()))
-                    nextChar();
-                // Build the full string
-                std::stringstream ss;
-                for (int i = start; i <= m_currentPos; i++)
-                    ss << m_inputBuffer[i];
-                std::string tokenText = ss.str();
+                // or a keyword. Start by finding the end of the word.
+                advanceTo(scanFrom(scanAlnum, m_currentPos + 1, true) - 1);
 
                 // Determine if this is an identifier or a keyword
-                token = checkIfKeyword(tokenText);
-            }
-            else 
-            {
-                // We have no idea what this token is...
-                TOKEN("UNKNOWN", T_UNKNOWN);
-                // TODO: There should probably be some error reporting here...
-                break;
+                token = checkIfKeyword(span(m_tokenStart, 
+                    m_currentPos - m_tokenStart + 1));
             }
+            break;
+        default:
+            // We have no idea what this token is...
+            TOKEN("UNKNOWN", T_UNKNOWN);
+            // TODO: There should probably be some error reporting here...
+            break;
     }
 
+    // The window is about to move on, so a streamed token needs its own copy
+    // of its lexeme
+    if (m_fd >= 0)
+        token = keepLexeme(token);
+
     // Advance the lexer
     nextChar();
 
     return token;
 }
 
-Token Lexer::checkIfKeyword(std::string& lexeme)
+TokenType Lexer::singleToken(char c)
 {
-    // Default to an identifier
-    Token token(lexeme, T_IDENT);    
+    return SINGLE_TOKENS[static_cast<unsigned char>(c)];
+}
 
-    // Check if this is any of our keywords
-    if (lexeme == "let")
-    {
-        TOKEN(lexeme, T_LET);
-    }
-    else if (lexeme == "if")
-    {
-        TOKEN(lexeme, T_IF);
-    }
-    else if (lexeme == "else")
-    {
-        TOKEN(lexeme, T_ELSE);
-    }
-    else if (lexeme == "while")
-    {
-        TOKEN(lexeme, T_WHILE);
-    }
-    else if (lexeme == "dotimes")
-    {
-        TOKEN(lexeme, T_DOTIMES);
-    }
-    else if (lexeme == "print")
-    {
-        TOKEN(lexeme, T_PRINT);
-    }
-    else if (lexeme == "and")
-    {
-        TOKEN(lexeme, T_AND);
-    }
-    else if (lexeme == "or")
-    {
-        TOKEN(lexeme, T_OR);
-    }
-    else if (lexeme == "read")
-    {
-        TOKEN(lexeme, T_READ);
-    }
+TokenType Lexer::pairToken(char c)
+{
+    return PAIR_TOKENS[static_cast<unsigned char>(c)];
+}
+
+Token Lexer::checkIfKeyword(std::string_view lexeme)
+{
+    // A single hash probe settles if this is a keyword or an identifier
+    Token token(lexeme, lookupKeyword(lexeme));
+
+    if (!Token::isKind(token, T_IDENT))
+        print_lex(token);
 
     return token;
 }
 
 char Lexer::peek()
 {
+    if (m_currentPos+1 >= m_bufferLength && m_fd >= 0)
+    {
+        size_t discarded;
+        refill(discarded);
+    }
+
     if (m_currentPos+1 >= m_bufferLength)
         return '\0'; // Marks the end of the input
     return m_inputBuffer[m_currentPos+1];
@@ -303,18 +247,12 @@ char Lexer::peek()
 
 void Lexer::abort(std::string& msg) const
 {
-    std::cerr << "Lexing error: " << msg << std::endl;
-    std::cerr << "Aborting..." << std::endl;
-    exit(EXIT_FAILURE);
+    throw LexError(msg);
 }
 
 void Lexer::skipWhitespace() 
 {
-    while (m_currentChar == ' ' || m_currentChar == '\t' 
-        || m_currentChar == '\r')
-    {
-        nextChar();
-    }
+    advanceTo(scanFrom(scanWhitespace, m_currentPos, false));
 }
 
 void Lexer::skipComments()
@@ -322,16 +260,113 @@ void Lexer::skipComments()
     if (m_currentChar == '#')
     {
         // A final comment does not need to end with a newline.
-        while (m_currentChar != '\n' && m_currentChar != '\0')
-            nextChar();
+        advanceTo(scanFrom(scanCommentEnd, m_currentPos, false));
     }
 }
 
-std::string Lexer::getTwoCharToken()
+std::string_view Lexer::getTwoCharToken()
 {
-    char prev = m_currentChar;
     nextChar();
-    std::stringstream ss;
-    ss << prev << m_currentChar;
-    return ss.str();
+    return span(m_tokenStart, 2);
+}
+
+std::string_view Lexer::span(size_t start, size_t length) const
+{
+    return std::string_view(m_inputBuffer + start, length);
+}
+
+std::string_view Lexer::currentSpan(size_t length) const
+{
+    return span(m_currentPos, length);
+}
+
+size_t Lexer::scanFrom(Scanner scanner, size_t pos, bool keep)
+{
+    size_t end = scanner(m_inputBuffer, pos, m_bufferLength);
+
+    // When streaming, a run that reaches the end of the window may carry on
+    // into the next chunk
+    while (end >= m_bufferLength && m_fd >= 0)
+    {
+        // Characters that are being skipped don't need to stay in the window
+        if (!keep)
+        {
+            m_currentPos = end;
+            m_tokenStart = end;
+        }
+
+        // The window is moved even when there is nothing left to read, so the
+        // end of the run has to move with it either way
+        size_t discarded;
+        if (!refill(discarded))
+        {
+            end -= discarded;
+            break;
+        }
+
+        end = scanner(m_inputBuffer, end - discarded, m_bufferLength);
+    }
+
+    return end;
+}
+
+bool Lexer::refill(size_t& discarded)
+{
+    discarded = 0;
+    if (m_fd < 0 || m_streamEnded)
+        return false;
+
+    // Drop everything before the start of the current token by moving the
+    // rest of the window to the front
+    discarded = m_tokenStart;
+    size_t kept = m_bufferLength - discarded;
+    if (discarded > 0)
+        std::memmove(m_window.data(), m_window.data() + discarded, kept);
+    m_currentPos -= discarded;
+    m_tokenStart = 0;
+
+    // Make room for another chunk. The window only grows past the chunk size
+    // when a single token is longer than a chunk.
+    if (m_window.size() < kept + m_chunkSize)
+        m_window.resize(kept + m_chunkSize);
+
+    ssize_t count;
+    do
+    {
+        count = ::read(m_fd, m_window.data() + kept, m_chunkSize);
+    } while (count < 0 && errno == EINTR);
+
+    if (count < 0)
+    {
+        std::string msg = "Failed to read the input.";
+        abort(msg);
+    }
+
+    m_inputBuffer = m_window.data();
+    m_bufferLength = kept + static_cast<size_t>(count);
+
+    if (count == 0)
+    {
+        m_streamEnded = true;
+        return false;
+    }
+
+    return true;
+}
+
+Token Lexer::keepLexeme(Token token)
+{
+    // Only lexemes inside of the window need to be copied
+    std::string_view lexeme = token.lexeme();
+    if (lexeme.data() < m_window.data() 
+        || lexeme.data() >= m_window.data() + m_window.size())
+        return token;
+
+    std::string& slot = m_lexemeSlots[m_nextSlot];
+    m_nextSlot = (m_nextSlot + 1) % LEXEME_SLOTS;
+    slot.assign(lexeme.data(), lexeme.size());
+
+    if (Token::isKind(token, T_NUM))
+        return Token(slot, token.value(), token.overflows());
+    return Token(slot, token.type());
 }
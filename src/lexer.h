@@ -12,9 +12,14 @@ Definitions for the lexer/tokenizer.
 
 #include <cstddef>
 #include <fstream>
+#include <memory>
+#include <array>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "source.h"
 #include "token.h"
 #include "token_type.h"
 
@@ -22,6 +27,13 @@ Definitions for the lexer/tokenizer.
 // and printing the debug output (if enabled).
 #define TOKEN(lexeme, type) token = Token(lexeme, type); print_lex(token)
 
+// Thrown when the lexer finds an error in its input
+class LexError : public std::runtime_error
+{
+public:
+    LexError(const std::string& msg) : std::runtime_error(msg) {}
+};
+
 /*
 The `Lexer` is responsible for reading a text file of program
 code and converting it into the appropriate tokens, which are
@@ -30,12 +42,35 @@ later used by the parser.
 class Lexer
 {
 public:
-    // Creates a new parser instance from an input file
+    // Creates a new lexer instance from an input file. The file is read into
+    // memory once.
     Lexer(std::ifstream& file);
 
+    // Creates a new lexer instance that reads directly from a source buffer,
+    // such as a memory mapped file
+    Lexer(std::shared_ptr<SourceBuffer> source);
+
+    // Creates a new lexer instance that reads the characters in [start, end)
+    // of a source buffer, as if they were the whole input. Token lexemes
+    // still point into the source buffer.
+    Lexer(std::shared_ptr<SourceBuffer> source, size_t start, size_t end);
+
+    // Creates a new lexer instance that streams its input from a file
+    // descriptor, such as stdin or a pipe. The input is read in chunks of
+    // `chunkSize` bytes as it is needed, so tokens are produced before the
+    // whole input has been read. Only the current chunk and the token being
+    // lexed are held in memory. The descriptor isn't closed by the lexer.
+    Lexer(int fd, size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+    // The chunk size used for streamed input
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
     // Gets the next character from the buffer
     void nextChar();
 
+    // Moves to a given position in the buffer and loads the character there
+    void advanceTo(size_t pos);
+
 
     // Gets the next token in the input
     Token getToken();
@@ -45,39 +80,118 @@ public:
     // within the buffer
     char peek();
 
-    // Gets called when an invalid token has been encountered. Displays an error
-    // message and aborts the program.
+    // Gets the start of the input buffer that token lexemes point into. This
+    // isn't meaningful for streamed input, where the buffer is a window that
+    // moves through the input.
+    const char* buffer() const { return m_inputBuffer; }
+
+    // Checks if this lexer is streaming its input
+    bool isStreaming() const { return m_fd >= 0; }
+
+    // Gets the size of the input buffer
+    size_t bufferLength() const { return m_bufferLength; }
+
+    // Checks if the input is empty, before any tokens have been lexed. There
+    // is nothing to compile in an empty input, which callers usually want to
+    // treat differently from an error.
+    bool isEmpty() const { return m_bufferLength == 0; }
+
+    // Gets called when an invalid token has been encountered. Aborts lexing
+    // by throwing a `LexError`.
     // std::string msg -> The message to display in the error message.
     void abort(std::string& msg) const;
 
 private:
+    // The source the input buffer belongs to. This keeps the buffer alive
+    // for as long as the lexer is reading from it.
+    std::shared_ptr<SourceBuffer> m_source;
+
     // The input buffer
-    std::vector<char> m_inputBuffer;
+    const char* m_inputBuffer;
 
     // The size of the input buffer
     size_t m_bufferLength;
 
     // The current position in the input buffer
-    int m_currentPos;
+    size_t m_currentPos;
 
     // The current character
     char m_currentChar;
 
+    // The position in the input buffer where the current token starts
+    size_t m_tokenStart = 0;
+
+    // The descriptor streamed input is read from, or -1 when the whole input
+    // is already in memory
+    int m_fd = -1;
+
+    // The number of bytes read from the descriptor at a time
+    size_t m_chunkSize = 0;
+
+    // Set once the descriptor has no more input
+    bool m_streamEnded = false;
+
+    // The window of streamed input. This holds the token being lexed along
+    // with the most recently read chunk.
+    std::vector<char> m_window;
+
+    // The number of streamed tokens that keep a valid lexeme at once. The
+    // parser holds on to at most a couple of tokens while it reads ahead.
+    static const size_t LEXEME_SLOTS = 4;
+
+    // Copies of the lexemes of the most recent streamed tokens. These are
+    // reused in turn, so they stop allocating once they have grown to fit.
+    std::array<std::string, LEXEME_SLOTS> m_lexemeSlots;
+
+    // The next lexeme slot to use
+    size_t m_nextSlot = 0;
+
+    // The signature shared by the bulk character scanners in `scan.h`
+    typedef size_t (*Scanner)(const char*, size_t, size_t);
+
+    // Runs a bulk scanner from a given position. When streaming, the scan 
+    // continues into new chunks as needed. `keep` is set when the scanned
+    // characters are part of the current token and must stay in the window.
+    size_t scanFrom(Scanner scanner, size_t pos, bool keep);
+
+    // Reads the next chunk of streamed input into the window. Everything
+    // before the start of the current token is discarded first, and the
+    // number of bytes discarded is returned in `discarded` so positions can
+    // be adjusted. Returns false when there is no more input.
+    bool refill(size_t& discarded);
+
+    // Copies the lexeme of a streamed token out of the window
+    Token keepLexeme(Token token);
+
     // Skips whitespace characters in the input buffer
     void skipWhitespace();
 
     // Skips comments in the input buffer
     void skipComments();
 
+    // Looks up the token type of a character on its own
+    static TokenType singleToken(char c);
+
+    // Looks up the token type of a character followed by a '='
+    static TokenType pairToken(char c);
+
     // Checks if a given string is a keyword. If it is, this will return a
     // T_{KEYWORD} token, otherwise it returns a T_IDENTIFIER token
-    Token checkIfKeyword(std::string& lexeme);
+    Token checkIfKeyword(std::string_view lexeme);
 
     // This is a helper that gets the current character and the next character
-    // as a string. This also advances our position in the buffer.
+    // as a span of the input. This also advances our position in the buffer.
     // This is used for building multi-character operators (i.e. ==, >=, etc.)
     // to avoid having to write the same few lines of code each time.
-    std::string getTwoCharToken();
+    std::string_view getTwoCharToken();
+
+    // Gets a view of `length` characters of the input buffer beginning at
+    // `start`. Tokens refer to the input through these views rather than
+    // copying their lexemes.
+    std::string_view span(size_t start, size_t length) const;
+
+    // Gets a view of `length` characters beginning at the current position
+    std::string_view currentSpan(size_t length) const;
 };
 
 #endif
@@ -0,0 +1,216 @@
+/*
+File: loop_unroller.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `LoopUnroller` class.
+*/
+
+
+#include "loop_unroller.h"
+
+#include <string>
+
+#include "optimizer.h"
+#include "token_type.h"
+
+LoopUnroller::LoopUnroller(Program& program, size_t factor)
+    : m_program(program), m_ast(program.ast), m_factor(factor)
+{
+}
+
+void LoopUnroller::run()
+{
+    findLoopAssigns(m_ast, m_ast.root(), m_loopAssigns);
+    m_budget = m_ast.size();
+    if (m_budget < MIN_BUDGET)
+        m_budget = MIN_BUDGET;
+
+    // Find every dotimes loop. A loop is always found before the loops
+    // inside it.
+    m_work.push_back(m_ast.root());
+    while (!m_work.empty())
+    {
+        NodeId id = m_work.back();
+        m_work.pop_back();
+        if (id == NO_NODE)
+            continue;
+
+        const Node& node = m_ast[id];
+        m_work.push_back(node.next);
+        if (node.kind == N_IF)
+        {
+            m_work.push_back(node.b);
+            if (node.flags & F_HAS_ELSE)
+                m_work.push_back(node.c);
+        }
+        else if (node.kind == N_WHILE || node.kind == N_DOTIMES)
+        {
+            if (node.kind == N_DOTIMES)
+                m_loops.push_back(id);
+            m_work.push_back(node.b);
+        }
+    }
+
+    // Lower the loops inside others first. Each loop keeps its node, so the
+    // loops around it are still found where they were.
+    for (auto loop = m_loops.rbegin(); loop != m_loops.rend(); ++loop)
+    {
+        const Node& count = m_ast[m_ast[*loop].a];
+        if (count.kind == N_NUM && static_cast<int>(count.a) > 0)
+        {
+            unroll(*loop, static_cast<int>(count.a));
+        }
+        else if (count.kind == N_VAR)
+        {
+            bool assigned = false;
+            for (SymbolId symbol : m_loopAssigns[*loop])
+                assigned = assigned || symbol == count.a;
+            if (!assigned)
+                snapshot(*loop, count.a);
+        }
+    }
+}
+
+void LoopUnroller::unroll(NodeId loop, int count)
+{
+    Node node = m_ast[loop];
+    if (node.b == NO_NODE)
+        return;
+
+    size_t size = countBody(node.b, MAX_UNROLLED_NODES);
+    if (count <= MAX_FULL_UNROLL && fits(size, count - 1))
+    {
+        // The loop's node is taken over by the first statement of the body,
+        // so the copies keep the loop's place in its block
+        NodeId last = lastOf(node.b);
+        NodeId copiesLast = NO_NODE;
+        NodeId copies = copyBody(node.b, count - 1, copiesLast);
+        if (copies != NO_NODE)
+        {
+            m_ast[last].next = copies;
+            last = copiesLast;
+        }
+        m_ast[last].next = node.next;
+        m_ast[loop] = m_ast[node.b];
+        return;
+    }
+
+    if (m_factor < 2 || static_cast<size_t>(count) < m_factor)
+        return;
+
+    size_t remainder = count % m_factor;
+    if (!fits(size, m_factor - 1 + remainder))
+        return;
+
+    // Each pass runs the body `m_factor` times, and the passes left over
+    // run after the loop
+    NodeId remainderLast = NO_NODE;
+    NodeId remainderFirst = copyBody(node.b, remainder, remainderLast);
+    NodeId extraLast = NO_NODE;
+    NodeId extra = copyBody(node.b, m_factor - 1, extraLast);
+    m_ast[lastOf(node.b)].next = extra;
+
+    NodeId passes = m_ast.add(N_NUM, static_cast<uint32_t>(count / m_factor));
+    m_ast[loop].a = passes;
+    if (remainderFirst != NO_NODE)
+    {
+        m_ast[remainderLast].next = node.next;
+        m_ast[loop].next = remainderFirst;
+    }
+}
+
+void LoopUnroller::snapshot(NodeId loop, SymbolId count)
+{
+    // The body ends by counting the temporary down
+    SymbolId temporary = addTemporary();
+    Node node = m_ast[loop];
+    NodeId left = m_ast.add(N_VAR, temporary);
+    NodeId step = m_ast.add(N_ASSIGN, temporary,
+        m_ast.addBinary(T_MINUS, left, m_ast.add(N_NUM, 1)));
+    NodeId body = node.b;
+    if (body == NO_NODE)
+        body = step;
+    else
+        m_ast[lastOf(body)].next = step;
+
+    NodeId test = m_ast.addBinary(T_GT, m_ast.add(N_VAR, temporary),
+        m_ast.add(N_NUM, 0));
+    NodeId whileLoop = m_ast.add(N_WHILE, test, body);
+    m_ast[whileLoop].next = node.next;
+
+    // The loop's node becomes the copy of the count, followed by the while
+    // loop
+    NodeId value = m_ast.add(N_VAR, count);
+    Node& copy = m_ast[loop];
+    copy.kind = N_ASSIGN;
+    copy.flags = 0;
+    copy.op = 0;
+    copy.a = temporary;
+    copy.b = value;
+    copy.c = 0;
+    copy.next = whileLoop;
+}
+
+bool LoopUnroller::fits(size_t bodySize, size_t copies)
+{
+    if (copies >= MAX_UNROLLED_NODES
+        || bodySize * (copies + 1) > MAX_UNROLLED_NODES
+        || bodySize * copies > m_budget)
+        return false;
+
+    m_budget -= bodySize * copies;
+    return true;
+}
+
+size_t LoopUnroller::countBody(NodeId first, size_t limit) const
+{
+    size_t count = 0;
+    for (NodeId id = first; id != NO_NODE && count <= limit;
+        id = m_ast[id].next)
+        count += countNodes(m_ast, id, limit);
+    return count;
+}
+
+NodeId LoopUnroller::copyBody(NodeId first, size_t copies, NodeId& last)
+{
+    // Find the statements to copy before any are added after them
+    m_statements.clear();
+    for (NodeId id = first; id != NO_NODE; id = m_ast[id].next)
+        m_statements.push_back(id);
+
+    NodeId head = NO_NODE;
+    last = NO_NODE;
+    for (size_t copy = 0; copy < copies; copy++)
+    {
+        for (NodeId statement : m_statements)
+        {
+            NodeId cloned = cloneTree(m_ast, statement);
+            if (head == NO_NODE)
+                head = cloned;
+            else
+                m_ast[last].next = cloned;
+            last = cloned;
+        }
+    }
+    return head;
+}
+
+NodeId LoopUnroller::lastOf(NodeId first) const
+{
+    NodeId last = first;
+    while (m_ast[last].next != NO_NODE)
+        last = m_ast[last].next;
+    return last;
+}
+
+SymbolId LoopUnroller::addTemporary()
+{
+    std::string name;
+    do
+    {
+        name = "t_dotimes_" + std::to_string(m_nextTemporary++);
+    } while (m_program.symbols.find(name) != SymbolTable::NO_SYMBOL);
+
+    return m_program.symbols.add(name);
+}
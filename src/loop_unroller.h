@@ -0,0 +1,113 @@
+/*
+File: loop_unroller.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the dotimes unrolling pass.
+*/
+
+
+#ifndef __LOOP_UNROLLER_H__
+#define __LOOP_UNROLLER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+#include "symbol_table.h"
+
+/*
+The `LoopUnroller` class lowers `dotimes` loops based on what is known about
+their counts. Every pass through a `dotimes` loop runs the same statements,
+since the loop's counter can't be read, so its body can be copied freely:
+
+* A loop with a small number for its count is replaced by that many copies
+  of its body.
+* A loop with a larger number for its count runs `factor` copies of its body
+  on each pass, and `count / factor` passes. The `count % factor` passes left
+  over are known when compiling, and are fewer than `factor`, so they are
+  copied in after the loop rather than left in a loop of their own.
+* A loop with a variable for its count that the loop never assigns copies
+  the count into a temporary once, and counts that down to 0:
+
+      t_dotimes_0 = n; while (t_dotimes_0 > 0) { ...; t_dotimes_0 = t_dotimes_0 - 1; }
+
+  A loop that assigns its count is left alone, since the generated code reads
+  the count again before every pass.
+
+Loops inside others are lowered first, so an outer loop copies bodies that
+are already unrolled. A loop's copies can have at most `MAX_UNROLLED_NODES`
+nodes between them, and the copies made across the whole program can't add
+more nodes than the program had (or `MIN_BUDGET` nodes, for small programs).
+*/
+class LoopUnroller
+{
+public:
+    // `factor` is the number of copies of the body each pass through a
+    // partly unrolled loop runs. A factor of 1 leaves large counts alone.
+    LoopUnroller(Program& program, size_t factor);
+
+    // Runs the pass
+    void run();
+
+private:
+    // The largest count of a loop that is unrolled completely
+    static const int MAX_FULL_UNROLL = 16;
+
+    // The most nodes the copies of one loop's body can have
+    static const size_t MAX_UNROLLED_NODES = 512;
+
+    // The fewest nodes the copies are allowed to add
+    static const size_t MIN_BUDGET = 4096;
+
+    Program& m_program;
+    Ast& m_ast;
+    size_t m_factor;
+
+    // The variables assigned anywhere in each loop
+    std::unordered_map<NodeId, std::vector<SymbolId>> m_loopAssigns;
+
+    // The number of nodes the copies can still add
+    size_t m_budget = 0;
+
+    // The `dotimes` loops in the order they were found, outer loops first
+    std::vector<NodeId> m_loops;
+
+    // The statement lists left to walk
+    std::vector<NodeId> m_work;
+
+    // The statements of the body being copied
+    std::vector<NodeId> m_statements;
+
+    // The number to give the next temporary variable
+    uint32_t m_nextTemporary = 0;
+
+    // Lowers a loop with a number for its count
+    void unroll(NodeId loop, int count);
+
+    // Lowers a loop with a variable for its count
+    void snapshot(NodeId loop, SymbolId count);
+
+    // Checks that `copies` copies of a body fit in the limits, and takes
+    // them out of the budget if they do
+    bool fits(size_t bodySize, size_t copies);
+
+    // Counts the nodes in a list of statements, stopping early once there
+    // are more than `limit`
+    size_t countBody(NodeId first, size_t limit) const;
+
+    // Makes `copies` copies of a list of statements, linked one after
+    // another. Returns the first statement of the copies, or NO_NODE if
+    // there are none, and sets `last` to the last one.
+    NodeId copyBody(NodeId first, size_t copies, NodeId& last);
+
+    // Finds the last statement of a list
+    NodeId lastOf(NodeId first) const;
+
+    // Adds a temporary variable with a name that isn't taken
+    SymbolId addTemporary();
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+File: loop_unswitcher.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `LoopUnswitcher` class.
+*/
+
+
+#include "loop_unswitcher.h"
+
+#include "optimizer.h"
+
+LoopUnswitcher::LoopUnswitcher(Program& program)
+    : m_program(program), m_ast(program.ast)
+{
+}
+
+void LoopUnswitcher::run()
+{
+    findLoopAssigns(m_ast, m_ast.root(), m_loopAssigns);
+    m_assigned.assign(m_program.symbols.size(), false);
+    m_budget = m_ast.size() / 2;
+    if (m_budget < MIN_BUDGET)
+        m_budget = MIN_BUDGET;
+
+    // Walk every statement. A loop that is unswitched becomes an if, and
+    // its copies are walked in its place, so they can be unswitched again.
+    m_work.push_back(m_ast.root());
+    while (!m_work.empty())
+    {
+        NodeId id = m_work.back();
+        m_work.pop_back();
+        if (id == NO_NODE)
+            continue;
+
+        m_work.push_back(m_ast[id].next);
+        NodeKind kind = m_ast[id].kind;
+        if ((kind == N_WHILE || kind == N_DOTIMES) && unswitch(id))
+            kind = N_IF;
+
+        const Node& node = m_ast[id];
+        if (kind == N_IF)
+        {
+            m_work.push_back(node.b);
+            if (node.flags & F_HAS_ELSE)
+                m_work.push_back(node.c);
+        }
+        else if (kind == N_WHILE || kind == N_DOTIMES)
+        {
+            m_work.push_back(node.b);
+        }
+    }
+}
+
+bool LoopUnswitcher::unswitch(NodeId loop)
+{
+    // Check the size first, since it stops early on big loops
+    size_t size = countNodes(m_ast, loop, MAX_LOOP_NODES);
+    if (size > MAX_LOOP_NODES || size * 2 > m_budget)
+        return false;
+
+    NodeId branch = findInvariantIf(loop);
+    if (branch == NO_NODE)
+        return false;
+    m_budget -= size * 2;
+
+    // Copy the loop once with the if's condition true and once with it
+    // false. The original loop's nodes are left unused.
+    NodeId condition = m_ast[branch].a;
+    NodeId whenTrue = m_ast.add(N_NUM, 1);
+    NodeId whenFalse = m_ast.add(N_NUM, 0);
+    m_ast[branch].a = whenTrue;
+    NodeId trueLoop = cloneTree(m_ast, loop);
+    m_ast[branch].a = whenFalse;
+    NodeId falseLoop = cloneTree(m_ast, loop);
+    m_ast[branch].a = condition;
+    NodeId test = cloneTree(m_ast, condition);
+
+    // The loop's node becomes the if, so it keeps its place in its block
+    Node& node = m_ast[loop];
+    node.kind = N_IF;
+    node.flags = F_HAS_ELSE;
+    node.op = 0;
+    node.a = test;
+    node.b = trueLoop;
+    node.c = falseLoop;
+
+    findLoopAssigns(m_ast, trueLoop, m_loopAssigns);
+    findLoopAssigns(m_ast, falseLoop, m_loopAssigns);
+    return true;
+}
+
+NodeId LoopUnswitcher::findInvariantIf(NodeId loop)
+{
+    for (SymbolId symbol : m_loopAssigns[loop])
+        m_assigned[symbol] = true;
+
+    // Search every statement in the loop's body, including in the loops
+    // inside it
+    NodeId found = NO_NODE;
+    m_statementWork.clear();
+    m_statementWork.push_back(m_ast[loop].b);
+    while (!m_statementWork.empty() && found == NO_NODE)
+    {
+        NodeId id = m_statementWork.back();
+        m_statementWork.pop_back();
+        if (id == NO_NODE)
+            continue;
+
+        const Node& node = m_ast[id];
+        m_statementWork.push_back(node.next);
+        if (node.kind == N_IF)
+        {
+            if (m_ast[node.a].kind != N_NUM && isInvariant(node.a))
+                found = id;
+            m_statementWork.push_back(node.b);
+            if (node.flags & F_HAS_ELSE)
+                m_statementWork.push_back(node.c);
+        }
+        else if (node.kind == N_WHILE || node.kind == N_DOTIMES)
+        {
+            m_statementWork.push_back(node.b);
+        }
+    }
+
+    for (SymbolId symbol : m_loopAssigns[loop])
+        m_assigned[symbol] = false;
+    return found;
+}
+
+bool LoopUnswitcher::isInvariant(NodeId condition)
+{
+    m_expressionWork.clear();
+    m_expressionWork.push_back(condition);
+    while (!m_expressionWork.empty())
+    {
+        const Node& node = m_ast[m_expressionWork.back()];
+        m_expressionWork.pop_back();
+        switch (node.kind)
+        {
+            case N_VAR:
+                if (m_assigned[node.a])
+                    return false;
+                break;
+            case N_BINARY:
+                m_expressionWork.push_back(node.b);
+                m_expressionWork.push_back(node.a);
+                break;
+            case N_NOT:
+            case N_PAREN:
+                m_expressionWork.push_back(node.a);
+                break;
+            default:
+                break;
+        }
+    }
+    return true;
+}
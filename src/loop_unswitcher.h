@@ -0,0 +1,91 @@
+/*
+File: loop_unswitcher.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the loop unswitching pass.
+*/
+
+
+#ifndef __LOOP_UNSWITCHER_H__
+#define __LOOP_UNSWITCHER_H__
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+#include "symbol_table.h"
+
+/*
+The `LoopUnswitcher` class moves ifs whose conditions a loop never changes
+out of the loop. The loop is copied into both branches of a new if around
+it, and each copy's inner if has its condition replaced with the value that
+branch knows it has, so dead branch elimination can splice in the block that
+is taken:
+
+    while (i < n) { if (verbose) { print(i); } i = i + 1; }
+
+becomes
+
+    if (verbose) { while (i < n) { print(i); i = i + 1; } }
+    else { while (i < n) { i = i + 1; } }
+
+A condition can't have side effects, so testing it once before the loop,
+even if the loop never runs, does the same as testing it on every pass.
+Each copy is checked again, so a loop with several such ifs is unswitched
+on each of them in turn.
+
+Every unswitch doubles the size of a loop, so it is limited. Only loops with
+at most `MAX_LOOP_NODES` nodes are unswitched, and the copies made across
+the whole program can't add more than half of the program's size (or
+`MIN_BUDGET` nodes, for small programs).
+*/
+class LoopUnswitcher
+{
+public:
+    LoopUnswitcher(Program& program);
+
+    // Runs the pass
+    void run();
+
+private:
+    // The most nodes a loop can have and still be unswitched
+    static const size_t MAX_LOOP_NODES = 256;
+
+    // The fewest nodes the copies are allowed to add
+    static const size_t MIN_BUDGET = 1024;
+
+    Program& m_program;
+    Ast& m_ast;
+
+    // The variables assigned anywhere in each loop
+    std::unordered_map<NodeId, std::vector<SymbolId>> m_loopAssigns;
+
+    // Marks the variables assigned by the loop being looked at
+    std::vector<bool> m_assigned;
+
+    // The number of nodes the copies can still add
+    size_t m_budget = 0;
+
+    // The statement lists left to walk
+    std::vector<NodeId> m_work;
+
+    // Scratch space for searching loop bodies and conditions
+    std::vector<NodeId> m_statementWork;
+    std::vector<NodeId> m_expressionWork;
+
+    // Unswitches a loop if it has an if worth moving out and fits in the
+    // budget. Returns true if it was, in which case the loop's node is now
+    // the if around the copies.
+    bool unswitch(NodeId loop);
+
+    // Finds an if in a loop whose condition the loop doesn't change, or
+    // returns NO_NODE
+    NodeId findInvariantIf(NodeId loop);
+
+    // Checks if a condition only uses variables the loop doesn't assign
+    bool isInvariant(NodeId condition);
+};
+
+#endif
@@ -7,43 +7,264 @@ The main entry point into the program.
 */
 
 
-#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdlib>
 #include <iostream>
-#include <memory>
+#include <string>
+#include <string_view>
+
+#include "compiler.h"
+#include "source.h"
+
+// Prints what went wrong with a compile and returns the exit code for it
+static int report(const CompileResult& result, const char* inputPath,
+    const FileSink& output)
+{
+    if (result.status == COMPILE_EMPTY_INPUT)
+    {
+        std::cerr << "Empty input file provided. Nothing to do." << std::endl;
+        return 0;
+    }
+
+    if (result.status == COMPILE_OK)
+        return 0;
 
-#include "generator.h"
-#include "lexer.h"
-#include "parser.h"
+    const Diagnostic& diagnostic = result.diagnostics.front();
+    switch (diagnostic.kind)
+    {
+        case D_LEXING:
+            std::cerr << "Lexing error: " << diagnostic.message << std::endl;
+            std::cerr << "Aborting..." << std::endl;
+            return EXIT_FAILURE;
+        case D_PARSING:
+            std::cerr << "Parsing error on token: " << diagnostic.token 
+                << std::endl;
+            std::cerr << "\tError: " << diagnostic.message << std::endl;
+            std::cerr << "Aborting..." << std::endl;
+            return -1;
+        case D_INPUT:
+            std::cerr << diagnostic.message << ": " << inputPath << std::endl;
+            return -1;
+        case D_FORMAT:
+            std::cerr << "Invalid precompiled program: " << diagnostic.message
+                << std::endl;
+            std::cerr << "Aborting..." << std::endl;
+            return -1;
+        default:
+            std::cerr << diagnostic.message << " " << output.path() 
+                << std::endl;
+            std::cerr << "Aborting..." << std::endl;
+            return -1;
+    }
+}
 
 int main(int argc, char* argv[])
 {
-    // Check that an argument was supplied
-    if (argc < 2)
+    // Read the command line. Anything that isn't an option is the input file.
+    const char* inputPath = nullptr;
+    const char* outputPath = nullptr;
+    bool prelex = false;
+    bool stream = false;
+    bool pipeline = false;
+    bool parallel = false;
+    bool checkOnly = false;
+    bool emitBbc = false;
+    bool fromBbc = false;
+    bool optimizeProgram = false;
+    size_t threads = 0;
+    size_t unrollFactor = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o")
+        {
+            // Write the generated code somewhere other than out.c
+            if (++i == argc)
+            {
+                std::cerr << "-o must be followed by an output file." 
+                    << std::endl;
+                return -1;
+            }
+            outputPath = argv[i];
+        }
+        else if (arg == "-O")
+        {
+            // Optimize the program before generating code
+            optimizeProgram = true;
+        }
+        else if (arg == "--prelex")
+        {
+            // Lex the whole input before parsing starts
+            prelex = true;
+        }
+        else if (arg == "--pipeline")
+        {
+            // Lex on a separate thread while parsing
+            pipeline = true;
+        }
+        else if (arg == "--parallel" || arg.compare(0, 11, "--parallel=") == 0)
+        {
+            // Parse pieces of the input on several threads. The number of
+            // threads defaults to the number of hardware threads.
+            parallel = true;
+            if (arg.size() > 11)
+                threads = std::strtoul(arg.c_str() + 11, nullptr, 10);
+        }
+        else if (arg.compare(0, 9, "--unroll=") == 0)
+        {
+            // Set how many copies of its body a large dotimes loop runs on
+            // each pass when optimizing
+            unrollFactor = std::strtoul(arg.c_str() + 9, nullptr, 10);
+            if (unrollFactor == 0)
+            {
+                std::cerr << "--unroll= must be followed by a number above 0."
+                    << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--check")
+        {
+            // Only check that the input is valid, without generating code
+            checkOnly = true;
+        }
+        else if (arg == "--emit-bbc")
+        {
+            // Write the parsed program instead of C code
+            emitBbc = true;
+        }
+        else if (arg == "--from-bbc")
+        {
+            // The input is a program written with --emit-bbc
+            fromBbc = true;
+        }
+        else if (arg == "--stream")
+        {
+            // Read the input in chunks as it is lexed
+            stream = true;
+        }
+        else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0)
+        {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return -1;
+        }
+        else
+        {
+            inputPath = argv[i];
+        }
+    }
+
+    // Check that an input file was supplied
+    if (inputPath == nullptr)
     {
         std::cerr << "You must supply an input file to be compiled." 
             << std::endl;
         return -1;
     }
 
-    //  Check that the supplied input file exists
-    std::ifstream inputFile;
-    inputFile.open(argv[1]);
-    
-    if (!inputFile) 
+    // An input of `-` is read from stdin. Stdin may be a pipe, so it is
+    // always streamed.
+    bool fromStdin = std::string(inputPath) == "-";
+    if (fromStdin)
+        stream = true;
+
+    // A token stream refers to its tokens by their offsets in the input, so it
+    // needs the whole input in memory
+    if (stream && prelex)
     {
-        // The input file does not exist, can't continue
-        std::cerr << "Cannot access the input file: " << argv[1] << std::endl;
+        std::cerr << "--prelex can't be used with streamed input." << std::endl;
         return -1;
     }
 
-    // The input file exits, start the compilation process
-    auto lexer = std::make_shared<Lexer>(inputFile);
-    auto generator = std::make_shared<Generator>("out.c");
-    Parser* parser = new Parser(lexer, generator);
-    parser->parse();
+    // Pipelined tokens also point into the input, which a streaming lexer
+    // reuses as it goes
+    if (pipeline && (stream || prelex))
+    {
+        std::cerr << "--pipeline can't be used with --prelex or streamed input." 
+            << std::endl;
+        return -1;
+    }
 
-    // Close the input file
-    inputFile.close();
+    // The parallel front end splits the input up, so it needs all of it in
+    // memory and lexes it itself
+    if (parallel && (stream || prelex || pipeline))
+    {
+        std::cerr << "--parallel can't be used with --prelex, --pipeline or "
+            "streamed input." << std::endl;
+        return -1;
+    }
+
+    // A precompiled program has already been lexed and parsed
+    if (fromBbc && (stream || prelex || pipeline || parallel || checkOnly))
+    {
+        std::cerr << "--from-bbc can't be used with --check, --prelex, "
+            "--pipeline, --parallel or streamed input." << std::endl;
+        return -1;
+    }
+
+    if (outputPath == nullptr)
+        outputPath = emitBbc ? "out.bbc" : "out.c";
+
+    CompileOptions options;
+    options.threads = threads;
+    options.optimize = optimizeProgram;
+    if (unrollFactor != 0)
+        options.unrollFactor = unrollFactor;
+    if (emitBbc)
+        options.format = OUTPUT_BBC;
+    if (prelex)
+        options.frontEnd = FRONT_END_PRELEX;
+    else if (pipeline)
+        options.frontEnd = FRONT_END_PIPELINE;
+    else if (parallel)
+        options.frontEnd = FRONT_END_PARALLEL;
+
+    // The output file is only created once the input is known to have
+    // something in it, and never when only checking the input
+    FileSink output(outputPath);
+    CompileResult result;
+    if (fromBbc)
+    {
+        // The precompiled program is mapped and used in place
+        result = compileBbc(inputPath, options, output);
+    }
+    else if (stream)
+    {
+        // Check that the supplied input file exists
+        int inputFd = fromStdin ? STDIN_FILENO : open(inputPath, O_RDONLY);
+        if (inputFd < 0)
+        {
+            std::cerr << "Cannot access the input file: " << inputPath 
+                << std::endl;
+            return -1;
+        }
+
+        result = checkOnly ? checkStream(inputFd, options)
+            : compileStream(inputFd, options, output);
+
+        // Close the input file
+        if (!fromStdin)
+            close(inputFd);
+    }
+    else
+    {
+        // Check that the supplied input file exists. The file is memory mapped
+        // so that the lexer can read it in place without copying it.
+        SourceBuffer source(inputPath);
+    
+        if (!source.isOpen()) 
+        {
+            // The input file does not exist, can't continue
+            std::cerr << "Cannot access the input file: " << inputPath 
+                << std::endl;
+            return -1;
+        }
+
+        std::string_view text(source.data(), source.size());
+        result = checkOnly ? check(text, options) 
+            : compile(text, options, output);
+    }
 
-    return 0;
+    return report(result, inputPath, output);
 }
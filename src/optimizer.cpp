@@ -0,0 +1,308 @@
+/*
+File: optimizer.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation of the optimizer's entry point and the helpers
+shared by its passes.
+*/
+
+
+#include "optimizer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+#include "branch_eliminator.h"
+#include "constant_folder.h"
+#include "dead_store_eliminator.h"
+#include "invariant_hoister.h"
+#include "loop_unroller.h"
+#include "loop_unswitcher.h"
+#include "strength_reducer.h"
+#include "token_type.h"
+#include "value_numberer.h"
+
+void optimize(Program& program, size_t unrollFactor)
+{
+    // Folding turns the conditions that are known into numbers, which is
+    // what dead branches are found by
+    ConstantFolder(program).run();
+    BranchEliminator(program).run();
+
+    // Unrolled copies of a loop's body run one after another, so folding
+    // them again can follow values through them
+    LoopUnroller(program, unrollFactor).run();
+    ConstantFolder(program).run();
+    BranchEliminator(program).run();
+
+    // Unswitching replaces the conditions it moves out of loops with
+    // numbers, so the branches are cleaned up before hoisting looks at what
+    // is left in the loops
+    ValueNumberer(program).run();
+    LoopUnswitcher(program).run();
+    BranchEliminator(program).run();
+    InvariantHoister(program).run();
+
+    // Arithmetic is made cheaper once nothing else is left to move around,
+    // so the passes before it see the operators the program was written with
+    StrengthReducer(program).run();
+
+    // Reusing values leaves copies and temporaries that nothing reads,
+    // which dead store elimination then removes. Removing stores can leave
+    // blocks empty, which the branches are cleaned up again for.
+    DeadStoreEliminator(program).run();
+    BranchEliminator(program).run();
+}
+
+bool evaluateBinary(int op, int left, int right, int& result)
+{
+    // Work in 64 bits so that overflow can be caught
+    int64_t l = left;
+    int64_t r = right;
+    int64_t value = 0;
+    switch (op)
+    {
+        case T_PLUS: value = l + r; break;
+        case T_MINUS: value = l - r; break;
+        case T_MUL: value = l * r; break;
+        case T_DIV:
+        case T_MOD:
+            // Dividing by zero, or the smallest int by -1, is left for the
+            // program to do when it runs
+            if (r == 0 || (l == INT_MIN && r == -1))
+                return false;
+            value = op == T_DIV ? l / r : l % r;
+            break;
+        case T_SHL:
+            // Shifting a negative number left, or by more than the width of
+            // an int, isn't defined
+            if (l < 0 || r < 0 || r >= 31)
+                return false;
+            value = l << r;
+            break;
+        case T_SHR:
+            if (r < 0 || r >= 32)
+                return false;
+            value = l >> r;
+            break;
+        case T_BITAND: value = l & r; break;
+        case T_EQEQ: value = l == r; break;
+        case T_NEQ: value = l != r; break;
+        case T_LT: value = l < r; break;
+        case T_GT: value = l > r; break;
+        case T_LTEQ: value = l <= r; break;
+        case T_GTEQ: value = l >= r; break;
+        case T_AND: value = l && r; break;
+        case T_OR: value = l || r; break;
+        default: return false;
+    }
+
+    if (value < INT_MIN || value > INT_MAX)
+        return false;
+
+    result = static_cast<int>(value);
+    return true;
+}
+
+bool isSafeDivisor(const Ast& ast, NodeId id)
+{
+    while (ast[id].kind == N_PAREN)
+        id = ast[id].a;
+    const Node& node = ast[id];
+    int value = static_cast<int>(node.a);
+    return node.kind == N_NUM && value != 0 && value != -1;
+}
+
+void makeNumber(Node& node, int value)
+{
+    node.kind = N_NUM;
+    node.flags = 0;
+    node.op = 0;
+    node.a = static_cast<uint32_t>(value);
+    node.b = 0;
+    node.c = 0;
+}
+
+void findLoopSymbols(const Ast& ast, NodeId first,
+    std::unordered_map<NodeId, std::vector<SymbolId>>& loopSymbols,
+    const SymbolCollector& collect)
+{
+    // Walk the statements, keeping track of the innermost loop. A loop's
+    // variables are added to the loop around it once its body is done.
+    struct FindTask
+    {
+        NodeId id;
+        NodeId loop;
+        bool loopDone;  // Set once the body of the loop `id` is done
+    };
+
+    std::vector<FindTask> work;
+    std::vector<SymbolId> symbols;
+    work.push_back(FindTask{first, NO_NODE, false});
+    while (!work.empty())
+    {
+        FindTask task = work.back();
+        work.pop_back();
+
+        if (task.loopDone)
+        {
+            std::vector<SymbolId>& inner = loopSymbols[task.id];
+            std::sort(inner.begin(), inner.end());
+            inner.erase(std::unique(inner.begin(), inner.end()), inner.end());
+            if (task.loop != NO_NODE)
+            {
+                std::vector<SymbolId>& outer = loopSymbols[task.loop];
+                outer.insert(outer.end(), inner.begin(), inner.end());
+            }
+            continue;
+        }
+
+        if (task.id == NO_NODE)
+            continue;
+
+        const Node& node = ast[task.id];
+        work.push_back(FindTask{node.next, task.loop, false});
+
+        NodeId loop = task.loop;
+        switch (node.kind)
+        {
+            case N_IF:
+                work.push_back(FindTask{node.b, task.loop, false});
+                if (node.flags & F_HAS_ELSE)
+                    work.push_back(FindTask{node.c, task.loop, false});
+                break;
+            case N_WHILE:
+            case N_DOTIMES:
+                loop = task.id;
+                loopSymbols[task.id];
+                work.push_back(FindTask{task.id, task.loop, true});
+                work.push_back(FindTask{node.b, task.id, false});
+                break;
+            default:
+                break;
+        }
+
+        symbols.clear();
+        collect(task.id, symbols);
+        if (loop != NO_NODE)
+        {
+            std::vector<SymbolId>& found = loopSymbols[loop];
+            found.insert(found.end(), symbols.begin(), symbols.end());
+        }
+    }
+}
+
+void findLoopAssigns(const Ast& ast, NodeId first,
+    std::unordered_map<NodeId, std::vector<SymbolId>>& loopAssigns)
+{
+    findLoopSymbols(ast, first, loopAssigns,
+        [&](NodeId id, std::vector<SymbolId>& assigns) {
+            // A declaration without a value doesn't assign anything
+            const Node& node = ast[id];
+            if (node.kind == N_ASSIGN || node.kind == N_READ
+                || (node.kind == N_DECLARE && node.b != NO_NODE))
+                assigns.push_back(node.a);
+        });
+}
+
+// Gets which of the `a`, `b` and `c` fields of a node link to other nodes,
+// as bits 1, 2 and 4
+static int linkFields(const Node& node)
+{
+    switch (node.kind)
+    {
+        case N_DECLARE:
+        case N_ASSIGN:
+            return 2;
+        case N_IF:
+            return 1 | 2 | 4;
+        case N_WHILE:
+        case N_DOTIMES:
+        case N_BINARY:
+            return 1 | 2;
+        case N_PRINT:
+        case N_NOT:
+        case N_PAREN:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+NodeId cloneTree(Ast& ast, NodeId root)
+{
+    // Each task copies the node `from` and links the copy into field `field`
+    // of the copy `into` (0 to 2 for `a` to `c`, 3 for `next`). Links are
+    // kept by node and field rather than by address, since adding nodes can
+    // move the arena.
+    struct CloneTask
+    {
+        NodeId from;
+        NodeId into;
+        int field;
+    };
+
+    NodeId copyRoot = NO_NODE;
+    std::vector<CloneTask> work;
+    work.push_back(CloneTask{root, NO_NODE, 0});
+    while (!work.empty())
+    {
+        CloneTask task = work.back();
+        work.pop_back();
+
+        Node node = ast[task.from];
+        NodeId copy = ast.add(node.kind, node.a, node.b, node.c);
+        ast[copy].flags = node.flags;
+        ast[copy].op = node.op;
+
+        if (task.into == NO_NODE)
+        {
+            copyRoot = copy;
+        }
+        else
+        {
+            Node& into = ast[task.into];
+            uint32_t* fields[] = {&into.a, &into.b, &into.c, &into.next};
+            *fields[task.field] = copy;
+        }
+
+        int links = linkFields(node);
+        uint32_t from[] = {node.a, node.b, node.c};
+        for (int field = 0; field < 3; field++)
+        {
+            if ((links & (1 << field)) && from[field] != NO_NODE)
+                work.push_back(CloneTask{from[field], copy, field});
+        }
+        if (task.into != NO_NODE && node.next != NO_NODE)
+            work.push_back(CloneTask{node.next, copy, 3});
+    }
+
+    return copyRoot;
+}
+
+size_t countNodes(const Ast& ast, NodeId root, size_t limit)
+{
+    size_t count = 0;
+    std::vector<NodeId> work;
+    work.push_back(root);
+    while (!work.empty() && count <= limit)
+    {
+        const Node& node = ast[work.back()];
+        bool isRoot = work.back() == root && count == 0;
+        work.pop_back();
+        count++;
+
+        int links = linkFields(node);
+        uint32_t from[] = {node.a, node.b, node.c};
+        for (int field = 0; field < 3; field++)
+        {
+            if ((links & (1 << field)) && from[field] != NO_NODE)
+                work.push_back(from[field]);
+        }
+        if (!isRoot && node.next != NO_NODE)
+            work.push_back(node.next);
+    }
+    return count;
+}
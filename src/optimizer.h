@@ -0,0 +1,69 @@
+/*
+File: optimizer.h
+Author: Adam Thompson
+Course: CSC 407
+
+The optimizer, which rewrites a parsed program in place before code is
+generated from it. Each pass lives in its own class; `optimize` runs them in
+order. Like the parser and the generator, none of the passes recurse, so
+they can handle programs of any depth.
+*/
+
+
+#ifndef __OPTIMIZER_H__
+#define __OPTIMIZER_H__
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+#include "symbol_table.h"
+
+// Runs every optimization pass over a program. `unrollFactor` is how many
+// times a large dotimes loop's body is copied (see loop_unroller.h).
+void optimize(Program& program, size_t unrollFactor);
+
+// Works out the result of a binary operator the same way C would. Returns
+// false, leaving `result` alone, if C doesn't define the result, such as
+// when dividing by zero or when the arithmetic overflows.
+bool evaluateBinary(int op, int left, int right, int& result);
+
+// Rewrites a node into an N_NUM with the given value. The node's `next`
+// link is kept.
+void makeNumber(Node& node, int value);
+
+// Checks if dividing by an expression can't fail. Only a number other than
+// 0 and -1 (which fails with the smallest int) is known not to.
+bool isSafeDivisor(const Ast& ast, NodeId id);
+
+// Adds the variables a single statement refers to onto the end of a list.
+// The statements inside an if or a loop are given to it separately.
+using SymbolCollector = std::function<void(NodeId, std::vector<SymbolId>&)>;
+
+// Finds the variables referred to anywhere in each loop of a list of
+// statements, including the loops inside them. `collect` is called once for
+// every statement, inside a loop or not, and picks the variables it refers
+// to. The variables of a loop's own statement, such as those in its
+// condition, belong to that loop. Every loop gets an entry, even if it
+// refers to nothing, and each loop's variables are sorted and unique.
+void findLoopSymbols(const Ast& ast, NodeId first,
+    std::unordered_map<NodeId, std::vector<SymbolId>>& loopSymbols,
+    const SymbolCollector& collect);
+
+// Finds the variables assigned anywhere in each loop of a list of
+// statements, including the loops inside them. Every loop gets an entry, even
+// if it assigns nothing.
+void findLoopAssigns(const Ast& ast, NodeId first,
+    std::unordered_map<NodeId, std::vector<SymbolId>>& loopAssigns);
+
+// Copies a statement or expression and everything inside it, but not the
+// statements (or print arguments) after it. Returns the ID of the copy.
+NodeId cloneTree(Ast& ast, NodeId root);
+
+// Counts the nodes `cloneTree` would copy, stopping early once there are
+// more than `limit`
+size_t countNodes(const Ast& ast, NodeId root, size_t limit);
+
+#endif
@@ -0,0 +1,249 @@
+/*
+File: parallel_parser.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `ParallelParser` class.
+*/
+
+
+#include "parallel_parser.h"
+
+#include <algorithm>
+#include <deque>
+#include <string_view>
+
+#include "lexer.h"
+
+ParallelParser::ParallelParser(std::shared_ptr<SourceBuffer> source, 
+    size_t threads, size_t minPieceSize)
+    : m_source(source), m_pool(threads), m_minPieceSize(minPieceSize)
+{
+}
+
+std::shared_ptr<Program> ParallelParser::parse()
+{
+    const char* data = m_source->data();
+    size_t size = m_source->size();
+
+    // Parse every piece on its own. A piece that stops exactly at its end
+    // has ended on a ';' or '}' at the top level.
+    std::vector<size_t> bounds = split();
+    std::vector<Piece> pieces(bounds.size() - 1);
+    for (size_t i = 0; i < pieces.size(); i++)
+    {
+        pieces[i].start = bounds[i];
+        pieces[i].end = bounds[i + 1];
+    }
+
+    m_pool.parallelFor(pieces.size(), [&](size_t i) {
+        std::vector<const char*> stops;
+        if (i + 1 < pieces.size())
+            stops.push_back(data + pieces[i].end);
+        parsePiece(pieces[i], stops);
+    });
+
+    // Validate the pieces in order. Pieces that are parsed again are kept in
+    // a deque so the pointers to them stay valid.
+    auto program = std::make_shared<Program>();
+    std::vector<Piece*> kept;
+    std::deque<Piece> redone;
+    size_t i = 0;
+    while (i < pieces.size())
+    {
+        Piece& piece = pieces[i];
+        bool last = i + 1 == pieces.size();
+        if (piece.parsed && (last || (piece.stopped 
+            && pieces[i + 1].firstType != T_ELSE)))
+        {
+            validate(piece, program->symbols);
+            kept.push_back(&piece);
+            i++;
+            continue;
+        }
+
+        // The guess was wrong. Parse again from the start of this piece,
+        // which is known to be the start of a statement, until we line up 
+        // with the start of a later piece that parsed cleanly.
+        std::vector<const char*> stops;
+        for (size_t j = i + 1; j < pieces.size(); j++)
+            if (pieces[j].parsed)
+                stops.push_back(data + pieces[j].start);
+
+        redone.emplace_back();
+        Piece& again = redone.back();
+        again.start = piece.start;
+        again.end = size;
+        parsePiece(again, stops);
+
+        // This piece runs to the end of the input, so any error in it is real
+        validate(again, program->symbols);
+        kept.push_back(&again);
+
+        if (!again.stopped)
+            break;
+        while (i < pieces.size() && pieces[i].start != again.end)
+            i++;
+    }
+
+    // A program parsed in one piece has its symbols in declaration order
+    // already, since every variable must be declared before it is used. It
+    // can be used as it is.
+    if (kept.size() == 1)
+        return kept[0]->program;
+
+    // Make room for every piece in the whole program
+    Ast& ast = program->ast;
+    for (Piece* piece : kept)
+    {
+        const Ast& from = piece->program->ast;
+        piece->nodeBase = ast.reserve(from.size());
+        piece->stringBase = ast.reserveStrings(from.stringsSize());
+    }
+
+    // Copy the pieces over in parallel
+    m_pool.parallelFor(kept.size(), [&](size_t k) {
+        Piece& piece = *kept[k];
+        ast.relocate(piece.program->ast, piece.nodeBase, piece.stringBase,
+            piece.symbols);
+        piece.program.reset();
+    });
+
+    // Link the statements at the top level of each piece together
+    NodeId last = NO_NODE;
+    for (Piece* piece : kept)
+    {
+        if (piece->lastStatement == NO_NODE)
+            continue;
+
+        NodeId first = piece->firstStatement + piece->nodeBase;
+        if (last == NO_NODE)
+            ast.setRoot(first);
+        else
+            ast[last].next = first;
+        last = piece->lastStatement + piece->nodeBase;
+    }
+
+    return program;
+}
+
+std::vector<size_t> ParallelParser::split() const
+{
+    size_t size = m_source->size();
+
+    // There is nothing to gain from splitting the input for a single thread
+    if (m_pool.size() == 1)
+        return std::vector<size_t>{0, size};
+
+    size_t pieceSize = std::max(m_minPieceSize, 
+        size / (m_pool.size() * PIECES_PER_THREAD));
+
+    std::vector<size_t> bounds;
+    bounds.push_back(0);
+    for (size_t pos = pieceSize; pos < size; )
+    {
+        size_t boundary = findBoundary(pos, std::min(size, pos + pieceSize));
+        if (boundary >= size)
+            break;
+        bounds.push_back(boundary);
+        pos = boundary + pieceSize;
+    }
+    bounds.push_back(size);
+    return bounds;
+}
+
+size_t ParallelParser::findBoundary(size_t from, size_t limit) const
+{
+    const char* data = m_source->data();
+    size_t size = m_source->size();
+
+    size_t first = size;
+    for (size_t i = from; i < size; i++)
+    {
+        if (data[i] != ';' && data[i] != '}')
+            continue;
+
+        if (first == size)
+            first = i + 1;
+
+        // Statements at the top level usually end a line, and the next line
+        // isn't indented. An `else` still belongs to the `if` before it.
+        if (i + 2 < size && data[i + 1] == '\n' && data[i + 2] != ' ' 
+            && data[i + 2] != '\t' && data[i + 2] != '}' 
+            && data[i + 2] != '\n' && data[i + 2] != '\r'
+            && std::string_view(data + i + 2, 
+                std::min<size_t>(4, size - i - 2)) != "else")
+        {
+            return i + 1;
+        }
+
+        if (i >= limit)
+            break;
+    }
+
+    return first;
+}
+
+void ParallelParser::parsePiece(Piece& piece, std::vector<const char*> stops)
+{
+    auto lexer = std::make_shared<Lexer>(m_source, piece.start, piece.end);
+
+    // The parser is kept outside of the try, so the checks it recorded 
+    // before an error can still be made
+    std::unique_ptr<Parser> parser;
+    try
+    {
+        parser = std::make_unique<Parser>(lexer, true, stops);
+        piece.firstType = parser->currentToken().type();
+        piece.program = parser->parse();
+        piece.firstStatement = piece.program->ast.root();
+        piece.lastStatement = parser->lastStatement();
+        piece.parsed = true;
+
+        if (parser->stoppedAt() != nullptr)
+        {
+            piece.stopped = true;
+            piece.end = parser->stoppedAt() - m_source->data();
+        }
+    }
+    catch (const LexError& error)
+    {
+        piece.error = error.what();
+        piece.lexError = true;
+    }
+    catch (const ParseError& error)
+    {
+        piece.error = error.what();
+        piece.errorToken = error.token;
+    }
+
+    if (parser)
+        piece.checks = parser->checks();
+}
+
+void ParallelParser::validate(Piece& piece, SymbolTable& symbols)
+{
+    for (const DeclarationCheck& check : piece.checks)
+    {
+        std::string_view name = check.token.lexeme();
+        bool declared = symbols.find(name) != SymbolTable::NO_SYMBOL;
+        if (declared == check.declares)
+            throw ParseError(check.token, check.message);
+
+        if (check.declares)
+            symbols.add(name);
+    }
+
+    if (!piece.parsed)
+    {
+        if (piece.lexError)
+            throw LexError(piece.error);
+        throw ParseError(piece.errorToken, piece.error.c_str());
+    }
+
+    // Every symbol of the piece has now been declared in the whole program
+    const SymbolTable& local = piece.program->symbols;
+    piece.symbols.resize(local.size());
+    for (SymbolId id = 0; id < local.size(); id++)
+        piece.symbols[id] = symbols.find(local.name(id));
+}
@@ -0,0 +1,130 @@
+/*
+File: parallel_parser.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the parallel front end, which parses pieces of a large
+input on several threads at once.
+*/
+
+
+#ifndef __PARALLEL_PARSER_H__
+#define __PARALLEL_PARSER_H__
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "parser.h"
+#include "source.h"
+#include "symbol_table.h"
+#include "token.h"
+#include "work_pool.h"
+
+/*
+The `ParallelParser` class lexes and parses a large input on a pool of
+threads. It guesses where the statements at the top level of the program
+end, splits the input there, and parses each piece speculatively. Since a 
+piece can't know what the pieces before it declare, its parser records the
+declaration checks it would have made (see `Parser`) rather than making them.
+
+The guesses are then validated in order. A piece is only kept if it parsed
+without an error and ended on a token at the top level, and the next piece 
+doesn't start with an `else` that belongs to it. A guess that lands in a 
+string, a comment or a nested block fails one of these, and the input is
+parsed again from the start of that piece until it lines up with a later
+piece that parsed cleanly. As each piece is kept, its declaration checks
+are made in order against the declarations of the pieces before it, so
+errors are reported exactly as if the input had been parsed in one go.
+Finally, the pieces are copied into one program in parallel.
+*/
+class ParallelParser
+{
+public:
+    // Prepares to parse a source on `threads` threads, counting the calling
+    // thread. A count of 0 uses one thread per hardware thread. Pieces are
+    // at least `minPieceSize` bytes, so small inputs aren't split.
+    ParallelParser(std::shared_ptr<SourceBuffer> source, size_t threads = 0,
+        size_t minPieceSize = DEFAULT_MIN_PIECE_SIZE);
+
+    // The smallest piece the input is split into by default
+    static const size_t DEFAULT_MIN_PIECE_SIZE = 64 * 1024;
+
+    // The number of pieces aimed for per thread, so that a thread that
+    // finishes early can steal work from the others
+    static const size_t PIECES_PER_THREAD = 4;
+
+    // Parses the whole input and returns the program
+    std::shared_ptr<Program> parse();
+
+private:
+    // A piece of the input and the result of parsing it
+    struct Piece
+    {
+        // The range of the input the piece covers. Parsing may stop early,
+        // in which case `end` is moved to where it stopped.
+        size_t start = 0;
+        size_t end = 0;
+
+        // Set if the piece parsed without an error
+        bool parsed = false;
+
+        // Set if the piece stopped at one of the offsets it was given
+        bool stopped = false;
+
+        // The type of the first token of the piece
+        TokenType firstType = T_UNKNOWN;
+
+        // The error that stopped the parse, if any. Lexing errors have no
+        // token.
+        std::string error;
+        bool lexError = false;
+        Token errorToken;
+
+        // The parsed program, and its first and last statements at the top
+        // level
+        std::shared_ptr<Program> program;
+        NodeId firstStatement = NO_NODE;
+        NodeId lastStatement = NO_NODE;
+
+        // The declaration checks left to make, in order
+        std::vector<DeclarationCheck> checks;
+
+        // Maps the piece's symbols to the symbols of the whole program
+        std::vector<SymbolId> symbols;
+
+        // Where the piece's nodes and strings go in the whole program
+        NodeId nodeBase = 0;
+        uint32_t stringBase = 0;
+    };
+
+    // The input being parsed
+    std::shared_ptr<SourceBuffer> m_source;
+
+    // The threads the pieces are parsed on
+    WorkPool m_pool;
+
+    // The smallest piece the input is split into
+    size_t m_minPieceSize;
+
+    // Guesses where to split the input. Returns the offsets of the pieces,
+    // starting with 0 and ending with the size of the input.
+    std::vector<size_t> split() const;
+
+    // Finds a likely end of a statement at the top level, at or after 
+    // `from`. A likely one before `limit` is preferred, otherwise the first
+    // ';' or '}' at all is used. Returns the offset just past it.
+    size_t findBoundary(size_t from, size_t limit) const;
+
+    // Parses a piece speculatively. Parsing stops early at any of `stops`.
+    void parsePiece(Piece& piece, std::vector<const char*> stops);
+
+    // Makes the declaration checks of a piece against the symbols declared
+    // so far, and throws the piece's error if it has one. This throws the
+    // first error, in the order the input would have been parsed in.
+    void validate(Piece& piece, SymbolTable& symbols);
+};
+
+#endif
@@ -0,0 +1,131 @@
+/*
+File: parse_sink.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the sinks the parser builds a program with.
+
+A sink is the parser's back end. The parser is a template over its sink, so
+every call it makes to one is resolved, and usually inlined, when the parser
+is compiled. A sink that throws the program away costs nothing. Each sink
+provides the following:
+
+    // Initializes the sink for the program being parsed
+    Sink(Program& program);
+
+    // Build nodes, as the `Ast` methods of the same names do. The IDs
+    // returned are only ever handed back to the sink.
+    NodeId add(NodeKind kind, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+    NodeId addBinary(TokenType op, NodeId left, NodeId right);
+    NodeId addString(std::string_view text);
+
+    // Links the statement or print argument that follows a node
+    void link(NodeId node, NodeId next);
+
+    // Sets the first statement of an if or loop block, or of an else block
+    void setBody(NodeId owner, NodeId first);
+    void setElse(NodeId owner, NodeId first);
+
+    // Sets the first statement of the program
+    void setRoot(NodeId first);
+*/
+
+
+#ifndef __PARSE_SINK_H__
+#define __PARSE_SINK_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "ast.h"
+#include "token_type.h"
+
+// Builds the program's AST, ready for the code generator
+class AstSink
+{
+public:
+    AstSink(Program& program) : m_ast(program.ast) {}
+
+    NodeId add(NodeKind kind, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0)
+    {
+        return m_ast.add(kind, a, b, c);
+    }
+
+    NodeId addBinary(TokenType op, NodeId left, NodeId right)
+    {
+        return m_ast.addBinary(op, left, right);
+    }
+
+    NodeId addString(std::string_view text) { return m_ast.addString(text); }
+
+    void link(NodeId node, NodeId next) { m_ast[node].next = next; }
+
+    void setBody(NodeId owner, NodeId first) { m_ast[owner].b = first; }
+
+    void setElse(NodeId owner, NodeId first)
+    {
+        Node& node = m_ast[owner];
+        node.c = first;
+        node.flags |= F_HAS_ELSE;
+    }
+
+    void setRoot(NodeId first) { m_ast.setRoot(first); }
+
+private:
+    Ast& m_ast;
+};
+
+// Throws the program away. Parsing with this only checks the program.
+class NullSink
+{
+public:
+    NullSink(Program&) {}
+
+    NodeId add(NodeKind, uint32_t = 0, uint32_t = 0, uint32_t = 0) 
+    { 
+        return 0; 
+    }
+    NodeId addBinary(TokenType, NodeId, NodeId) { return 0; }
+    NodeId addString(std::string_view) { return 0; }
+    void link(NodeId, NodeId) {}
+    void setBody(NodeId, NodeId) {}
+    void setElse(NodeId, NodeId) {}
+    void setRoot(NodeId) {}
+};
+
+// Counts the nodes of each kind in the program, without building it
+class CountingSink
+{
+public:
+    CountingSink(Program&) {}
+
+    NodeId add(NodeKind kind, uint32_t = 0, uint32_t = 0, uint32_t = 0)
+    {
+        m_counts[kind]++;
+        return static_cast<NodeId>(m_total++);
+    }
+
+    NodeId addBinary(TokenType, NodeId, NodeId) { return add(N_BINARY); }
+    NodeId addString(std::string_view) { return add(N_STRING); }
+    void link(NodeId, NodeId) {}
+    void setBody(NodeId, NodeId) {}
+    void setElse(NodeId, NodeId) { m_elses++; }
+    void setRoot(NodeId) {}
+
+    // Gets the number of nodes of a kind
+    size_t count(NodeKind kind) const { return m_counts[kind]; }
+
+    // Gets the number of nodes of every kind
+    size_t total() const { return m_total; }
+
+    // Gets the number of if statements with an else block
+    size_t elses() const { return m_elses; }
+
+private:
+    size_t m_counts[N_PAREN + 1] = {};
+    size_t m_total = 0;
+    size_t m_elses = 0;
+};
+
+#endif
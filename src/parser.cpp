@@ -11,38 +11,98 @@ Contains the implementation for the `Parser` class.
 
 #include "bb.h"
 
-#include <algorithm>
 #include <cstdlib>
 #include <iostream>
-#include <sstream>
 #include <string>
 
-Parser::Parser(std::shared_ptr<Lexer> lex, std::shared_ptr<Generator> generator) 
-    : m_lexer(lex), m_generator(generator) 
+template <typename Sink>
+BasicParser<Sink>::BasicParser(std::shared_ptr<Lexer> lex) 
+    : m_lexer(lex), m_program(std::make_shared<Program>()), 
+    m_sink(*m_program)
 {
     nextToken();
 }
 
-void Parser::parse()
+template <typename Sink>
+BasicParser<Sink>::BasicParser(std::shared_ptr<TokenStream> tokens) 
+    : m_tokens(tokens), m_program(std::make_shared<Program>()), 
+    m_sink(*m_program)
+{
+    nextToken();
+}
+
+template <typename Sink>
+BasicParser<Sink>::BasicParser(std::shared_ptr<TokenPipeline> pipeline) 
+    : m_pipeline(pipeline), m_program(std::make_shared<Program>()), 
+    m_sink(*m_program)
+{
+    nextToken();
+}
+
+template <typename Sink>
+BasicParser<Sink>::BasicParser(std::shared_ptr<Lexer> lex, bool speculative,
+    std::vector<const char*> stops)
+    : m_lexer(lex), m_program(std::make_shared<Program>()), 
+    m_sink(*m_program), m_speculative(speculative), m_stops(stops)
+{
+    nextToken();
+}
+
+template <typename Sink>
+std::shared_ptr<Program> BasicParser<Sink>::parse()
 {
     print_parse("<program>");
 
-    // Run the main parsing loop
-    while (!Token::isKind(m_currentToken, T_EOF)) 
+    // Run the main parsing loop. Rather than recursing into the blocks of 
+    // if statements and loops, the blocks that are open are kept on a stack
+    // and each statement is linked into the innermost one.
+    m_blocks.push_back(BlockFrame{NO_NODE, B_PROGRAM, NO_NODE, NO_NODE});
+    while (true) 
     {
-        // Ignore newlines
-        if (Token::isKind(m_currentToken, T_NEWLINE))
-            nextToken();
+        if (m_blocks.back().part == B_PROGRAM)
+        {
+            if (m_nextStop < m_stops.size() && reachedStop())
+                break;
+
+            if (Token::isKind(m_currentToken, T_EOF))
+                break;
+
+            // Ignore newlines
+            if (Token::isKind(m_currentToken, T_NEWLINE))
+            {
+                nextToken();
+                continue;
+            }
+        }
+        else if (Token::isKind(m_currentToken, T_RBRACE))
+        {
+            closeBlock();
+            continue;
+        }
+
+        // Parsing the statement may open a block of its own, so hold on to
+        // where the statement belongs first
+        size_t depth = m_blocks.size() - 1;
+        NodeId stmt = statement();
+
+        BlockFrame& block = m_blocks[depth];
+        if (block.last == NO_NODE)
+            block.first = stmt;
         else
-            statement();
+            m_sink.link(block.last, stmt);
+        block.last = stmt;
     }
 
+    m_sink.setRoot(m_blocks.back().first);
+    m_lastStatement = m_blocks.back().last;
+    m_blocks.clear();
+
     // If we made it here then we must've successfully parsed the whole program.
-    // Emit the generated program to disk
-    m_generator->emitProgram(m_variableMap);
+    return m_program;
 }
 
-void Parser::statement()
+template <typename Sink>
+NodeId BasicParser<Sink>::statement()
 {
     print_parse("<statement>");
 
@@ -50,46 +110,38 @@ void Parser::statement()
     switch (m_currentToken.type())
     {
         case T_LET:
-            declaration();
-            break;
+            return declaration();
         case T_IF:
-            if_else();
-            break;
+            return if_else();
         case T_WHILE:
-            while_loop();
-            break;
+            return while_loop();
         case T_DOTIMES:
-            dotimes_loop();
-            break;
+            return dotimes_loop();
         case T_PRINT:
-            output();
-            break;
+            return output();
         case T_READ:
-            read();
-            break;
+            return read();
         case T_IDENT:
-            // Ensure that the variable has been previously declared
-            if (identifierHasBeenDeclared(m_currentToken.lexeme()))
-            {
-                // Output the identifier and advance the parser
-                m_generator->emitToken(m_currentToken);
-                nextToken();
-                assignment();
-            }
-            else 
-            {
-                // Attempt to assign a value to an undeclared variable
-                abort("Attempt to assign a value to an undeclared variable.");
-            }
-            break;
+        {
+            // Ensure that the variable has been previously declared, then
+            // save the identifier and advance the parser
+            SymbolId symbol = requireDeclared(
+                "Attempt to assign a value to an undeclared variable.");
+            nextToken();
+            NodeId value = assignment();
+            return m_sink.add(N_ASSIGN, symbol, value);
+        }
         default:
             // Error, invalid statement
             abort("Invalid statement.");
             break;
     }
+
+    return NO_NODE;
 }
 
-void Parser::declaration()
+template <typename Sink>
+NodeId BasicParser<Sink>::declaration()
 {
     print_parse("<declaration>");
 
@@ -97,36 +149,24 @@ void Parser::declaration()
     nextToken();
     if (Token::isKind(m_currentToken, T_IDENT))
     {
-        // Check that we aren't trying to redeclare a variable
-        if (!identifierHasBeenDeclared(m_currentToken.lexeme()))
-        {
-            // Add the variable to the variable map
-            pushVariable(m_currentToken.lexeme());
+        // Add the variable to the symbol table. An attempt to re-declare a
+        // variable is not allowed.
+        SymbolId symbol = declare("Attempt to redclare a variable.");
 
-            // Store the identifier in case we need to use this as an 
-            // assignment 
-            Token identifier = m_currentToken;
-
-            // We got an identifier as expected, check if this is an assignment
-            // or simply just a declaration
-            nextToken();
-            if (Token::isKind(m_currentToken, T_EQ))
-            {
-                // This is an assignment
-                m_generator->emitToken(identifier);
-                assignment();
-            }
-            else
-            {
-                // This is just a declaration, the next token should be a ';'
-                endl(false);
-            }
+        // We got an identifier as expected, check if this is an assignment
+        // or simply just a declaration
+        nextToken();
+        if (Token::isKind(m_currentToken, T_EQ))
+        {
+            // This is an assignment
+            NodeId value = assignment();
+            return m_sink.add(N_DECLARE, symbol, value);
         }
         else
         {
-            // This is an attempt to re-declare a variable, which is not
-            // allowed
-            abort("Attempt to redclare a variable.");
+            // This is just a declaration, the next token should be a ';'
+            endl();
+            return m_sink.add(N_DECLARE, symbol, NO_NODE);
         }
     }
     else 
@@ -134,82 +174,35 @@ void Parser::declaration()
         // Invalid declaration, no identifier
         abort("Expected an identifier.");
     }
+
+    return NO_NODE;
 }
 
-void Parser::if_else()
+template <typename Sink>
+NodeId BasicParser<Sink>::if_else()
 {
     print_parse("<if_else>");
 
-    // Emit the if
-    m_generator->emitToken(m_currentToken);
-
     // The next token should be a '('
     nextToken();
     if (Token::isKind(m_currentToken, T_LPAREN))
     {
         // Next should be a boolean expression
-        m_generator->emitToken(m_currentToken);
         nextToken();
-        boolean_expression();
+        NodeId condition = boolean_expression();
 
         // Check for the closing ')'
         if (Token::isKind(m_currentToken, T_RPAREN))
         {
-            m_generator->emitToken(m_currentToken);
-
             // Check for the opening of the block
             nextToken();
             if (Token::isKind(m_currentToken, T_LBRACE))
             {
-                // Parse the <stmt_list>
-                m_generator->emitBlockStart();
-                nextToken();
-                while (!Token::isKind(m_currentToken, T_RBRACE))
-                    statement();
-                
-                // Check for the closing '}'
-                if (Token::isKind(m_currentToken, T_RBRACE))
-                {
-                    // Get the next token and determine if there is an else clause
-                    m_generator->emitBlockEnd();
-                    nextToken();
-                    if (Token::isKind(m_currentToken, T_ELSE))
-                    {
-                        // we have an else clause, look for the opening '{'
-                        m_generator->emitToken(m_currentToken);
-                        nextToken();
-                        if (Token::isKind(m_currentToken, T_LBRACE)) 
-                        {
-                            m_generator->emitBlockStart();
-                            nextToken();
-                            
-                            // Get the next statement and parse the <stmt_list>
-                            while (!Token::isKind(m_currentToken, T_RBRACE))
-                                statement();
-                            
-                            // Check for the '}'
-                            if (Token::isKind(m_currentToken, T_RBRACE))
-                            {
-                                // increment the parser
-                                m_generator->emitBlockEnd();
-                                nextToken();
-                            } 
-                            else
-                            {
-                                abort("Expected a '}' token.");
-                            }
-                        }
-                        else
-                        {
-                            // Error, else clause must be in a block
-                            abort("Expected a '{' token.");
-                        }
-                    }
-                }
-                else 
-                {
-                    abort("Expected a '}' token.");
-                }
+                // The <stmt_list> and any else clause are parsed once the
+                // block has been opened
+                NodeId node = m_sink.add(N_IF, condition, NO_NODE, NO_NODE);
+                openBlock(node, B_IF);
+                return node;
             }
             else 
             {
@@ -227,51 +220,34 @@ void Parser::if_else()
         // Error, expected a '(' character
         abort("Expected a LPAREN.");
     }
+
+    return NO_NODE;
 }
 
-void Parser::while_loop()
+template <typename Sink>
+NodeId BasicParser<Sink>::while_loop()
 {
     print_parse("<while_loop>");
 
     // The next token should be a '('
-    m_generator->emitToken(m_currentToken);
     nextToken();
     if (Token::isKind(m_currentToken, T_LPAREN))
     {
         // Next should be a boolean expression
-        m_generator->emitToken(m_currentToken);
         nextToken();
-        boolean_expression();
+        NodeId condition = boolean_expression();
 
         // Check for the closing ')'
         if (Token::isKind(m_currentToken, T_RPAREN))
         {
-            m_generator->emitToken(m_currentToken);
             nextToken();
 
             // Check for the start of the code block
             if (Token::isKind(m_currentToken, T_LBRACE))
             {
-                m_generator->emitBlockStart();
-                nextToken();
-
-                // Parse the statement list
-                while (!Token::isKind(m_currentToken, T_RBRACE))
-                {
-                    statement();
-                }
-
-                // Check for the closing '}'
-                if (Token::isKind(m_currentToken, T_RBRACE))
-                {
-                    m_generator->emitBlockEnd();
-                    nextToken();
-                }
-                else
-                {
-                    // Error, expected a '}' token
-                    abort("Expected a '}' token.");
-                }
+                NodeId node = m_sink.add(N_WHILE, condition, NO_NODE);
+                openBlock(node, B_BODY);
+                return node;
             }
             else
             {
@@ -290,9 +266,12 @@ void Parser::while_loop()
         // Error, expected a '('
         abort("Expected a LPAREN.");
     }
+
+    return NO_NODE;
 }
 
-void Parser::dotimes_loop()
+template <typename Sink>
+NodeId BasicParser<Sink>::dotimes_loop()
 {
     print_parse("<dotimes_loop>");
 
@@ -302,19 +281,19 @@ void Parser::dotimes_loop()
     {
         // Check for the identifier or numeric value
         nextToken();
-        Token nTimes("", T_UNKNOWN);
+        NodeId nTimes = NO_NODE;
         if (Token::isKind(m_currentToken, T_IDENT))
         {
-            // Check that the identifier has been previously declared
-            checkValidIdentifier(m_currentToken);
-
-            // save the identifer for when we generate the loop header in 
-            // the output. 
-            nTimes = m_currentToken;
+            // Check that the identifier has been previously declared, and 
+            // save it for the loop header
+            nTimes = m_sink.add(N_VAR, checkValidIdentifier());
         }
         else if (Token::isKind(m_currentToken, T_NUM))
         {
-            nTimes = m_currentToken; 
+            if (m_currentToken.overflows())
+                abort("Integer overflow resulted.");
+            nTimes = m_sink.add(N_NUM, 
+                static_cast<uint32_t>(m_currentToken.value())); 
         }
         else
         {
@@ -323,35 +302,15 @@ void Parser::dotimes_loop()
 
         // Ensure that we have the closing ')' 
         nextToken();
-        if (Token::isKind(m_currentToken, T_RPAREN) 
-            && !Token::isKind(nTimes, T_UNKNOWN))
+        if (Token::isKind(m_currentToken, T_RPAREN))
         {
-            // Emit the loop header
-            m_generator->emitDoTimes(nTimes);
-
             // Next should be the start of a code block
             nextToken();
             if (Token::isKind(m_currentToken, T_LBRACE))
             {
-                // Handle the statement list
-                m_generator->emitBlockStart();
-                nextToken();
-
-                while (!Token::isKind(m_currentToken, T_RBRACE))
-                {
-                    statement();
-                }
-
-                // Check for the '}' token
-                if (Token::isKind(m_currentToken, T_RBRACE))
-                {
-                    m_generator->emitBlockEnd();
-                    nextToken();
-                }
-                else
-                {
-                    abort("Expected a '}' token.");
-                }
+                NodeId node = m_sink.add(N_DOTIMES, nTimes, NO_NODE);
+                openBlock(node, B_BODY);
+                return node;
             }
             else
             {
@@ -368,106 +327,153 @@ void Parser::dotimes_loop()
         // Error, expected a '('
         abort("Expected a LPAREN.");
     }
-}
 
-void Parser::boolean_expression()
-{
-    print_parse("<boolean_expression>");
-
-    boolean_or_expression();
+    return NO_NODE;
 }
 
-void Parser::boolean_or_expression()
+template <typename Sink>
+void BasicParser<Sink>::openBlock(NodeId owner, BlockPart part)
 {
-    // Make the parsed precedence explicit in the generated C output.
-    m_generator->emitToken(Token('(', T_LPAREN));
-    boolean_and_expression();
-
-    while (Token::isKind(m_currentToken, T_OR))
-    {
-        m_generator->emitToken(m_currentToken);
-        nextToken();
-        boolean_and_expression();
-    }
-    m_generator->emitToken(Token(')', T_RPAREN));
+    // Consume the '{'
+    nextToken();
+    m_blocks.push_back(BlockFrame{owner, part, NO_NODE, NO_NODE});
 }
 
-void Parser::boolean_and_expression()
+template <typename Sink>
+void BasicParser<Sink>::closeBlock()
 {
-    m_generator->emitToken(Token('(', T_LPAREN));
-    boolean_comparison_expression();
+    BlockFrame block = m_blocks.back();
+    m_blocks.pop_back();
 
-    while (Token::isKind(m_currentToken, T_AND))
+    // Consume the '}'
+    nextToken();
+
+    if (block.part == B_ELSE)
     {
-        m_generator->emitToken(m_currentToken);
-        nextToken();
-        boolean_comparison_expression();
+        m_sink.setElse(block.owner, block.first);
+        return;
     }
-    m_generator->emitToken(Token(')', T_RPAREN));
-}
-
-void Parser::boolean_comparison_expression()
-{
-    boolean_primary();
 
-    // Comparisons are intentionally limited to one operator at this level.
-    // This rejects ambiguous chains such as a < b < c while still allowing
-    // comparisons to be combined with the logical precedence levels above.
-    if (Token::isComparisonOperator(m_currentToken))
+    m_sink.setBody(block.owner, block.first);
+    if (block.part == B_IF && Token::isKind(m_currentToken, T_ELSE))
     {
-        m_generator->emitToken(m_currentToken);
+        // we have an else clause, look for the opening '{'
         nextToken();
-        boolean_primary();
+        if (Token::isKind(m_currentToken, T_LBRACE)) 
+        {
+            openBlock(block.owner, B_ELSE);
+        }
+        else
+        {
+            // Error, else clause must be in a block
+            abort("Expected a '{' token.");
+        }
     }
 }
 
-void Parser::boolean_primary()
+template <typename Sink>
+NodeId BasicParser<Sink>::boolean_expression()
 {
-    if (Token::isKind(m_currentToken, T_NOT))
-    {
-        m_generator->emitToken(m_currentToken);
-        nextToken();
-        boolean_primary();
-        return;
-    }
+    print_parse("<boolean_expression>");
 
-    if (Token::isKind(m_currentToken, T_LPAREN))
+    // Binary operators are held on the operator stack until an operator
+    // that binds no tighter than them comes along. A '(' or '!' is pushed as
+    // a marker, so nesting never recurses.
+    size_t base = m_operators.size();
+    size_t openParens = 0;
+    while (true)
     {
-        m_generator->emitToken(m_currentToken);
-        nextToken();
-        boolean_expression();
+        // <boolean_primary> may start with any number of '!' and '('
+        while (true)
+        {
+            if (Token::isKind(m_currentToken, T_NOT))
+            {
+                m_operators.push_back(T_NOT);
+                nextToken();
+            }
+            else if (Token::isKind(m_currentToken, T_LPAREN))
+            {
+                print_parse("<boolean_expression>");
+                m_operators.push_back(T_LPAREN);
+                ++openParens;
+                nextToken();
+            }
+            else
+            {
+                break;
+            }
+        }
 
-        if (Token::isKind(m_currentToken, T_RPAREN))
+        if (Token::isKind(m_currentToken, T_IDENT))
         {
-            m_generator->emitToken(m_currentToken);
+            m_operands.push_back(
+                m_sink.add(N_VAR, checkValidIdentifier()));
             nextToken();
         }
+        else if (Token::isKind(m_currentToken, T_NUM))
+        {
+            m_operands.push_back(numeric_value());
+        }
         else
         {
-            abort("Expected a RPAREN.");
+            abort("Unexpected token encountered in boolean expression.");
         }
+        applyNots(base);
 
-        return;
-    }
+        // Close off any parenthesized expressions that end here
+        while (openParens > 0 && Token::isKind(m_currentToken, T_RPAREN))
+        {
+            reduceWhile(base, 0);
+            closeParen();
+            --openParens;
+            nextToken();
+            applyNots(base);
+        }
 
-    if (Token::isKind(m_currentToken, T_IDENT))
-    {
-        checkValidIdentifier(m_currentToken);
-        m_generator->emitToken(m_currentToken);
+        int precedence = 0;
+        if (Token::isComparisonOperator(m_currentToken))
+        {
+            // Comparisons are intentionally limited to one operator at this
+            // level. This rejects ambiguous chains such as a < b < c while 
+            // still allowing comparisons to be combined with the logical
+            // precedence levels above. A second comparison ends the
+            // expression and is left for the caller to reject.
+            if (m_operators.size() > base 
+                && isComparisonOp(m_operators.back()))
+            {
+                break;
+            }
+            precedence = 3;
+        }
+        else if (Token::isKind(m_currentToken, T_AND))
+        {
+            precedence = 2;
+        }
+        else if (Token::isKind(m_currentToken, T_OR))
+        {
+            precedence = 1;
+        }
+        else
+        {
+            break;
+        }
+
+        reduceWhile(base, precedence);
+        m_operators.push_back(m_currentToken.type());
         nextToken();
-        return;
     }
 
-    if (Token::isKind(m_currentToken, T_NUM))
-    {
-        numeric_value();
-        return;
-    }
+    if (openParens > 0)
+        abort("Expected a RPAREN.");
 
-    abort("Unexpected token encountered in boolean expression.");
+    reduceWhile(base, 0);
+    NodeId result = m_operands.back();
+    m_operands.pop_back();
+    return result;
 }
 
-void Parser::isStringOrIdent()
+template <typename Sink>
+void BasicParser<Sink>::isStringOrIdent()
 {
     if (!Token::isKind(m_currentToken, T_STRING)
         && !Token::isKind(m_currentToken, T_IDENT))
@@ -475,68 +481,47 @@ void Parser::isStringOrIdent()
         abort("Expected a string literal or identifier for print().");
     }        
 
-    if (Token::isKind(m_currentToken, T_IDENT) 
-        && !identifierHasBeenDeclared(m_currentToken.lexeme()))
-    {
-        abort("Attempt to print an undeclared variable.");
-    }
+    if (Token::isKind(m_currentToken, T_IDENT))
+        requireDeclared("Attempt to print an undeclared variable.");
 }
 
-void Parser::buildPrint(std::stringstream& ss, std::vector<std::string>& idents)
+template <typename Sink>
+NodeId BasicParser<Sink>::buildPrint()
 {
     if (Token::isKind(m_currentToken, T_STRING))
     {
-        // String literals become part of a printf format string. Escape any
-        // user-provided '%' so it remains literal text rather than introducing
-        // a conversion that has no corresponding argument.
-        for (char character : m_currentToken.lexeme())
-        {
-            if (character == '%')
-                ss << "%%";
-            else
-                ss << character;
-        }
+        // String literals are kept as written. The generator takes care of
+        // turning them into part of a printf format string.
+        return m_sink.addString(m_currentToken.lexeme());
     }
     else
     {
-        // This is a variable, append the format specifier to the print
-        // string and push the identifier to the map vector. The format
-        // specifier portion is extremely simple since our language only
-        // deals with integers
-        ss << "%d";
-        idents.push_back(m_currentToken.lexeme());
+        // This is a variable
+        return m_sink.add(N_VAR, 
+            m_program->symbols.find(m_currentToken.lexeme()));
     }
 }
 
-void Parser::output()
+template <typename Sink>
+NodeId BasicParser<Sink>::output()
 {
     print_parse("<output>");
 
-    // emit the print keyword and advance the parser
-    m_generator->emitToken(m_currentToken);
+    // advance the parser past the print keyword
     nextToken();
 
     // Next we should have a L_PAREN
     if (Token::isKind(m_currentToken, T_LPAREN))
     {
-        // Emit the parenthesis
-        m_generator->emitToken(m_currentToken);
         nextToken();
 
         // Check that we have either a string or and identifier w/o consuming
         // the token
         isStringOrIdent();
 
-        /* Start building the output string */
-        // This vector will store the variables, in order, that need to be printed 
-        std::vector<std::string> identifier_map;
-        // This will be the builder for the string literal portion of the print
-        std::stringstream ss;
-
-        // Build the print string and variable stack
-        buildPrint(ss, identifier_map);
-
-        // Consume the token and move on
+        // Build the first item of the print and consume the token
+        NodeId first = buildPrint();
+        NodeId last = first;
         nextToken();
 
         // Handle the case where we print multiple items in one call
@@ -550,20 +535,18 @@ void Parser::output()
             isStringOrIdent();
 
             // Expand the output
-            buildPrint(ss, identifier_map);
+            NodeId item = buildPrint();
+            m_sink.link(last, item);
+            last = item;
 
             // Advance the parser
             nextToken();
         }
 
-        // Emit the final print string to the output
-        m_generator->emitPrint(ss.str(), identifier_map);
-
         // Ensure that we have the R_PAREN
         if (Token::isKind(m_currentToken, T_RPAREN))
         {
-            // Emit the parenthesis and advance the parser
-            m_generator->emitToken(m_currentToken);
+            // Advance the parser
             nextToken();
         }
         else
@@ -573,16 +556,20 @@ void Parser::output()
         }
 
         // Ensure that the line ends with a ';'
-        endl(true);
+        endl();
+        return m_sink.add(N_PRINT, first);
     }
     else
     {
         // Error, expected a L_PAREN
         abort("Expected L_PAREN for the call to `print`");
     }
+
+    return NO_NODE;
 }
 
-void Parser::read()
+template <typename Sink>
+NodeId BasicParser<Sink>::read()
 {
     print_parse("<read>");
 
@@ -595,18 +582,15 @@ void Parser::read()
         if (Token::isKind(m_currentToken, T_IDENT))
         {
             // The identifier needs to have been previously declared
-            checkValidIdentifier(m_currentToken);
-
-            // Store the identifier for when we emit the read to the output
-            Token identifier = m_currentToken;
+            SymbolId symbol = checkValidIdentifier();
 
             // Ensure that we have the ending ')' and ';'
             nextToken();
             if (Token::isKind(m_currentToken, T_RPAREN))
             {
                 nextToken();
-                endl(false);
-                m_generator->emitRead(identifier);
+                endl();
+                return m_sink.add(N_READ, symbol);
             }
             else
             {
@@ -624,145 +608,217 @@ void Parser::read()
     {
         abort("Expected a L_PAREN.");
     }
+
+    return NO_NODE;
 }
 
-void Parser::assignment()
+template <typename Sink>
+NodeId BasicParser<Sink>::assignment()
 {
     print_parse("<assignment>");
 
     // The next token should be an '=' and advance the parser
     if (Token::isAssignmentOperator(m_currentToken))
     {   
-        // Output the '='
-        m_generator->emitToken(m_currentToken);
         nextToken();
 
         // Parse every right-hand side through the same expression entry point.
         // This includes single values as well as parenthesized expressions.
-        arithmetic_expression();
+        NodeId value = arithmetic_expression();
 
         // Ensure we end with a ';'
-        endl(true);
+        endl();
+        return value;
     }
     else 
     {
         // Invalid assignment, expected a '='
         abort("Expected an '=' for the assignment.");
     }
+
+    return NO_NODE;
 }
 
-void Parser::factor()
+template <typename Sink>
+NodeId BasicParser<Sink>::factor()
 {
-    if (Token::isKind(m_currentToken, T_IDENT) || 
-        Token::isKind(m_currentToken, T_NUM))
+    if (Token::isKind(m_currentToken, T_NUM))
     {
-        if (Token::isKind(m_currentToken, T_NUM))
-        {
-            numeric_value();
-        }
-        else
-        {
-            // Ensure that the identifier has been previously declared
-            if (identifierHasBeenDeclared(m_currentToken.lexeme()))
-            {
-                // emit the token and advance the parser
-                m_generator->emitToken(m_currentToken);
-                nextToken();
-            }
-            else
-            {
-                // Error, attempt to reference an undeclared variable
-                abort("Variable does not exist.");
-            }
-        }
+        return numeric_value();
     }
-    else if (Token::isKind(m_currentToken, T_LPAREN))
+    else if (Token::isKind(m_currentToken, T_IDENT))
     {
-        // Emit the parenthesis and advance the parser
-        m_generator->emitToken(m_currentToken);
+        // Ensure that the identifier has been previously declared, then
+        // build the variable and advance the parser
+        SymbolId symbol = requireDeclared("Variable does not exist.");
+        NodeId node = m_sink.add(N_VAR, symbol);
         nextToken();
+        return node;
+    }
+    else
+    {
+        // Error, malformed expression
+        abort("Malformed arithmetic expression.");
+    }
 
-        // Check for an expression
-        arithmetic_expression();
+    return NO_NODE;
+}
 
-        // Check for the closing parenthesis
-        if (Token::isKind(m_currentToken, T_RPAREN))
+template <typename Sink>
+NodeId BasicParser<Sink>::arithmetic_expression()
+{
+    print_parse("<arithmetic_expression>");
+
+    // Operators wait on the operator stack until one that binds no tighter
+    // comes along, so addition and subtraction bind the loosest and
+    // everything groups to the left, the same as it does in C. Parentheses
+    // are pushed as markers rather than parsed recursively.
+    size_t base = m_operators.size();
+    size_t openParens = 0;
+    while (true)
+    {
+        while (Token::isKind(m_currentToken, T_LPAREN))
+        {
+            print_parse("<arithmetic_expression>");
+            m_operators.push_back(T_LPAREN);
+            ++openParens;
+            nextToken();
+        }
+
+        // There should be some sort of factor here
+        m_operands.push_back(factor());
+
+        // Close off any parenthesized expressions that end here
+        while (openParens > 0 && Token::isKind(m_currentToken, T_RPAREN))
         {
-            // Emit the parenthesis and advance the parser
-            m_generator->emitToken(m_currentToken);
+            reduceWhile(base, 0);
+            closeParen();
+            --openParens;
             nextToken();
         }
+
+        int precedence = 0;
+        if (Token::isKind(m_currentToken, T_PLUS) 
+            || Token::isKind(m_currentToken, T_MINUS))
+        {
+            precedence = 1;
+        }
+        else if (Token::isKind(m_currentToken, T_MUL) 
+            || Token::isKind(m_currentToken, T_DIV)
+            || Token::isKind(m_currentToken, T_MOD))
+        {
+            precedence = 2;
+        }
         else
         {
-            // Error, expected a ')'
-            abort("Expected a R_PAREN");
+            break;
         }
+
+        reduceWhile(base, precedence);
+        m_operators.push_back(m_currentToken.type());
+        nextToken();
     }
-    else
+
+    if (openParens > 0)
     {
-        // Error, malformed expression
-        abort("Malformed arithmetic expression.");
+        // Error, expected a ')'
+        abort("Expected a R_PAREN");
     }
+
+    reduceWhile(base, 0);
+    NodeId result = m_operands.back();
+    m_operands.pop_back();
+    return result;
 }
 
-void Parser::arithmetic_expression()
+// Gets how tightly a binary operator binds. Higher binds tighter.
+static int precedenceOf(TokenType op)
 {
-    print_parse("<arithmetic_expression>");
-    
-    // There should be some sort of factor here
-    factor();
-    
-    // recursive arithmetic expression
-    while (Token::isArithmeticOperator(m_currentToken))
-    {
-        // Emit the operator, advance the parser, and continue parsing the 
-        // arithmetic expression
-        m_generator->emitToken(m_currentToken);
-        nextToken();
-        factor();
+    switch (op)
+    {
+        case T_OR: return 1;
+        case T_AND: return 2;
+        case T_PLUS: case T_MINUS: return 1;
+        case T_MUL: case T_DIV: case T_MOD: return 2;
+        default: return isComparisonOp(op) ? 3 : -1;
     }
 }
 
-void Parser::numeric_value()
+template <typename Sink>
+void BasicParser<Sink>::reduce()
+{
+    TokenType op = m_operators.back();
+    m_operators.pop_back();
+    NodeId right = m_operands.back();
+    m_operands.pop_back();
+    NodeId left = m_operands.back();
+    m_operands.back() = m_sink.addBinary(op, left, right);
+}
+
+template <typename Sink>
+void BasicParser<Sink>::reduceWhile(size_t base, int precedence)
+{
+    // Markers aren't binary operators, so this stops at an open parenthesis
+    // or a negation that is still waiting on its operand
+    while (m_operators.size() > base 
+        && precedenceOf(m_operators.back()) >= precedence)
+    {
+        reduce();
+    }
+}
+
+template <typename Sink>
+void BasicParser<Sink>::closeParen()
+{
+    m_operators.pop_back();
+    m_operands.back() = m_sink.add(N_PAREN, m_operands.back());
+}
+
+template <typename Sink>
+void BasicParser<Sink>::applyNots(size_t base)
+{
+    while (m_operators.size() > base && m_operators.back() == T_NOT)
+    {
+        m_operators.pop_back();
+        m_operands.back() = m_sink.add(N_NOT, m_operands.back());
+    }
+}
+
+template <typename Sink>
+NodeId BasicParser<Sink>::numeric_value()
 {
     print_parse("<numeric_value>");
 
     if (Token::isKind(m_currentToken, T_NUM))
     {
-        // Token appears to be a number, validate this is true
-        try
-        {
-            int i = std::stoi(m_currentToken.lexeme());
-        }
-        catch (std::invalid_argument const &e)
-        {
-            // Error, this is not a valid integer value
-            abort("Invalid numeric value.");
-        }
-        catch (std::out_of_range const &e)
+        // The lexer has already decoded the value, make sure it fit in an int
+        if (m_currentToken.overflows())
         {
             // Error, this results in an integer overflow
             abort("Integer overflow resulted.");
         }
 
         // If we made it this far then we must've had a valid int value
-        m_generator->emitToken(m_currentToken);
+        NodeId node = m_sink.add(N_NUM, 
+            static_cast<uint32_t>(m_currentToken.value()));
         nextToken();
+        return node;
     }
     else 
     {
         // Error, expected a numeric value
         abort("Expected a numeric value.");
     }
+
+    return NO_NODE;
 }
 
-void Parser::endl(bool emit)
+template <typename Sink>
+void BasicParser<Sink>::endl()
 {
     if (Token::isKind(m_currentToken, T_SEMICOLON))
     {
-        // emit a line ending (if needed) and advance the parser
-        if (emit)
-            m_generator->emitLineEnd();
+        // advance the parser
         nextToken();
     }
     else
@@ -772,36 +828,117 @@ void Parser::endl(bool emit)
     }
 }
 
-void Parser::checkValidIdentifier(Token identifier) const
+template <typename Sink>
+SymbolId BasicParser<Sink>::checkValidIdentifier()
 {
-    if (!identifierHasBeenDeclared(identifier.lexeme()))
-        abort("Attempt to reference an undeclared identifier.");
+    return requireDeclared("Attempt to reference an undeclared identifier.");
 }
 
-bool Parser::identifierHasBeenDeclared(std::string var) const
+template <typename Sink>
+SymbolId BasicParser<Sink>::requireDeclared(const char* msg)
 {
-    // Search the variable map for the given key
-    return std::find(m_variableMap.begin(), m_variableMap.end(), 
-        var) != m_variableMap.end();
+    std::string_view name = m_currentToken.lexeme();
+    SymbolId symbol = m_program->symbols.find(name);
+    if (!m_speculative)
+    {
+        if (symbol == SymbolTable::NO_SYMBOL)
+            abort(msg);
+        return symbol;
+    }
+
+    // A variable we've already seen has either been declared in our input or
+    // already has a check waiting on it
+    if (symbol != SymbolTable::NO_SYMBOL)
+        return symbol;
+
+    // Otherwise it must have been declared before our input
+    m_checks.push_back(DeclarationCheck{m_currentToken, msg, false});
+    m_declaredHere.push_back(0);
+    return m_program->symbols.add(name);
 }
 
-void Parser::pushVariable(std::string var)
+template <typename Sink>
+SymbolId BasicParser<Sink>::declare(const char* msg)
 {
-    m_variableMap.push_back(var);
+    std::string_view name = m_currentToken.lexeme();
+    SymbolId symbol = m_program->symbols.find(name);
+    if (!m_speculative)
+    {
+        if (symbol != SymbolTable::NO_SYMBOL)
+            abort(msg);
+        return m_program->symbols.add(name);
+    }
+
+    // Re-declaring a variable declared in our own input is always an error
+    if (symbol != SymbolTable::NO_SYMBOL && m_declaredHere[symbol])
+        abort(msg);
+
+    // Whether the variable was declared before our input isn't known yet
+    m_checks.push_back(DeclarationCheck{m_currentToken, msg, true});
+    if (symbol != SymbolTable::NO_SYMBOL)
+    {
+        m_declaredHere[symbol] = 1;
+        return symbol;
+    }
+
+    m_declaredHere.push_back(1);
+    return m_program->symbols.add(name);
+}
+
+template <typename Sink>
+bool BasicParser<Sink>::reachedStop()
+{
+    // Statements at the top level end with a ';' or a '}'
+    if (!Token::isKind(m_previousToken, T_SEMICOLON) 
+        && !Token::isKind(m_previousToken, T_RBRACE))
+    {
+        return false;
+    }
+
+    std::string_view lexeme = m_previousToken.lexeme();
+    const char* end = lexeme.data() + lexeme.size();
+    while (m_nextStop < m_stops.size() && m_stops[m_nextStop] < end)
+        m_nextStop++;
+
+    if (m_nextStop < m_stops.size() && m_stops[m_nextStop] == end)
+    {
+        m_stoppedAt = end;
+        return true;
+    }
+    return false;
 }
 
-void Parser::abort(const char* msg) const
+template <typename Sink>
+void BasicParser<Sink>::abort(const char* msg) const
 {
-    std::cerr << "Parsing error on token: " << m_currentToken.lexeme() 
-        << std::endl;
-    std::cerr << "\tError: " << msg << std::endl;
-    std::cerr << "Aborting..." << std::endl;
-    exit(-1);
+    throw ParseError(m_currentToken, msg);
 }
 
-void Parser::nextToken() 
+template <typename Sink>
+void BasicParser<Sink>::nextToken() 
 {
+    m_previousToken = m_currentToken;
+
+    // The token stream has already dropped the newlines
+    if (m_tokens)
+    {
+        m_currentToken = m_tokens->at(m_tokenIndex++);
+        return;
+    }
+
+    // So has the pipeline
+    if (m_pipeline)
+    {
+        m_currentToken = m_pipeline->next();
+        return;
+    }
+
     m_currentToken = m_lexer->getToken();
     while (Token::isKind(m_currentToken, T_NEWLINE))
         m_currentToken = m_lexer->getToken();
 }
+
+// The sinks the parser is compiled for
+template class BasicParser<AstSink>;
+template class BasicParser<NullSink>;
+template class BasicParser<CountingSink>;
@@ -18,7 +18,8 @@ The grammar for the bare bones language (bb) is as follows:
 <assignment> --> <identifier> = <arithmetic_expression>;
 
 // Expressions
-<arithmetic_expression> --> <factor> { <math_op> <factor> }
+<arithmetic_expression> --> <term> { <add_op> <term> }
+<term> --> <factor> { <mul_op> <factor> }
 <factor> --> <identifier> | <numeric_value> | ( <arithmetic_expression> )
 <boolean_expression> --> <or_expression>
 <or_expression> --> <and_expression> { or <and_expression> }
@@ -43,7 +44,8 @@ The grammar for the bare bones language (bb) is as follows:
 // Base constructs
 <identifier> --> String of characters 
 <numeric_value> --> any numeric value
-<math_op> --> + | - | * | / | %
+<add_op> --> + | -
+<mul_op> --> * | / | %
 <comparison_operator> --> == | != | < | > | <= | >=
 */
 
@@ -51,139 +53,305 @@ The grammar for the bare bones language (bb) is as follows:
 #define __PARSER_H__
 
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
 
-#include "generator.h"
+#include "ast.h"
 #include "lexer.h"
+#include "parse_sink.h"
+#include "symbol_table.h"
 #include "token.h"
+#include "token_pipeline.h"
+#include "token_stream.h"
 #include "token_type.h"
 
+// Thrown when the parser finds an error in its input
+class ParseError : public std::runtime_error
+{
+public:
+    ParseError(const Token& tok, const char* msg) 
+        : std::runtime_error(msg), token(tok) {}
+
+    // The token the error was found on
+    Token token;
+};
+
+// A check that the parser couldn't make while speculating, because it 
+// depends on the variables declared before the input being parsed. These are
+// made later, in order, by whoever puts the pieces of the program together.
+struct DeclarationCheck
+{
+    // The identifier being checked
+    Token token;
+
+    // The error to report if the check fails
+    const char* message;
+
+    // Set if the identifier is being declared, in which case it must not
+    // have been declared before. Otherwise it must have been.
+    bool declares;
+};
+
 /*
-The `Parser` class implements a recursive decent parser for the Bare
-Bones Language. It also triggers the code generator to generate the
-compiled code. Currently, the language compiles down to C, however
-I have attempted to keep everything abstracted well enough to make
-adding other code backends fairly straight-forward. 
+The `BasicParser` class implements the parser for the Bare Bones Language. It
+hands the program it parses to a sink (see parse_sink.h), which is chosen 
+when the parser is compiled. The usual sink builds an abstract syntax tree 
+for the program, which is then handed to a code generator. Currently, the 
+language compiles down to C, however keeping the parsing separate from the 
+generator makes adding other code backends, or passes over the tree, fairly 
+straight-forward. `Parser` is the parser that builds the tree.
+
+The parser follows the grammar above production by production, but it never
+recurses. Blocks that are still open are kept on an explicit stack, and
+expressions are parsed by operator precedence with explicit operand and
+operator stacks. These stacks live on the heap, so how deeply a program can
+nest is limited only by memory.
 */
-class Parser
+template <typename Sink>
+class BasicParser
 {
 public:
     // Initializes the parser with a Lexer instance
-    Parser(std::shared_ptr<Lexer> lex, std::shared_ptr<Generator>);
+    BasicParser(std::shared_ptr<Lexer> lex);
+
+    // Initializes the parser with a pre-lexed token stream. Tokens are read
+    // from the stream by index instead of being lexed on demand.
+    BasicParser(std::shared_ptr<TokenStream> tokens);
+
+    // Initializes the parser with a pipeline that lexes on another thread
+    BasicParser(std::shared_ptr<TokenPipeline> pipeline);
+
+    // Initializes the parser to parse a piece of a larger program. The piece
+    // must start at the beginning of a statement at the top level.
+    //
+    // A speculative parser doesn't know which variables were declared
+    // before its piece. It assumes every check of a declaration passes and
+    // records them, in order, to be made later (see `checks`). An error it
+    // throws may only mean that the piece wasn't split where a statement
+    // begins.
+    //
+    // Parsing stops at the top level once the last token consumed ends at
+    // one of the offsets in `stops`, which must be sorted. The offsets are
+    // pointers into the lexer's input.
+    BasicParser(std::shared_ptr<Lexer> lex, bool speculative,
+        std::vector<const char*> stops = std::vector<const char*>());
 
     // Starts the processing of a program
     // This effectively starts parsing the <program> prodcution of the grammar
-    void parse();
+    // and returns the parsed program.
+    std::shared_ptr<Program> parse();
+
+    // Gets the last statement at the top level of the parsed program
+    NodeId lastStatement() const { return m_lastStatement; }
+
+    // Gets the offset parsing stopped at, or nullptr if the whole input was
+    // parsed
+    const char* stoppedAt() const { return m_stoppedAt; }
+
+    // Gets the checks a speculative parser recorded, in order
+    const std::vector<DeclarationCheck>& checks() const { return m_checks; }
+
+    // Gets the token currently being parsed
+    const Token& currentToken() const { return m_currentToken; }
+
+    // Gets the sink the program was parsed into
+    Sink& sink() { return m_sink; }
 
 private:
+    // The parts of a statement that hold a block of statements
+    enum BlockPart : uint8_t
+    {
+        B_PROGRAM,  // The top level of the program
+        B_IF,       // The block of an if
+        B_ELSE,     // The block of an else
+        B_BODY,     // The body of a loop
+    };
+
+    // A block that is still being parsed
+    struct BlockFrame
+    {
+        NodeId owner;       // The statement the block belongs to
+        BlockPart part;     // Which of the owner's blocks this is
+        NodeId first;       // The first statement parsed into the block
+        NodeId last;        // The last statement parsed into the block
+    };
+
     // The lexer instance
     std::shared_ptr<Lexer> m_lexer;
 
-    // The generator instance
-    std::shared_ptr<Generator> m_generator;
+    // The pre-lexed token stream, when parsing from one
+    std::shared_ptr<TokenStream> m_tokens;
 
-    // Tracks if a variable with a given name has been declared or not.
-    // When we first encounter a variable declaration we place its name in this
-    // vector. Since our simple langauge has no concept of variable scope, this
-    // simple solution is sufficient for ensuring that variables have been 
-    // previously declared.
-    std::vector<std::string> m_variableMap;
+    // The pipeline tokens are read from, when lexing on another thread
+    std::shared_ptr<TokenPipeline> m_pipeline;
+
+    // The index of the next token to read from the token stream
+    size_t m_tokenIndex = 0;
+
+    // The program being built. Its symbol table tracks if a variable with a
+    // given name has been declared or not. When we first encounter a variable
+    // declaration we add its name to the table. Since our simple langauge has
+    // no concept of variable scope, this simple solution is sufficient for 
+    // ensuring that variables have been previously declared.
+    std::shared_ptr<Program> m_program;
+
+    // The sink the program is built with
+    Sink m_sink;
 
     // The current token being parsed
     Token m_currentToken;
 
-    // Checks if a variable has been previously declared by searching the 
-    // variable map vector
-    bool identifierHasBeenDeclared(std::string var) const;
+    // The token parsed before the current one
+    Token m_previousToken;
+
+    // Tracks if the parser is speculating
+    bool m_speculative = false;
+
+    // For each symbol of a speculative parse, tracks if it was declared in
+    // the input being parsed (rather than before it)
+    std::vector<uint8_t> m_declaredHere;
 
-    // Pushes a variable name onto the variable map
-    void pushVariable(std::string var);
+    // The checks recorded while speculating
+    std::vector<DeclarationCheck> m_checks;
 
-    // Called when a parsing error occurs
+    // The offsets parsing stops at, and the next one that could be reached
+    std::vector<const char*> m_stops;
+    size_t m_nextStop = 0;
+
+    // The offset parsing stopped at
+    const char* m_stoppedAt = nullptr;
+
+    // The last statement at the top level
+    NodeId m_lastStatement = NO_NODE;
+
+    // The blocks that are currently open, innermost last
+    std::vector<BlockFrame> m_blocks;
+
+    // The operands of the expression being parsed
+    std::vector<NodeId> m_operands;
+
+    // The operators of the expression being parsed, along with markers for
+    // open parentheses (T_LPAREN) and pending negations (T_NOT)
+    std::vector<TokenType> m_operators;
+
+    // Checks that the variable named by the current token has been declared
+    // and returns its symbol. Aborts with `msg` if it hasn't.
+    SymbolId requireDeclared(const char* msg);
+
+    // Adds the variable named by the current token to the symbol table and
+    // returns its symbol. Aborts with `msg` if it has already been declared.
+    SymbolId declare(const char* msg);
+
+    // Checks if parsing should stop before the next statement
+    bool reachedStop();
+
+    // Called when a parsing error occurs. Aborts parsing by throwing a
+    // `ParseError`.
     void abort(const char* msg) const;
 
     // Gets the next token and updates the look ahead token
     void nextToken();
 
     /*
-     * The following perform parsing on the production rules for the language
+     * The following perform parsing on the production rules for the language.
+     * Each returns the node it built. The statements that own a block only
+     * parse up to the opening '{' and push the block onto the block stack.
      */
 
     // <statement> --> <declaration> | <assignment> | <if_else> | <loop> |
     //      <input> | <output>
-    void statement();
+    NodeId statement();
 
     // <declaration> --> let <identifier>; | let <assignment>
-    void declaration();
+    NodeId declaration();
 
     // <assignment> --> <identifier> = <arithmetic_expression>;
-    void assignment();
+    // The identifier has already been consumed, this parses the rest of the
+    // assignment and returns the value being assigned.
+    NodeId assignment();
 
     // <if_else> --> if (<boolean_expression>) { <statement_list> } else { <statement_list> } 
     //      if (<boolean_expression>) { <statement_list> }
-    void if_else();
+    NodeId if_else();
 
     // <while_loop> --> while (<boolean_expression>) { <statement_list> }
-    void while_loop();
+    NodeId while_loop();
 
     // <dotimes_loop> --> dotimes (<numeric_value>) { <statement_list> } |
     //      dotimes(<identifier>) { <statement_list> } |
-    void dotimes_loop();
+    NodeId dotimes_loop();
 
     // <output> --> print(<output_seq>); 
-    void output();
+    NodeId output();
 
     // <input> -- > read(<identifier>);
-    void read();
+    NodeId read();
 
-    // <arithmetic_expression> --> <factor> { <math_op> <factor> }
-    void arithmetic_expression();
+    // <arithmetic_expression> --> <term> { <add_op> <term> }
+    // <term> --> <factor> { <mul_op> <factor> }
+    NodeId arithmetic_expression();
 
     // <boolean_expression> --> <or_expression>
-    void boolean_expression();
-
     // <or_expression> --> <and_expression> { or <and_expression> }
-    void boolean_or_expression();
-
     // <and_expression> --> <comparison_expression> { and <comparison_expression> }
-    void boolean_and_expression();
-
     // <comparison_expression> --> <boolean_primary>
     //      [ <comparison_operator> <boolean_primary> ]
-    void boolean_comparison_expression();
-
     // <boolean_primary> --> ! <boolean_primary> | <identifier> |
     //      <numeric_value> | ( <boolean_expression> )
-    void boolean_primary();
+    NodeId boolean_expression();
 
-    // <factor> --> <identifier> | <numeric_value> | ( <arithmetic_expression> )
-    void factor();
+    // <factor> --> <identifier> | <numeric_value>
+    // The parenthesized form of a factor is handled by arithmetic_expression.
+    NodeId factor();
 
     // Checks for any valid numeric (integer) value. 
-    void numeric_value(); 
+    NodeId numeric_value(); 
 
     // Checks for a line ending (semicolon). 
-    // The emit flag indicates rather or not we should emit a line ending to the
-    // generated output. This is needed because, in some cases, the generator
-    // handles the line ending for us.
-    void endl(bool emit);
+    void endl();
 
     /*
     * The following are helper functions for parsing the langauge production
     * rules.
     */
 
-    // A helper function to check if a given identifier is valid
-    void checkValidIdentifier(Token identifier) const;
+    // A helper function to check if the current identifier is valid. Returns
+    // the symbol for the identifier.
+    SymbolId checkValidIdentifier();
+
+    // Opens a block for a statement. The current token is the block's '{'.
+    void openBlock(NodeId owner, BlockPart part);
+
+    // Closes the innermost block. The current token is the block's '}'.
+    void closeBlock();
+
+    // Pops an operator and its two operands and pushes the binary node
+    // built from them
+    void reduce();
+
+    // Reduces the pending operators of the expression that started with
+    // `base` operators on the stack, while they bind at least as tightly as
+    // `precedence`
+    void reduceWhile(size_t base, int precedence);
+
+    // Pops the open parenthesis marker for a ')' and wraps the expression
+    // inside of the parentheses
+    void closeParen();
+
+    // Applies the negations waiting on the operand that was just parsed
+    void applyNots(size_t base);
 
     // Helper function for <output> to verify that we have either a string
     // literal or an identifier without consuming the current token.
     void isStringOrIdent();
 
-    // This is a helper to build the output string and identifier stack for 
-    // our print(). This information is later used by the generator to output
-    // the resulting print call in the output language (C, in our case).
-    void buildPrint(std::stringstream& ss, std::vector<std::string>& idents);
+    // This is a helper to build a node for one of the items passed to print().
+    NodeId buildPrint();
 };
 
+// The parser that builds an AST
+typedef BasicParser<AstSink> Parser;
+
 #endif
@@ -0,0 +1,165 @@
+/*
+File: scan.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the bulk character scanners.
+*/
+
+
+#include "scan.h"
+
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BB_SIMD
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BB_SIMD
+#endif
+
+namespace
+{
+
+#if defined(__AVX2__)
+
+// A block of characters processed together
+typedef __m256i Block;
+const size_t BLOCK_SIZE = 32;
+const uint32_t FULL_MASK = 0xFFFFFFFFu;
+
+inline Block load(const char* p) 
+{ 
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); 
+}
+inline Block splat(char c) { return _mm256_set1_epi8(c); }
+inline Block eq(Block a, Block b) { return _mm256_cmpeq_epi8(a, b); }
+inline Block gt(Block a, Block b) { return _mm256_cmpgt_epi8(a, b); }
+inline Block both(Block a, Block b) { return _mm256_and_si256(a, b); }
+inline Block either(Block a, Block b) { return _mm256_or_si256(a, b); }
+inline uint32_t bits(Block b) 
+{ 
+    return static_cast<uint32_t>(_mm256_movemask_epi8(b)); 
+}
+
+#elif defined(__SSE2__)
+
+typedef __m128i Block;
+const size_t BLOCK_SIZE = 16;
+const uint32_t FULL_MASK = 0xFFFFu;
+
+inline Block load(const char* p) 
+{ 
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); 
+}
+inline Block splat(char c) { return _mm_set1_epi8(c); }
+inline Block eq(Block a, Block b) { return _mm_cmpeq_epi8(a, b); }
+inline Block gt(Block a, Block b) { return _mm_cmpgt_epi8(a, b); }
+inline Block both(Block a, Block b) { return _mm_and_si128(a, b); }
+inline Block either(Block a, Block b) { return _mm_or_si128(a, b); }
+inline uint32_t bits(Block b) 
+{ 
+    return static_cast<uint32_t>(_mm_movemask_epi8(b)); 
+}
+
+#endif
+
+#ifdef BB_SIMD
+// Marks the characters of a block that fall within [lo, hi]. Characters 
+// above 0x7F compare as negative, so they never fall within an ASCII range.
+inline Block inRange(Block b, char lo, char hi)
+{
+    return both(gt(b, splat(lo - 1)), gt(splat(hi + 1), b));
+}
+#endif
+
+inline bool isWhitespaceChar(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool isDigitChar(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline bool isAlnumChar(char c)
+{
+    char lower = c | 0x20;
+    return isDigitChar(c) || (lower >= 'a' && lower <= 'z');
+}
+
+/*
+Runs a scan. `stopMask` returns a bit mask of the characters in a block that
+end the scan and `isStop` does the same for a single character. Whole blocks
+are tested while they fit in the buffer, and the tail is finished one
+character at a time.
+*/
+template <typename StopMask, typename IsStop>
+inline size_t scan(const char* buffer, size_t pos, size_t length,
+    StopMask stopMask, IsStop isStop)
+{
+#ifdef BB_SIMD
+    while (pos + BLOCK_SIZE <= length)
+    {
+        uint32_t mask = stopMask(load(buffer + pos));
+        if (mask != 0)
+            return pos + __builtin_ctz(mask);
+        pos += BLOCK_SIZE;
+    }
+#else
+    (void)stopMask;
+#endif
+
+    while (pos < length && !isStop(buffer[pos]))
+        pos++;
+    return pos;
+}
+
+}
+
+#ifdef BB_SIMD
+#define STOP_MASK(body) [](Block b) -> uint32_t { return body; }
+#else
+#define STOP_MASK(body) nullptr
+#endif
+
+size_t scanWhitespace(const char* buffer, size_t pos, size_t length)
+{
+    return scan(buffer, pos, length,
+        STOP_MASK(~bits(either(either(eq(b, splat(' ')), eq(b, splat('\t'))),
+            eq(b, splat('\r')))) & FULL_MASK),
+        [](char c) { return !isWhitespaceChar(c); });
+}
+
+size_t scanCommentEnd(const char* buffer, size_t pos, size_t length)
+{
+    return scan(buffer, pos, length,
+        STOP_MASK(bits(either(eq(b, splat('\n')), eq(b, splat('\0'))))),
+        [](char c) { return c == '\n' || c == '\0'; });
+}
+
+size_t scanStringSpecial(const char* buffer, size_t pos, size_t length)
+{
+    return scan(buffer, pos, length,
+        STOP_MASK(bits(either(either(eq(b, splat('"')), eq(b, splat('\\'))),
+            eq(b, splat('\0'))))),
+        [](char c) { return c == '"' || c == '\\' || c == '\0'; });
+}
+
+size_t scanAlnum(const char* buffer, size_t pos, size_t length)
+{
+    // Setting 0x20 folds upper case letters onto lower case ones
+    return scan(buffer, pos, length,
+        STOP_MASK(~bits(either(inRange(b, '0', '9'),
+            inRange(either(b, splat(0x20)), 'a', 'z'))) & FULL_MASK),
+        [](char c) { return !isAlnumChar(c); });
+}
+
+size_t scanDigits(const char* buffer, size_t pos, size_t length)
+{
+    return scan(buffer, pos, length,
+        STOP_MASK(~bits(inRange(b, '0', '9')) & FULL_MASK),
+        [](char c) { return !isDigitChar(c); });
+}
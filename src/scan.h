@@ -0,0 +1,38 @@
+/*
+File: scan.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the bulk character scanners used by the lexer.
+*/
+
+
+#ifndef __SCAN_H__
+#define __SCAN_H__
+
+#include <cstddef>
+
+/*
+Each scanner starts at `pos` in `buffer` and returns the position of the first
+character that ends the run it is looking for, or `length` if the run reaches
+the end of the buffer. These look at 32 (AVX2) or 16 (SSE2) characters at a
+time when the target supports it, and fall back to a simple loop otherwise.
+*/
+
+// Skips a run of ' ', '\t' and '\r' characters
+size_t scanWhitespace(const char* buffer, size_t pos, size_t length);
+
+// Finds the end of a comment: the next '\n' or '\0'
+size_t scanCommentEnd(const char* buffer, size_t pos, size_t length);
+
+// Finds the next character that needs attention inside of a string literal:
+// a '"', a '\' (which may escape a '"') or a '\0'
+size_t scanStringSpecial(const char* buffer, size_t pos, size_t length);
+
+// Skips a run of letters and digits
+size_t scanAlnum(const char* buffer, size_t pos, size_t length);
+
+// Skips a run of digits
+size_t scanDigits(const char* buffer, size_t pos, size_t length);
+
+#endif
@@ -0,0 +1,76 @@
+/*
+File: source.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `SourceBuffer` class.
+*/
+
+
+#include "source.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iterator>
+
+SourceBuffer::SourceBuffer(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        close(fd);
+        return;
+    }
+
+    m_size = static_cast<size_t>(info.st_size);
+    m_open = true;
+
+    // An empty file can't be mapped. Leave the buffer empty and let the lexer
+    // report that there is nothing to do.
+    if (m_size > 0)
+    {
+        void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            m_size = 0;
+            m_open = false;
+        }
+        else
+        {
+            // The lexer only ever moves forward through the input
+            madvise(mapping, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const char*>(mapping);
+            m_mapped = true;
+        }
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+SourceBuffer::SourceBuffer(std::istream& stream)
+{
+    m_storage.assign(std::istreambuf_iterator<char>(stream),
+        std::istreambuf_iterator<char>());
+    m_data = m_storage.data();
+    m_size = m_storage.size();
+    m_open = true;
+}
+
+SourceBuffer::SourceBuffer(std::string_view text)
+    : m_data(text.data()), m_size(text.size()), m_open(true)
+{
+}
+
+SourceBuffer::~SourceBuffer()
+{
+    if (m_mapped)
+        munmap(const_cast<char*>(m_data), m_size);
+}
@@ -0,0 +1,71 @@
+/*
+File: source.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the source buffer that holds the program text being lexed.
+*/
+
+
+#ifndef __SOURCE_H__
+#define __SOURCE_H__
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <string_view>
+
+/*
+The `SourceBuffer` class provides a single, read-only view of the program
+text. When constructed from a path the file is memory mapped, so the lexer
+reads straight from the page cache without copying the input. When
+constructed from a stream the text is read into memory once. A buffer can
+also borrow text that is already in memory.
+*/
+class SourceBuffer
+{
+public:
+    // Maps the file at the given path read-only into memory
+    SourceBuffer(const char* path);
+
+    // Reads the entire contents of a stream into memory
+    SourceBuffer(std::istream& stream);
+
+    // Borrows text that is already in memory. The text isn't copied, so it
+    // must outlive the buffer.
+    SourceBuffer(std::string_view text);
+
+    // Unmaps the file (if one was mapped)
+    ~SourceBuffer();
+
+    // The buffer owns a mapping, so it can't be copied
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    // Checks if the source was successfully opened
+    bool isOpen() const { return m_open; }
+
+    // Gets a pointer to the start of the source text
+    const char* data() const { return m_data; }
+
+    // Gets the length of the source text in bytes
+    size_t size() const { return m_size; }
+
+private:
+    // The start of the source text
+    const char* m_data = nullptr;
+
+    // The length of the source text
+    size_t m_size = 0;
+
+    // Tracks if the source was opened successfully
+    bool m_open = false;
+
+    // Tracks if `m_data` points at a memory mapping that must be unmapped
+    bool m_mapped = false;
+
+    // Backing storage for text that was read from a stream
+    std::string m_storage;
+};
+
+#endif
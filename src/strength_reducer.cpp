@@ -0,0 +1,917 @@
+/*
+File: strength_reducer.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `StrengthReducer` class.
+*/
+
+
+#include "strength_reducer.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "optimizer.h"
+#include "token_type.h"
+
+// Gets the comparison that is true exactly when `op` is false
+static int negate(int op)
+{
+    switch (op)
+    {
+        case T_LT: return T_GTEQ;
+        case T_GTEQ: return T_LT;
+        case T_GT: return T_LTEQ;
+        case T_LTEQ: return T_GT;
+        case T_EQEQ: return T_NEQ;
+        default: return T_EQEQ;
+    }
+}
+
+// Gets the comparison that gives the same result with its operands swapped
+static int swapOperands(int op)
+{
+    switch (op)
+    {
+        case T_LT: return T_GT;
+        case T_GT: return T_LT;
+        case T_LTEQ: return T_GTEQ;
+        case T_GTEQ: return T_LTEQ;
+        default: return op;
+    }
+}
+
+// Gets `k` if a number is 2 to the power of `k`, or -1 if it isn't a power
+// of 2
+static int powerOfTwo(int64_t value)
+{
+    if (value <= 0 || (value & (value - 1)) != 0)
+        return -1;
+
+    int power = 0;
+    while (value > 1)
+    {
+        value >>= 1;
+        power++;
+    }
+    return power;
+}
+
+StrengthReducer::StrengthReducer(Program& program)
+    : m_program(program), m_ast(program.ast)
+{
+}
+
+void StrengthReducer::run()
+{
+    findLoopAssigns(m_ast, m_ast.root(), m_loopAssigns);
+    findDirections();
+
+    size_t symbols = m_program.symbols.size();
+    m_stamps.assign(symbols, 0);
+    m_slots.assign(symbols, 0);
+
+    // Each walk that finds a loop counter that might overflow stops treating
+    // it as a counter, which can change the ranges of others, so the program
+    // is walked until the counters that are left all hold
+    for (int walks = 1; ; walks++)
+    {
+        m_retry = false;
+        walk();
+        if (!m_retry)
+            break;
+
+        if (walks == MAX_WALKS)
+        {
+            for (Direction& direction : m_directions)
+            {
+                if (direction != D_NONE)
+                    direction = D_ANY;
+            }
+            break;
+        }
+    }
+
+    m_rewrite = true;
+    walk();
+}
+
+void StrengthReducer::findDirections()
+{
+    m_directions.assign(m_program.symbols.size(), D_NONE);
+
+    // Each entry is a statement list and whether it is inside a loop
+    std::vector<std::pair<NodeId, bool>> work;
+    work.emplace_back(m_ast.root(), false);
+    while (!work.empty())
+    {
+        auto [id, inLoop] = work.back();
+        work.pop_back();
+        if (id == NO_NODE)
+            continue;
+
+        const Node& node = m_ast[id];
+        work.emplace_back(node.next, inLoop);
+        switch (node.kind)
+        {
+            case N_DECLARE:
+            case N_ASSIGN:
+            case N_READ:
+            {
+                if (!inLoop || (node.kind == N_DECLARE && node.b == NO_NODE))
+                    break;
+
+                // Only `v = v + k`, `v = k + v` and `v = v - k` count
+                Direction direction = D_ANY;
+                const Node& value = m_ast[node.kind == N_READ ? id : node.b];
+                if (node.kind != N_READ && value.kind == N_BINARY
+                    && (value.op == T_PLUS || value.op == T_MINUS))
+                {
+                    const Node& left = m_ast[value.a];
+                    const Node& right = m_ast[value.b];
+                    const Node* step = nullptr;
+                    if (left.kind == N_VAR && left.a == node.a
+                        && right.kind == N_NUM)
+                        step = &right;
+                    else if (value.op == T_PLUS && right.kind == N_VAR
+                        && right.a == node.a && left.kind == N_NUM)
+                        step = &left;
+
+                    if (step != nullptr)
+                    {
+                        bool up = (value.op == T_PLUS)
+                            == (static_cast<int>(step->a) >= 0);
+                        direction = up ? D_UP : D_DOWN;
+                    }
+                }
+
+                Direction& current = m_directions[node.a];
+                if (current == D_NONE)
+                    current = direction;
+                else if (current != direction)
+                    current = D_ANY;
+                break;
+            }
+            case N_IF:
+                work.emplace_back(node.b, inLoop);
+                if (node.flags & F_HAS_ELSE)
+                    work.emplace_back(node.c, inLoop);
+                break;
+            case N_WHILE:
+            case N_DOTIMES:
+                work.emplace_back(node.b, true);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void StrengthReducer::walk()
+{
+    // Nothing is known about a variable before it is assigned
+    m_ranges.assign(m_program.symbols.size(), Range{INT_MIN, INT_MAX});
+    m_trail.clear();
+    m_branchValues.clear();
+    m_openBlocks = 0;
+    m_openLoops = 0;
+
+    m_work.push_back(WalkTask{W_STATEMENTS, m_ast.root(), 0, 0});
+    while (!m_work.empty())
+    {
+        WalkTask task = m_work.back();
+        m_work.pop_back();
+        switch (task.step)
+        {
+            case W_STATEMENTS:
+                // Leave the rest of the list for after this statement
+                if (task.id != NO_NODE)
+                {
+                    m_work.push_back(WalkTask{W_STATEMENTS,
+                        m_ast[task.id].next, 0, 0});
+                    visit(task.id);
+                }
+                break;
+            case W_IF_THEN:
+            {
+                // Put the if block's ranges aside and walk the else block
+                // from the ranges before the if
+                const Node& node = m_ast[task.id];
+                size_t thenValues = m_branchValues.size();
+                collectChanges(task.mark);
+                undo(task.mark);
+                m_work.push_back(WalkTask{W_IF_ELSE, task.id, task.mark,
+                    thenValues});
+                if (node.flags & F_HAS_ELSE)
+                {
+                    narrow(node.a, false);
+                    m_work.push_back(WalkTask{W_STATEMENTS, node.c, 0, 0});
+                }
+                break;
+            }
+            case W_IF_ELSE:
+                joinBranches(task);
+                m_openBlocks--;
+                break;
+            case W_LOOP:
+            {
+                // The ranges at the end of the body only hold for one pass
+                // through it. There is no way out of a while loop other
+                // than its condition being false.
+                undo(task.mark);
+                m_openBlocks--;
+                m_openLoops--;
+                const Node& node = m_ast[task.id];
+                if (node.kind == N_WHILE)
+                    narrow(node.a, false);
+                break;
+            }
+        }
+    }
+}
+
+void StrengthReducer::visit(NodeId id)
+{
+    const Node& node = m_ast[id];
+    switch (node.kind)
+    {
+        case N_DECLARE:
+        case N_ASSIGN:
+        {
+            // A declaration without a value leaves the variable as it was
+            if (node.b == NO_NODE)
+                break;
+
+            SymbolId symbol = node.a;
+            Range range = reduce(node.b);
+
+            // A loop counter's range only holds if adding to it can't
+            // overflow
+            Direction direction = m_directions[symbol];
+            if (m_openLoops > 0 && m_mayOverflow
+                && (direction == D_UP || direction == D_DOWN))
+            {
+                m_directions[symbol] = D_ANY;
+                m_retry = true;
+            }
+            set(symbol, range);
+            break;
+        }
+        case N_READ:
+            set(node.a, Range{INT_MIN, INT_MAX});
+            break;
+        case N_IF:
+        {
+            NodeId condition = node.a;
+            NodeId thenBlock = node.b;
+            reduce(condition);
+            m_openBlocks++;
+            m_work.push_back(WalkTask{W_IF_THEN, id, m_trail.size(), 0});
+            narrow(condition, true);
+            m_work.push_back(WalkTask{W_STATEMENTS, thenBlock, 0, 0});
+            break;
+        }
+        case N_WHILE:
+            enterLoop(id, node.a, node.b, false);
+            break;
+        case N_DOTIMES:
+            enterLoop(id, node.a, node.b, true);
+            break;
+        default:
+            break;
+    }
+}
+
+void StrengthReducer::enterLoop(NodeId id, NodeId test, NodeId body,
+    bool dotimes)
+{
+    // A loop counter can only move one way from where it starts. Anything
+    // else the loop assigns may have any value by the time the test runs
+    // again.
+    for (SymbolId symbol : m_loopAssigns[id])
+    {
+        Range range{INT_MIN, INT_MAX};
+        if (m_directions[symbol] == D_UP)
+            range.low = m_ranges[symbol].low;
+        else if (m_directions[symbol] == D_DOWN)
+            range.high = m_ranges[symbol].high;
+        set(symbol, range);
+    }
+    reduce(test);
+
+    m_openBlocks++;
+    m_openLoops++;
+    m_work.push_back(WalkTask{W_LOOP, id, m_trail.size(), 0});
+    if (!dotimes)
+        narrow(test, true);
+    m_work.push_back(WalkTask{W_STATEMENTS, body, 0, 0});
+}
+
+void StrengthReducer::joinBranches(const WalkTask& task)
+{
+    // Put the else block's ranges after the if block's, then go back to the
+    // ranges from before the if
+    size_t elseValues = m_branchValues.size();
+    collectChanges(task.mark);
+    undo(task.mark);
+
+    auto join = [](Range a, Range b) {
+        return Range{std::min(a.low, b.low), std::max(a.high, b.high)};
+    };
+
+    // Match each variable the else block changed with its range from the
+    // if block, or from before the if if the if block didn't change it
+    uint32_t stamp = ++m_stamp;
+    for (size_t i = task.thenValues; i < elseValues; i++)
+    {
+        SymbolId symbol = m_branchValues[i].first;
+        m_stamps[symbol] = stamp;
+        m_slots[symbol] = i;
+    }
+
+    std::vector<std::pair<SymbolId, Range>> joined;
+    for (size_t i = elseValues; i < m_branchValues.size(); i++)
+    {
+        SymbolId symbol = m_branchValues[i].first;
+        Range thenRange = m_ranges[symbol];
+        if (m_stamps[symbol] == stamp)
+        {
+            thenRange = m_branchValues[m_slots[symbol]].second;
+            m_stamps[symbol] = 0;
+        }
+        joined.emplace_back(symbol, join(thenRange,
+            m_branchValues[i].second));
+    }
+
+    // The rest were only changed by the if block
+    for (size_t i = task.thenValues; i < elseValues; i++)
+    {
+        SymbolId symbol = m_branchValues[i].first;
+        if (m_stamps[symbol] == stamp)
+            joined.emplace_back(symbol, join(m_branchValues[i].second,
+                m_ranges[symbol]));
+    }
+
+    m_branchValues.resize(task.thenValues);
+    for (const auto& [symbol, range] : joined)
+        set(symbol, range);
+}
+
+StrengthReducer::Range StrengthReducer::reduce(NodeId root)
+{
+    // The C compiler is free to assume that a division never fails, so an
+    // expression it can see more of might lose a division that fails. Such
+    // expressions are left as they are, so they still fail when they run.
+    Range range = evaluate(root);
+    if (m_rewrite && !m_mayFail)
+        rewrite(root);
+    return range;
+}
+
+StrengthReducer::Range StrengthReducer::evaluate(NodeId root)
+{
+    // Operands are evaluated before the operators that use them
+    m_mayFail = false;
+    m_mayOverflow = false;
+    m_nodeRanges.resize(m_ast.size());
+    m_expressionWork.clear();
+    m_expressionWork.push_back(ExpressionTask{root, false});
+    while (!m_expressionWork.empty())
+    {
+        ExpressionTask task = m_expressionWork.back();
+        m_expressionWork.pop_back();
+
+        const Node& node = m_ast[task.id];
+        if (!task.operandsDone && (node.kind == N_PAREN
+            || node.kind == N_NOT || node.kind == N_BINARY))
+        {
+            m_expressionWork.push_back(ExpressionTask{task.id, true});
+            m_expressionWork.push_back(ExpressionTask{node.a, false});
+            if (node.kind == N_BINARY)
+                m_expressionWork.push_back(ExpressionTask{node.b, false});
+            continue;
+        }
+
+        Range range{INT_MIN, INT_MAX};
+        switch (node.kind)
+        {
+            case N_NUM:
+            {
+                int value = static_cast<int>(node.a);
+                range = Range{value, value};
+                break;
+            }
+            case N_VAR:
+                range = m_ranges[node.a];
+                break;
+            case N_PAREN:
+                range = m_nodeRanges[node.a];
+                break;
+            case N_NOT:
+            {
+                Range operand = m_nodeRanges[node.a];
+                if (operand.low > 0 || operand.high < 0)
+                    range = Range{0, 0};
+                else if (operand.low == 0 && operand.high == 0)
+                    range = Range{1, 1};
+                else
+                    range = Range{0, 1};
+                break;
+            }
+            case N_BINARY:
+                range = evaluateOperator(node.op, m_nodeRanges[node.a],
+                    m_nodeRanges[node.b]);
+                break;
+            default:
+                break;
+        }
+        m_nodeRanges[task.id] = range;
+    }
+
+    return m_nodeRanges[root];
+}
+
+StrengthReducer::Range StrengthReducer::evaluateOperator(int op, Range left,
+    Range right)
+{
+    // A result that might not fit in an int could be anything, since the
+    // arithmetic might wrap around
+    auto fit = [this](int64_t low, int64_t high) {
+        if (low >= INT_MIN && high <= INT_MAX)
+            return Range{low, high};
+        m_mayOverflow = true;
+        return Range{INT_MIN, INT_MAX};
+    };
+    auto truth = [](bool always, bool never) {
+        return always ? Range{1, 1} : never ? Range{0, 0} : Range{0, 1};
+    };
+    auto nonZero = [](Range range) {
+        return range.low > 0 || range.high < 0;
+    };
+    auto zero = [](Range range) {
+        return range.low == 0 && range.high == 0;
+    };
+    auto single = [](Range a, Range b) {
+        return a.low == a.high && b.low == b.high && a.low == b.low;
+    };
+    auto apart = [](Range a, Range b) {
+        return a.high < b.low || b.high < a.low;
+    };
+
+    // A division fails if it might divide by 0, or the smallest int by -1
+    if ((op == T_DIV || op == T_MOD) && (!nonZero(right)
+        || (left.low == INT_MIN && right.low <= -1 && right.high >= -1)))
+        m_mayFail = true;
+
+    switch (op)
+    {
+        case T_PLUS:
+            return fit(left.low + right.low, left.high + right.high);
+        case T_MINUS:
+            return fit(left.low - right.high, left.high - right.low);
+        case T_MUL:
+        {
+            int64_t products[] = {left.low * right.low, left.low * right.high,
+                left.high * right.low, left.high * right.high};
+            return fit(*std::min_element(products, products + 4),
+                *std::max_element(products, products + 4));
+        }
+        case T_DIV:
+        {
+            // The quotient is largest and smallest at the corners of the
+            // ranges, taking the negative and positive divisors apart so
+            // that 0 is left out
+            int64_t low = INT64_MAX;
+            int64_t high = INT64_MIN;
+            Range parts[] = {{right.low, std::min<int64_t>(right.high, -1)},
+                {std::max<int64_t>(right.low, 1), right.high}};
+            for (const Range& part : parts)
+            {
+                if (part.low > part.high)
+                    continue;
+                for (int64_t dividend : {left.low, left.high})
+                {
+                    for (int64_t divisor : {part.low, part.high})
+                    {
+                        low = std::min(low, dividend / divisor);
+                        high = std::max(high, dividend / divisor);
+                    }
+                }
+            }
+            if (low > high)
+                return Range{INT_MIN, INT_MAX};
+            return fit(low, high);
+        }
+        case T_MOD:
+        {
+            // The remainder is smaller than the largest divisor and has the
+            // sign of the dividend. It is only the dividend itself when the
+            // dividend is smaller than every divisor.
+            int64_t largest = std::max(-right.low, right.high) - 1;
+            if (largest < 0)
+                return Range{INT_MIN, INT_MAX};
+            if (right.low > 0 || right.high < 0)
+            {
+                int64_t smallest = right.low > 0 ? right.low : -right.high;
+                if (left.low >= 0 && left.high < smallest)
+                    return left;
+            }
+            return Range{left.low >= 0 ? 0 : std::max(left.low, -largest),
+                left.high <= 0 ? 0 : std::min(left.high, largest)};
+        }
+        case T_SHL:
+            if (right.low != right.high || right.low < 0 || right.low >= 31
+                || left.low < 0)
+                return Range{INT_MIN, INT_MAX};
+            return fit(left.low << right.low, left.high << right.low);
+        case T_SHR:
+            if (right.low != right.high || right.low < 0 || right.low >= 32)
+                return Range{INT_MIN, INT_MAX};
+            return Range{left.low >> right.low, left.high >> right.low};
+        case T_BITAND:
+            if (left.low >= 0 && right.low >= 0)
+                return Range{0, std::min(left.high, right.high)};
+            if (left.low >= 0)
+                return Range{0, left.high};
+            if (right.low >= 0)
+                return Range{0, right.high};
+            return Range{INT_MIN, INT_MAX};
+        case T_LT:
+            return truth(left.high < right.low, left.low >= right.high);
+        case T_GT:
+            return truth(left.low > right.high, left.high <= right.low);
+        case T_LTEQ:
+            return truth(left.high <= right.low, left.low > right.high);
+        case T_GTEQ:
+            return truth(left.low >= right.high, left.high < right.low);
+        case T_EQEQ:
+            return truth(single(left, right), apart(left, right));
+        case T_NEQ:
+            return truth(apart(left, right), single(left, right));
+        case T_AND:
+            return truth(nonZero(left) && nonZero(right),
+                zero(left) || zero(right));
+        case T_OR:
+            return truth(nonZero(left) || nonZero(right),
+                zero(left) && zero(right));
+        default:
+            return Range{INT_MIN, INT_MAX};
+    }
+}
+
+void StrengthReducer::narrow(NodeId condition, bool truth)
+{
+    // Only parts that must have a known result narrow anything: both sides
+    // of an `and` that is true, or of an `or` that is false
+    m_conditionWork.clear();
+    m_conditionWork.emplace_back(condition, truth);
+    while (!m_conditionWork.empty())
+    {
+        auto [id, value] = m_conditionWork.back();
+        m_conditionWork.pop_back();
+
+        const Node& node = m_ast[id];
+        if (node.kind == N_PAREN)
+        {
+            m_conditionWork.emplace_back(node.a, value);
+        }
+        else if (node.kind == N_NOT)
+        {
+            m_conditionWork.emplace_back(node.a, !value);
+        }
+        else if (node.kind == N_BINARY && (node.op == T_AND
+            || node.op == T_OR))
+        {
+            if (value == (node.op == T_AND))
+            {
+                m_conditionWork.emplace_back(node.a, value);
+                m_conditionWork.emplace_back(node.b, value);
+            }
+        }
+        else if (node.kind == N_BINARY && isComparisonOp(node.op))
+        {
+            NodeId left = node.a;
+            NodeId right = node.b;
+            int op = value ? node.op : negate(node.op);
+            narrowVariable(left, op, right);
+            narrowVariable(right, swapOperands(op), left);
+        }
+    }
+}
+
+void StrengthReducer::narrowVariable(NodeId variable, int op, NodeId other)
+{
+    while (m_ast[variable].kind == N_PAREN)
+        variable = m_ast[variable].a;
+    if (m_ast[variable].kind != N_VAR)
+        return;
+
+    SymbolId symbol = m_ast[variable].a;
+    Range bound = evaluate(other);
+    Range range = m_ranges[symbol];
+    switch (op)
+    {
+        case T_LT:
+            range.high = std::min(range.high, bound.high - 1);
+            break;
+        case T_LTEQ:
+            range.high = std::min(range.high, bound.high);
+            break;
+        case T_GT:
+            range.low = std::max(range.low, bound.low + 1);
+            break;
+        case T_GTEQ:
+            range.low = std::max(range.low, bound.low);
+            break;
+        case T_EQEQ:
+            range.low = std::max(range.low, bound.low);
+            range.high = std::min(range.high, bound.high);
+            break;
+        case T_NEQ:
+            // Only a single value at either end of the range can be cut off
+            if (bound.low == bound.high && range.low == bound.low)
+                range.low++;
+            else if (bound.low == bound.high && range.high == bound.low)
+                range.high--;
+            break;
+        default:
+            break;
+    }
+
+    // A block that can't run is left with the ranges it had, so a mistake
+    // can never turn into a rewrite
+    if (range.low > range.high)
+        return;
+    if (range.low != m_ranges[symbol].low || range.high != m_ranges[symbol].high)
+        set(symbol, range);
+}
+
+void StrengthReducer::rewrite(NodeId root)
+{
+    // Work from the top down, so a part with a known value is replaced as a
+    // whole
+    m_rewriteWork.clear();
+    m_rewriteWork.push_back(root);
+    while (!m_rewriteWork.empty())
+    {
+        NodeId id = m_rewriteWork.back();
+        m_rewriteWork.pop_back();
+
+        Node& node = m_ast[id];
+        Range range = m_nodeRanges[id];
+        if (node.kind != N_NUM && range.low == range.high)
+        {
+            makeNumber(node, static_cast<int>(range.low));
+            continue;
+        }
+
+        if (node.kind == N_PAREN || node.kind == N_NOT)
+        {
+            m_rewriteWork.push_back(node.a);
+            continue;
+        }
+        if (node.kind != N_BINARY)
+            continue;
+
+        // A node that was changed is looked at again in its new form
+        if (simplify(id))
+        {
+            m_rewriteWork.push_back(id);
+            continue;
+        }
+
+        int op = m_ast[id].op;
+        if ((op == T_PLUS || op == T_MUL) && rebalance(id))
+        {
+            m_rewriteWork.insert(m_rewriteWork.end(), m_leaves.begin(),
+                m_leaves.end());
+            continue;
+        }
+
+        m_rewriteWork.push_back(m_ast[id].a);
+        m_rewriteWork.push_back(m_ast[id].b);
+    }
+}
+
+bool StrengthReducer::simplify(NodeId id)
+{
+    Node& node = m_ast[id];
+    NodeId operand = node.a;
+    NodeId literal = node.b;
+    if ((node.op == T_PLUS || node.op == T_MUL)
+        && m_ast[operand].kind == N_NUM && m_ast[literal].kind != N_NUM)
+        std::swap(operand, literal);
+    if (m_ast[literal].kind != N_NUM)
+        return false;
+
+    // The node takes over its operand, keeping its `next` link
+    auto replace = [&]() {
+        Node copy = m_ast[operand];
+        copy.next = node.next;
+        node = copy;
+        return true;
+    };
+
+    // Shifts and masks only give the same result as the arithmetic when
+    // the operand isn't negative
+    int value = static_cast<int>(m_ast[literal].a);
+    Range range = m_nodeRanges[operand];
+    switch (node.op)
+    {
+        case T_PLUS:
+        case T_MINUS:
+            if (value == 0)
+                return replace();
+            break;
+        case T_MUL:
+        {
+            if (value == 1)
+                return replace();
+            int power = powerOfTwo(value);
+            if (power > 0 && range.low >= 0
+                && (range.high << power) <= INT_MAX)
+            {
+                node.op = T_SHL;
+                node.a = operand;
+                node.b = literal;
+                m_ast[literal].a = static_cast<uint32_t>(power);
+                return true;
+            }
+            break;
+        }
+        case T_DIV:
+        {
+            if (value == 1)
+                return replace();
+            int power = powerOfTwo(value);
+            if (power > 0 && range.low >= 0)
+            {
+                node.op = T_SHR;
+                m_ast[literal].a = static_cast<uint32_t>(power);
+                return true;
+            }
+            break;
+        }
+        case T_MOD:
+        {
+            // The sign of the divisor doesn't change the remainder
+            int64_t divisor = value < 0 ? -static_cast<int64_t>(value) : value;
+            if (divisor == 0 || range.low < 0)
+                break;
+            if (range.high < divisor)
+                return replace();
+            if (powerOfTwo(divisor) >= 0)
+            {
+                node.op = T_BITAND;
+                m_ast[literal].a = static_cast<uint32_t>(divisor - 1);
+                return true;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return false;
+}
+
+bool StrengthReducer::rebalance(NodeId id)
+{
+    // The parser builds a chain leaning left, with its first operand at the
+    // bottom
+    int op = m_ast[id].op;
+    m_spine.clear();
+    m_leaves.clear();
+    NodeId current = id;
+    while (m_ast[current].kind == N_BINARY && m_ast[current].op == op)
+    {
+        m_spine.push_back(current);
+        m_leaves.push_back(m_ast[current].b);
+        current = m_ast[current].a;
+    }
+    m_leaves.push_back(current);
+    if (m_leaves.size() < MIN_CHAIN)
+        return false;
+    std::reverse(m_leaves.begin(), m_leaves.end());
+
+    // Every group of operands has to fit in an int. A group adds up to
+    // between the sum of the negative ends of their ranges and the sum of
+    // the positive ends, and multiplies to at most the product of their
+    // sizes.
+    int64_t low = 0;
+    int64_t high = 0;
+    int64_t size = 1;
+    for (NodeId leaf : m_leaves)
+    {
+        Range range = m_nodeRanges[leaf];
+        if (op == T_PLUS)
+        {
+            low += std::min<int64_t>(range.low, 0);
+            high += std::max<int64_t>(range.high, 0);
+            if (low < INT_MIN || high > INT_MAX)
+                return false;
+        }
+        else
+        {
+            size *= std::max<int64_t>(std::max(-range.low, range.high), 1);
+            if (size > INT_MAX)
+                return false;
+        }
+    }
+
+    // Put the numbers together into the first of them, and leave it out if
+    // it comes to nothing
+    NodeId number = NO_NODE;
+    int64_t total = op == T_PLUS ? 0 : 1;
+    size_t kept = 0;
+    for (NodeId leaf : m_leaves)
+    {
+        if (m_ast[leaf].kind == N_NUM)
+        {
+            int64_t value = static_cast<int>(m_ast[leaf].a);
+            total = op == T_PLUS ? total + value : total * value;
+            if (number != NO_NODE)
+                continue;
+            number = leaf;
+        }
+        m_leaves[kept++] = leaf;
+    }
+    m_leaves.resize(kept);
+    if (number != NO_NODE)
+    {
+        makeNumber(m_ast[number], static_cast<int>(total));
+        m_nodeRanges[number] = Range{total, total};
+        if (total == (op == T_PLUS ? 0 : 1) && m_leaves.size() > 1)
+            m_leaves.erase(std::find(m_leaves.begin(), m_leaves.end(),
+                number));
+    }
+
+    if (m_leaves.size() == 1)
+    {
+        Node copy = m_ast[m_leaves[0]];
+        copy.next = m_ast[id].next;
+        m_ast[id] = copy;
+        m_leaves[0] = id;
+        return true;
+    }
+
+    // Pair up neighbouring operands until two are left, which the chain's
+    // own node joins. The other nodes of the chain are reused for the pairs.
+    m_level = m_leaves;
+    size_t spare = 1;
+    while (m_level.size() > 2)
+    {
+        size_t paired = 0;
+        for (size_t i = 0; i < m_level.size(); i += 2)
+        {
+            if (i + 1 == m_level.size())
+            {
+                m_level[paired++] = m_level[i];
+                break;
+            }
+
+            NodeId pair = m_spine[spare++];
+            Node& node = m_ast[pair];
+            node.a = m_level[i];
+            node.b = m_level[i + 1];
+            node.next = NO_NODE;
+            m_level[paired++] = pair;
+        }
+        m_level.resize(paired);
+    }
+
+    Node& root = m_ast[id];
+    root.a = m_level[0];
+    root.b = m_level[1];
+    return true;
+}
+
+void StrengthReducer::set(SymbolId symbol, Range range)
+{
+    if (m_openBlocks > 0)
+        m_trail.emplace_back(symbol, m_ranges[symbol]);
+    m_ranges[symbol] = range;
+}
+
+void StrengthReducer::undo(size_t mark)
+{
+    while (m_trail.size() > mark)
+    {
+        m_ranges[m_trail.back().first] = m_trail.back().second;
+        m_trail.pop_back();
+    }
+}
+
+void StrengthReducer::collectChanges(size_t mark)
+{
+    uint32_t stamp = ++m_stamp;
+    for (size_t i = mark; i < m_trail.size(); i++)
+    {
+        SymbolId symbol = m_trail[i].first;
+        if (m_stamps[symbol] != stamp)
+        {
+            m_stamps[symbol] = stamp;
+            m_branchValues.emplace_back(symbol, m_ranges[symbol]);
+        }
+    }
+}
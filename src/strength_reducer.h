@@ -0,0 +1,224 @@
+/*
+File: strength_reducer.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the value range analysis and the arithmetic rewrites that
+use it.
+*/
+
+
+#ifndef __STRENGTH_REDUCER_H__
+#define __STRENGTH_REDUCER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ast.h"
+#include "symbol_table.h"
+
+/*
+The `StrengthReducer` class works out the range of values every variable
+and expression can have, and uses them to rewrite arithmetic into cheaper
+forms that give the same result:
+
+* `x * 8` becomes `x << 3` and `x / 8` becomes `x >> 3` when `x` can't be
+  negative (and, for the shift left, can't overflow). `x % 8` becomes
+  `x & 7` when `x` can't be negative, and just `x` when it is already less
+  than the divisor.
+* `x * 1`, `x / 1`, `x + 0` and `x - 0` become `x`, and anything whose range
+  holds only one value becomes that value, including conditions.
+* Chains such as `a + b + c + d` are regrouped into `(a + b) + (c + d)`, so
+  the two halves can be worked out at the same time, with the numbers in
+  them added together. This is only done when no part of the regrouped
+  chain can overflow, since C doesn't define signed overflow.
+
+Ranges are tracked the same way the constant folder tracks values. Where the
+branches of an if meet, a variable's range covers both. The condition of an
+if or a while narrows the ranges of the variables it compares inside the
+block it guards (and the opposite condition narrows them in an else block).
+A variable the loop assigns is usually unknown inside it, except for loop
+counters: a variable that every loop only ever changes with `v = v + k` (or
+`v = v - k`) for a number `k` can only move one way from where it was when
+the loop started. That only holds if the counter can't overflow, which is
+checked as the loop is walked. If it might, the variable is treated as
+unknown and the program is walked again.
+
+Arithmetic that might overflow gives an unknown result rather than assuming
+that it doesn't, so the ranges also hold for a program built with wrapping
+arithmetic. Expressions with a division that may fail are left as they are.
+*/
+class StrengthReducer
+{
+public:
+    StrengthReducer(Program& program);
+
+    // Runs the pass
+    void run();
+
+private:
+    // The most times the program is walked to find the loop counters that
+    // can't overflow. After that, no variable is treated as a counter.
+    static const int MAX_WALKS = 4;
+
+    // The fewest operands a chain needs to be regrouped
+    static const size_t MIN_CHAIN = 4;
+
+    // The values something can have, from `low` to `high`. They are kept in
+    // 64 bits, so that arithmetic on them can't overflow.
+    struct Range
+    {
+        int64_t low;
+        int64_t high;
+    };
+
+    // How a variable changes inside loops
+    enum Direction : uint8_t
+    {
+        D_NONE,     // It isn't assigned in any loop
+        D_UP,       // Only ever by adding a number that isn't negative
+        D_DOWN,     // Only ever by subtracting a number that isn't negative
+        D_ANY,      // Any other way
+    };
+
+    // The steps of work left to do while walking the statements
+    enum WalkStep : uint8_t
+    {
+        W_STATEMENTS,   // Walk the statements of a list, starting at `id`
+        W_IF_THEN,      // The if block of the if `id` has been walked
+        W_IF_ELSE,      // The else block of the if `id` has been walked
+        W_LOOP,         // The body of the loop `id` has been walked
+    };
+
+    // A single step of work
+    struct WalkTask
+    {
+        WalkStep step;
+        NodeId id;
+        size_t mark;        // The length of the trail when the block began
+        size_t thenValues;  // W_IF_ELSE: where the if block's ranges start
+    };
+
+    // A step of evaluating an expression
+    struct ExpressionTask
+    {
+        NodeId id;
+        bool operandsDone;
+    };
+
+    Program& m_program;
+    Ast& m_ast;
+
+    // Set on the last walk, which is the one that rewrites the program
+    bool m_rewrite = false;
+
+    // Set when a loop counter might overflow, so the program has to be
+    // walked again
+    bool m_retry = false;
+
+    // How each variable changes inside loops
+    std::vector<Direction> m_directions;
+
+    // The range of each variable at the point being walked
+    std::vector<Range> m_ranges;
+
+    // The earlier range of each variable that has been changed, so the
+    // changes made in a block can be undone
+    std::vector<std::pair<SymbolId, Range>> m_trail;
+
+    // The number of blocks that may be undone, and how many of them are
+    // loops
+    size_t m_openBlocks = 0;
+    size_t m_openLoops = 0;
+
+    // The ranges variables had at the end of if blocks whose else blocks
+    // are being walked
+    std::vector<std::pair<SymbolId, Range>> m_branchValues;
+
+    // Scratch space for matching up the variables changed by each branch
+    std::vector<uint32_t> m_stamps;
+    std::vector<size_t> m_slots;
+    uint32_t m_stamp = 0;
+
+    // The variables assigned anywhere in each loop
+    std::unordered_map<NodeId, std::vector<SymbolId>> m_loopAssigns;
+
+    // The work left to do while walking the statements
+    std::vector<WalkTask> m_work;
+
+    // The range of each node of the last expression evaluated
+    std::vector<Range> m_nodeRanges;
+
+    // Set if the last expression evaluated has a division that may fail, or
+    // arithmetic that may overflow
+    bool m_mayFail = false;
+    bool m_mayOverflow = false;
+
+    // Scratch space for evaluating, narrowing and rewriting expressions
+    std::vector<ExpressionTask> m_expressionWork;
+    std::vector<std::pair<NodeId, bool>> m_conditionWork;
+    std::vector<NodeId> m_rewriteWork;
+    std::vector<NodeId> m_spine;
+    std::vector<NodeId> m_leaves;
+    std::vector<NodeId> m_level;
+
+    // Works out how each variable changes inside loops
+    void findDirections();
+
+    // Walks the whole program once
+    void walk();
+
+    // Walks a single statement
+    void visit(NodeId id);
+
+    // Walks the start of a loop. `test` is the loop's condition, or the
+    // count of a dotimes loop.
+    void enterLoop(NodeId id, NodeId test, NodeId body, bool dotimes);
+
+    // Joins the ranges from both branches of an if, once its else block
+    // has been walked
+    void joinBranches(const WalkTask& task);
+
+    // Gets the range of an expression, and rewrites it if this is the last
+    // walk
+    Range reduce(NodeId root);
+
+    // Gets the range of an expression, filling in `m_nodeRanges`
+    Range evaluate(NodeId root);
+
+    // Gets the range of the result of an operator
+    Range evaluateOperator(int op, Range left, Range right);
+
+    // Narrows the ranges of the variables in a condition to the values for
+    // which the condition is `truth`
+    void narrow(NodeId condition, bool truth);
+
+    // Narrows the range of a variable compared with an expression
+    void narrowVariable(NodeId variable, int op, NodeId other);
+
+    // Rewrites an expression whose ranges have been worked out
+    void rewrite(NodeId root);
+
+    // Rewrites a single operator into a cheaper one. Returns true if the
+    // node was changed.
+    bool simplify(NodeId id);
+
+    // Regroups a chain of the same commutative operator into a balanced
+    // tree. Returns true if it was, leaving the operands in `m_leaves`.
+    bool rebalance(NodeId id);
+
+    // Sets the range of a variable
+    void set(SymbolId symbol, Range range);
+
+    // Undoes the changes made since the trail had `mark` entries
+    void undo(size_t mark);
+
+    // Collects the variables changed since the trail had `mark` entries,
+    // along with their current ranges, into `m_branchValues`
+    void collectChanges(size_t mark);
+};
+
+#endif
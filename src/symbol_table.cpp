@@ -0,0 +1,162 @@
+/*
+File: symbol_table.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `SymbolTable` class.
+*/
+
+
+#include "symbol_table.h"
+
+// The starting number of slots in the hash table
+static const size_t INITIAL_SLOTS = 64;
+
+SymbolTable::SymbolTable() : m_slots(INITIAL_SLOTS, 0)
+{
+    refresh();
+}
+
+SymbolTable::SymbolTable(const Layout& layout) 
+    : m_layout(layout), m_borrowed(true)
+{
+}
+
+void SymbolTable::own()
+{
+    if (!m_borrowed)
+        return;
+
+    const Layout& from = m_layout;
+    m_slots.assign(from.slots, from.slots + from.slotCount);
+    m_names.assign(from.names, from.namesLength);
+    m_offsets.assign(from.offsets, from.offsets + from.count);
+    m_lengths.assign(from.lengths, from.lengths + from.count);
+    m_hashes.assign(from.hashes, from.hashes + from.count);
+    m_borrowed = false;
+    refresh();
+}
+
+void SymbolTable::refresh()
+{
+    m_layout.slots = m_slots.data();
+    m_layout.slotCount = m_slots.size();
+    m_layout.names = m_names.data();
+    m_layout.namesLength = m_names.size();
+    m_layout.offsets = m_offsets.data();
+    m_layout.lengths = m_lengths.data();
+    m_layout.hashes = m_hashes.data();
+    m_layout.count = m_offsets.size();
+}
+
+uint64_t SymbolTable::hash(std::string_view name)
+{
+    // 64-bit FNV-1a
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (char c : name)
+    {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+size_t SymbolTable::probe(std::string_view name, uint64_t hash) const
+{
+    // Linear probing. The table is never allowed to fill up, so this always
+    // finds either the name or an empty slot.
+    const SymbolId* slots = m_layout.slots;
+    size_t mask = m_layout.slotCount - 1;
+    size_t slot = hash & mask;
+    while (slots[slot] != 0)
+    {
+        SymbolId id = slots[slot] - 1;
+        if (m_layout.hashes[id] == hash && this->name(id) == name)
+            break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+SymbolId SymbolTable::find(std::string_view name) const
+{
+    size_t slot = probe(name, hash(name));
+    SymbolId id = m_layout.slots[slot];
+    return id == 0 ? NO_SYMBOL : id - 1;
+}
+
+SymbolId SymbolTable::add(std::string_view name)
+{
+    uint64_t h = hash(name);
+    size_t slot = probe(name, h);
+    if (m_layout.slots[slot] != 0)
+        return m_layout.slots[slot] - 1;
+
+    own();
+    SymbolId id = static_cast<SymbolId>(m_offsets.size());
+    m_offsets.push_back(m_names.size());
+    m_lengths.push_back(static_cast<uint32_t>(name.size()));
+    m_hashes.push_back(h);
+    m_names.append(name.data(), name.size());
+    m_slots[slot] = id + 1;
+
+    // Keep the load factor at or below 1/2 so probe sequences stay short
+    if (m_offsets.size() * 2 > m_slots.size())
+        grow();
+
+    refresh();
+    return id;
+}
+
+void SymbolTable::grow()
+{
+    rehash(m_slots.size() * 2);
+}
+
+void SymbolTable::rehash(size_t slotCount)
+{
+    std::vector<SymbolId> slots(slotCount, 0);
+    size_t mask = slots.size() - 1;
+    for (SymbolId id = 0; id < m_offsets.size(); id++)
+    {
+        size_t slot = m_hashes[id] & mask;
+        while (slots[slot] != 0)
+            slot = (slot + 1) & mask;
+        slots[slot] = id + 1;
+    }
+    m_slots.swap(slots);
+}
+
+std::vector<SymbolId> SymbolTable::retain(const std::vector<bool>& keep)
+{
+    own();
+
+    // Move the kept symbols down over the removed ones. A symbol only ever
+    // moves to an ID at or below its own, so nothing is overwritten before
+    // it is read.
+    std::vector<SymbolId> ids(m_offsets.size(),
+        static_cast<SymbolId>(NO_SYMBOL));
+    std::string names;
+    SymbolId count = 0;
+    for (SymbolId id = 0; id < m_offsets.size(); id++)
+    {
+        if (!keep[id])
+            continue;
+
+        std::string_view name = this->name(id);
+        ids[id] = count;
+        m_offsets[count] = names.size();
+        m_lengths[count] = m_lengths[id];
+        m_hashes[count] = m_hashes[id];
+        names.append(name.data(), name.size());
+        count++;
+    }
+
+    m_names.swap(names);
+    m_offsets.resize(count);
+    m_lengths.resize(count);
+    m_hashes.resize(count);
+    rehash(m_slots.size());
+    refresh();
+    return ids;
+}
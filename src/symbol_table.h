@@ -0,0 +1,134 @@
+/*
+File: symbol_table.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the symbol table that tracks declared variables.
+*/
+
+
+#ifndef __SYMBOL_TABLE_H__
+#define __SYMBOL_TABLE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Identifies an interned symbol. Symbols are numbered densely from 0 in the
+// order they were added.
+typedef uint32_t SymbolId;
+
+/*
+The `SymbolTable` class interns variable names. Each name is stored once and
+maps to a dense integer ID through an open addressing hash table, so looking
+a name up costs the same no matter how many variables have been declared.
+Since our simple language has no concept of variable scope, a single table is
+all the compiler needs.
+*/
+class SymbolTable
+{
+public:
+    // Returned by `find` when a name hasn't been added
+    static const SymbolId NO_SYMBOL = UINT32_MAX;
+
+    // The arrays a table is made of. A table can be rebuilt from these
+    // without hashing any names, which is how .bbc files store one.
+    struct Layout
+    {
+        const SymbolId* slots;      // The hash table
+        size_t slotCount;           // A power of two
+        const char* names;          // Every name, back to back
+        size_t namesLength;
+        const uint64_t* offsets;    // Where each name starts in `names`
+        const uint32_t* lengths;    // The length of each name
+        const uint64_t* hashes;     // The hash of each name
+        size_t count;               // The number of symbols
+    };
+
+    // Creates an empty table
+    SymbolTable();
+
+    // Creates a table over arrays that are already in memory, such as a
+    // mapped .bbc file. Nothing is copied until a name is added, so the
+    // arrays must outlive the table.
+    SymbolTable(const Layout& layout);
+
+    // A table can't be copied, since it may borrow its arrays
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    // Looks up the ID of a name. Returns NO_SYMBOL if the name hasn't been
+    // added.
+    SymbolId find(std::string_view name) const;
+
+    // Adds a name to the table and returns its ID. If the name has already
+    // been added, its existing ID is returned.
+    SymbolId add(std::string_view name);
+
+    // Gets the name of a symbol. The view is invalidated when another name is
+    // added.
+    std::string_view name(SymbolId id) const
+    {
+        return std::string_view(m_layout.names + m_layout.offsets[id], 
+            m_layout.lengths[id]);
+    }
+
+    // Removes every symbol that isn't marked in `keep`, and numbers the rest
+    // densely again in the order they were added. Returns the new ID of each
+    // old symbol, or NO_SYMBOL for the ones that were removed.
+    std::vector<SymbolId> retain(const std::vector<bool>& keep);
+
+    // Gets the number of symbols in the table
+    size_t size() const { return m_layout.count; }
+
+    // Gets the arrays the table is made of. They are invalidated when
+    // another name is added.
+    const Layout& layout() const { return m_layout; }
+
+private:
+    // The arrays the table reads from. These point either at the vectors
+    // below or at borrowed memory.
+    Layout m_layout;
+
+    // Tracks if the arrays are borrowed
+    bool m_borrowed = false;
+
+    // The hash table. Each slot holds a symbol ID plus one, or 0 when empty.
+    // The size of this is always a power of two.
+    std::vector<SymbolId> m_slots;
+
+    // The characters of every name, stored back to back
+    std::string m_names;
+
+    // The offset of each symbol's name in `m_names`
+    std::vector<uint64_t> m_offsets;
+
+    // The length of each symbol's name
+    std::vector<uint32_t> m_lengths;
+
+    // The hash of each symbol's name, kept so the table can grow without 
+    // hashing every name again
+    std::vector<uint64_t> m_hashes;
+
+    // Hashes a name
+    static uint64_t hash(std::string_view name);
+
+    // Copies borrowed arrays into the vectors before the table changes
+    void own();
+
+    // Points the layout at the vectors after they change
+    void refresh();
+
+    // Finds the slot that holds a name, or the empty slot where it belongs
+    size_t probe(std::string_view name, uint64_t hash) const;
+
+    // Doubles the size of the hash table
+    void grow();
+
+    // Rebuilds the hash table with the given number of slots
+    void rehash(size_t slotCount);
+};
+
+#endif
@@ -8,27 +8,38 @@ Course: CSC 407
 #ifndef __TOKEN_H__
 #define __TOKEN_H__
 
-#include <string>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
 
 #include "token_type.h"
 
 /*
 The `Token` class is a simple wrapper around a single token within the
-langauge. 
+langauge. A token doesn't own its lexeme, it is a span (start + length) into
+the source buffer, or into static text for tokens that don't come from the
+source. This keeps tokens small and trivially copyable, so creating and
+passing them around never touches the heap.
 */
 class Token
 {
 public:
-    // Initializes this token with a lexeme and a type
-    Token(std::string lexeme, TokenType type) : m_lexeme(lexeme),
-        m_type(type) { }
-
-    // Initialization that takes a single character for the lexme
-    Token(char lexeme, TokenType type) :
-        Token(std::string(1, lexeme), type) { }
+    // Initializes this token with a lexeme and a type. The text the lexeme 
+    // refers to must outlive the token.
+    Token(std::string_view lexeme, TokenType type) : m_text(lexeme.data()),
+        m_length(static_cast<uint32_t>(lexeme.size())), m_type(type) { }
+
+    // Initializes a number token along with its decoded value. `overflow` is
+    // set when the literal doesn't fit in an int.
+    Token(std::string_view lexeme, int value, bool overflow) : 
+        Token(lexeme, T_NUM)
+    {
+        m_value = value;
+        m_overflow = overflow;
+    }
 
     // Allow creating an empty Token
-    Token() { }
+    Token() : m_text(""), m_length(0), m_type(T_UNKNOWN) { }
 
     // Checks if a token is a keyword. This is an easy check since keywords are
     // defined to have a value >= 300
@@ -89,17 +100,40 @@ public:
     }
 
     // Gets the lexeme for this token
-    std::string lexeme() const { return m_lexeme; }
+    std::string_view lexeme() const 
+    { 
+        return std::string_view(m_text, m_length); 
+    }
 
     // Gets the type for this token
     TokenType type() const { return m_type; }
+
+    // Gets the value of a number token
+    int value() const { return m_value; }
+
+    // Checks if a number token was too large to fit in an int
+    bool overflows() const { return m_overflow; }
     
 private:
-    // The lexeme this token represents
-    std::string m_lexeme;
+    // The start of the lexeme this token represents
+    const char* m_text;
+
+    // The length of the lexeme
+    uint32_t m_length;
 
     // The type of token this is
     TokenType m_type;
+
+    // The decoded value of a number token
+    int m_value = 0;
+
+    // Set when a number token doesn't fit in `m_value`
+    bool m_overflow = false;
 };
 
+// Tokens are copied freely between the lexer, parser and generator, so they
+// must stay cheap to copy.
+static_assert(std::is_trivially_copyable<Token>::value,
+    "Token must be trivially copyable");
+
 #endif
@@ -0,0 +1,126 @@
+/*
+File: token_pipeline.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `TokenPipeline` class.
+*/
+
+
+#include "token_pipeline.h"
+
+TokenPipeline::TokenPipeline(std::shared_ptr<Lexer> lexer, 
+    size_t ringCapacity)
+    : m_lexer(lexer), m_ring(ringCapacity),
+    m_last("EOF", T_EOF)
+{
+    m_thread = std::thread(&TokenPipeline::run, this);
+}
+
+TokenPipeline::~TokenPipeline()
+{
+    m_stopping.store(true, std::memory_order_relaxed);
+    m_thread.join();
+}
+
+void TokenPipeline::run()
+{
+    Token batch[BATCH_SIZE];
+    size_t count = 0;
+    while (true)
+    {
+        Token token;
+        try
+        {
+            token = m_lexer->getToken();
+        }
+        catch (const LexError& error)
+        {
+            m_error = error.what();
+            break;
+        }
+
+        // Newlines are never used by the parser
+        if (Token::isKind(token, T_NEWLINE))
+            continue;
+
+        batch[count++] = token;
+        if (count == BATCH_SIZE || Token::isKind(token, T_EOF))
+        {
+            if (!publish(batch, count))
+                return;
+            count = 0;
+        }
+
+        if (Token::isKind(token, T_EOF))
+            break;
+    }
+
+    // Publish whatever was lexed before an error
+    if (count > 0 && !publish(batch, count))
+        return;
+
+    m_finished.store(true, std::memory_order_release);
+}
+
+bool TokenPipeline::publish(const Token* tokens, size_t count)
+{
+    while (count > 0)
+    {
+        size_t pushed = m_ring.push(tokens, count);
+        tokens += pushed;
+        count -= pushed;
+
+        // The ring is full, give the parser a chance to catch up
+        if (pushed == 0)
+        {
+            if (m_stopping.load(std::memory_order_relaxed))
+                return false;
+            std::this_thread::yield();
+        }
+    }
+    return true;
+}
+
+Token TokenPipeline::next()
+{
+    if (m_batchPos == m_batch.size())
+        refill();
+
+    if (m_batchPos < m_batch.size())
+        m_last = m_batch[m_batchPos++];
+    return m_last;
+}
+
+void TokenPipeline::refill()
+{
+    m_batch.resize(BATCH_SIZE);
+    m_batchPos = 0;
+    while (true)
+    {
+        // Check if the lexer has finished before popping, so that nothing it
+        // pushed before finishing can be missed
+        bool finished = m_finished.load(std::memory_order_acquire);
+
+        size_t count = m_ring.pop(m_batch.data(), BATCH_SIZE);
+        if (count > 0)
+        {
+            m_batch.resize(count);
+            return;
+        }
+
+        if (finished)
+        {
+            // The parser has reached the point where lexing stopped, so the
+            // error is thrown here, on the parser's thread
+            if (!m_error.empty())
+                throw LexError(m_error);
+
+            // The input has ended, keep returning the T_EOF token
+            m_batch.clear();
+            return;
+        }
+
+        std::this_thread::yield();
+    }
+}
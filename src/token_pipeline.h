@@ -0,0 +1,106 @@
+/*
+File: token_pipeline.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the pipelined front end, which lexes on its own thread.
+*/
+
+
+#ifndef __TOKEN_PIPELINE_H__
+#define __TOKEN_PIPELINE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lexer.h"
+#include "token.h"
+#include "token_ring.h"
+
+/*
+The `TokenPipeline` class runs a lexer on a thread of its own so that lexing
+overlaps with parsing and code generation. The lexer thread collects tokens
+into batches and publishes them through a `TokenRing`, and the parser pops
+them a batch at a time on its own thread. When the ring is full the lexer
+waits for the parser to catch up, so only the ring's worth of tokens is ever
+held in flight.
+
+A lexing error stops the lexer thread, but it isn't thrown until the
+parser reaches the point in the input where it happened. This way errors are
+reported in the same order as when lexing on demand, and a parsing error
+earlier in the input still wins.
+
+Tokens refer to the lexer's input buffer, so the lexer must not be 
+streaming its input.
+*/
+class TokenPipeline
+{
+public:
+    // Starts lexing on a new thread
+    TokenPipeline(std::shared_ptr<Lexer> lexer, 
+        size_t ringCapacity = DEFAULT_RING_CAPACITY);
+
+    // Stops the lexer thread and waits for it to finish
+    ~TokenPipeline();
+
+    // The pipeline owns a running thread, so it can't be copied
+    TokenPipeline(const TokenPipeline&) = delete;
+    TokenPipeline& operator=(const TokenPipeline&) = delete;
+
+    // The number of tokens the ring holds by default
+    static const size_t DEFAULT_RING_CAPACITY = 16 * 1024;
+
+    // The number of tokens published or popped at a time
+    static const size_t BATCH_SIZE = 256;
+
+    // Gets the next token. Newlines are dropped, and once the input ends
+    // every call returns the T_EOF token.
+    Token next();
+
+private:
+    // The lexer being run on the other thread
+    std::shared_ptr<Lexer> m_lexer;
+
+    // The tokens passed from the lexer thread to the parser
+    TokenRing m_ring;
+
+    // Set by the lexer thread once it has pushed its last token
+    std::atomic<bool> m_finished{false};
+
+    // Set when the pipeline is being destroyed, so a lexer thread waiting on
+    // a full ring gives up
+    std::atomic<bool> m_stopping{false};
+
+    // The lexing error that stopped the lexer thread, if any. This is 
+    // written before `m_finished` is set, and only read after.
+    std::string m_error;
+
+    // The batch of tokens the parser is reading from
+    std::vector<Token> m_batch;
+
+    // The next token to read from the batch
+    size_t m_batchPos = 0;
+
+    // The last token read, which is repeated once the input has ended
+    Token m_last;
+
+    // The lexer thread. This is declared last so that everything it uses is
+    // constructed before it starts.
+    std::thread m_thread;
+
+    // The body of the lexer thread
+    void run();
+
+    // Pushes a batch of tokens, waiting for room in the ring as needed.
+    // Returns false if the pipeline is stopping.
+    bool publish(const Token* tokens, size_t count);
+
+    // Pops the next batch of tokens, waiting for the lexer as needed
+    void refill();
+};
+
+#endif
@@ -0,0 +1,66 @@
+/*
+File: token_ring.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `TokenRing` class.
+*/
+
+
+#include "token_ring.h"
+
+#include <algorithm>
+
+TokenRing::TokenRing(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    m_slots.reset(new Token[size]);
+    m_mask = size - 1;
+}
+
+size_t TokenRing::push(const Token* tokens, size_t count)
+{
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+
+    // Only go back to the consumer's index when the cached one says the ring
+    // is too full
+    size_t free = capacity() - (tail - m_cachedHead);
+    if (free < count)
+    {
+        m_cachedHead = m_head.load(std::memory_order_acquire);
+        free = capacity() - (tail - m_cachedHead);
+    }
+
+    count = std::min(count, free);
+    for (size_t i = 0; i < count; i++)
+        m_slots[(tail + i) & m_mask] = tokens[i];
+
+    // Publish the tokens. The release pairs with the consumer's acquire, so
+    // the tokens are visible before the new tail is.
+    m_tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+size_t TokenRing::pop(Token* tokens, size_t max)
+{
+    size_t head = m_head.load(std::memory_order_relaxed);
+
+    size_t available = m_cachedTail - head;
+    if (available == 0)
+    {
+        m_cachedTail = m_tail.load(std::memory_order_acquire);
+        available = m_cachedTail - head;
+    }
+
+    size_t count = std::min(max, available);
+    for (size_t i = 0; i < count; i++)
+        tokens[i] = m_slots[(head + i) & m_mask];
+
+    // Free the space. The release keeps the copies above from being moved
+    // after the producer is allowed to overwrite the slots.
+    m_head.store(head + count, std::memory_order_release);
+    return count;
+}
@@ -0,0 +1,75 @@
+/*
+File: token_ring.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for a lock-free ring buffer of tokens.
+*/
+
+
+#ifndef __TOKEN_RING_H__
+#define __TOKEN_RING_H__
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "token.h"
+
+/*
+The `TokenRing` class is a fixed size, single-producer/single-consumer ring
+buffer of tokens. One thread pushes tokens and one other thread pops them,
+without either of them ever taking a lock. The producer publishes a batch by
+advancing the tail and the consumer frees space by advancing the head, so
+each index is only ever written by one side. Each side also keeps a cached
+copy of the other side's index, so it only touches the shared cache line
+when it looks like the ring is full (or empty).
+*/
+class TokenRing
+{
+public:
+    // Creates a ring that holds at least `capacity` tokens. The capacity is
+    // rounded up to a power of two.
+    TokenRing(size_t capacity);
+
+    // The ring can't be copied, since both threads refer to it
+    TokenRing(const TokenRing&) = delete;
+    TokenRing& operator=(const TokenRing&) = delete;
+
+    // Producer: copies up to `count` tokens into the ring and publishes them.
+    // Returns the number of tokens pushed, which is 0 when the ring is full.
+    size_t push(const Token* tokens, size_t count);
+
+    // Consumer: copies up to `max` tokens out of the ring and frees their
+    // space. Returns the number of tokens popped, which is 0 when the ring 
+    // is empty.
+    size_t pop(Token* tokens, size_t max);
+
+    // Gets the number of tokens the ring holds
+    size_t capacity() const { return m_mask + 1; }
+
+private:
+    // The size of a cache line. The indexes are kept on separate lines so
+    // the two threads don't invalidate each other's cache on every push.
+    static const size_t CACHE_LINE = 64;
+
+    // The token storage
+    std::unique_ptr<Token[]> m_slots;
+
+    // The capacity minus one, used to wrap indexes into the storage
+    size_t m_mask;
+
+    // The index of the next token to pop. Only written by the consumer.
+    alignas(CACHE_LINE) std::atomic<size_t> m_head{0};
+
+    // The producer's last view of `m_head`
+    size_t m_cachedHead = 0;
+
+    // The index of the next token to push. Only written by the producer.
+    alignas(CACHE_LINE) std::atomic<size_t> m_tail{0};
+
+    // The consumer's last view of `m_tail`
+    size_t m_cachedTail = 0;
+};
+
+#endif
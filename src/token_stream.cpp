@@ -0,0 +1,63 @@
+/*
+File: token_stream.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `TokenStream` class.
+*/
+
+
+#include "token_stream.h"
+
+TokenStream::TokenStream(std::shared_ptr<Lexer> lexer) 
+    : m_lexer(lexer), m_base(lexer->buffer())
+{
+    // Guess at the number of tokens from the size of the input to avoid most
+    // of the regrowth while lexing
+    size_t estimate = m_lexer->bufferLength() / 4 + 1;
+    m_types.reserve(estimate);
+    m_offsets.reserve(estimate);
+    m_lengths.reserve(estimate);
+    m_values.reserve(estimate);
+    m_overflows.reserve(estimate);
+
+    Token token;
+    do
+    {
+        token = m_lexer->getToken();
+        if (Token::isKind(token, T_NEWLINE))
+            continue;
+
+        m_types.push_back(static_cast<int16_t>(token.type()));
+        m_lengths.push_back(static_cast<uint32_t>(token.lexeme().size()));
+        m_values.push_back(token.value());
+        m_overflows.push_back(token.overflows());
+
+        // The EOF and unknown tokens don't refer to the source, so they don't
+        // have an offset
+        if (Token::isKind(token, T_EOF) || Token::isKind(token, T_UNKNOWN))
+            m_offsets.push_back(0);
+        else
+            m_offsets.push_back(token.lexeme().data() - m_base);
+    } while (!Token::isKind(token, T_EOF));
+}
+
+Token TokenStream::at(size_t index) const
+{
+    if (index >= m_types.size())
+        index = m_types.size() - 1;
+
+    switch (type(index))
+    {
+        case T_EOF:
+            return Token("EOF", T_EOF);
+        case T_UNKNOWN:
+            return Token("UNKNOWN", T_UNKNOWN);
+        case T_NUM:
+            return Token(std::string_view(m_base + m_offsets[index], 
+                m_lengths[index]), m_values[index], m_overflows[index] != 0);
+        default:
+            return Token(std::string_view(m_base + m_offsets[index], 
+                m_lengths[index]), type(index));
+    }
+}
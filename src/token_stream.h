@@ -0,0 +1,70 @@
+/*
+File: token_stream.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for a fully lexed stream of tokens.
+*/
+
+
+#ifndef __TOKEN_STREAM_H__
+#define __TOKEN_STREAM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lexer.h"
+#include "token.h"
+#include "token_type.h"
+
+/*
+The `TokenStream` class tokenizes an entire input up front and stores the
+result as a struct of arrays: one array each for the token types, the offsets
+and lengths of their lexemes in the source buffer, and the decoded values of
+number literals. Newlines are never used by the parser, so they are dropped
+while lexing. The stream always ends with a single T_EOF token.
+*/
+class TokenStream
+{
+public:
+    // Lexes everything remaining in the lexer's input
+    TokenStream(std::shared_ptr<Lexer> lexer);
+
+    // Gets the number of tokens in the stream, including the final T_EOF
+    size_t size() const { return m_types.size(); }
+
+    // Gets the type of the token at a given index
+    TokenType type(size_t index) const 
+    { 
+        return static_cast<TokenType>(m_types[index]); 
+    }
+
+    // Rebuilds the token at a given index. Indexes past the end of the stream
+    // return the final T_EOF token.
+    Token at(size_t index) const;
+
+private:
+    // Keeps the source buffer the offsets refer to alive
+    std::shared_ptr<Lexer> m_lexer;
+
+    // The start of the source buffer
+    const char* m_base;
+
+    // The type of each token
+    std::vector<int16_t> m_types;
+
+    // The offset of each token's lexeme in the source buffer
+    std::vector<size_t> m_offsets;
+
+    // The length of each token's lexeme
+    std::vector<uint32_t> m_lengths;
+
+    // The decoded value of each number literal (0 for other tokens)
+    std::vector<int32_t> m_values;
+
+    // Set for number literals that don't fit in an int
+    std::vector<uint8_t> m_overflows;
+};
+
+#endif
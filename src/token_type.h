@@ -28,6 +28,12 @@ enum TokenType
     T_MUL = 204,        // *
     T_MOD = 212,        // %
 
+    // Operators that are never lexed. The optimizer uses them in place of
+    // the ones above when it can show they give the same result.
+    T_SHL = 213,        // <<
+    T_SHR = 214,        // >>
+    T_BITAND = 215,     // &
+
     // Everthing Else
     T_LPAREN = 112,     // (
     T_RPAREN = 113,     // )
@@ -57,6 +63,10 @@ enum TokenType
     T_PRINT = 304,      // print
     T_DOTIMES = 305,    // dotimes
     T_READ = 306,       // read
+
+    // Marks the last keyword above. When adding a keyword, give it the next
+    // value, point this at it, and add its spelling to `keywords.h`.
+    T_LAST_KEYWORD = T_READ,
 };
 
 #endif
@@ -0,0 +1,391 @@
+/*
+File: value_numberer.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `ValueNumberer` class.
+*/
+
+
+#include "value_numberer.h"
+
+#include "optimizer.h"
+#include "token_type.h"
+
+// Checks if the operands of an operator can be swapped without changing its
+// value. Conditions can't have side effects, so this includes `and` and `or`.
+static bool isCommutative(int op)
+{
+    return op == T_PLUS || op == T_MUL || op == T_EQEQ || op == T_NEQ
+        || op == T_AND || op == T_OR;
+}
+
+ValueNumberer::ValueNumberer(Program& program)
+    : m_program(program), m_ast(program.ast)
+{
+}
+
+void ValueNumberer::run()
+{
+    findLoopAssigns(m_ast, m_ast.root(), m_loopAssigns);
+
+    // Every variable starts out with a value of its own, since nothing is
+    // known about it before it is assigned
+    size_t symbols = m_program.symbols.size();
+    m_values.resize(symbols);
+    for (SymbolId symbol = 0; symbol < symbols; symbol++)
+        set(symbol, newValue());
+    m_stamps.assign(symbols, 0);
+    m_slots.assign(symbols, 0);
+    m_nodeValues.assign(m_ast.size(), 0);
+    m_redundant.assign(m_ast.size(), false);
+
+    m_work.push_back(WalkTask{W_STATEMENTS, m_ast.root(), 0, 0});
+    while (!m_work.empty())
+    {
+        WalkTask task = m_work.back();
+        m_work.pop_back();
+        switch (task.step)
+        {
+            case W_STATEMENTS:
+                // Leave the rest of the list for after this statement
+                if (task.id != NO_NODE)
+                {
+                    m_work.push_back(WalkTask{W_STATEMENTS,
+                        m_ast[task.id].next, 0, 0});
+                    visit(task.id);
+                }
+                break;
+            case W_IF_THEN:
+            {
+                // Put the if block's values aside and walk the else block
+                // from the values before the if
+                const Node& node = m_ast[task.id];
+                size_t thenValues = m_branchValues.size();
+                collectChanges(task.mark);
+                undo(task.mark);
+                m_work.push_back(WalkTask{W_IF_ELSE, task.id, task.mark,
+                    thenValues});
+                if (node.flags & F_HAS_ELSE)
+                    m_work.push_back(WalkTask{W_STATEMENTS, node.c, 0, 0});
+                break;
+            }
+            case W_IF_ELSE:
+                joinBranches(task);
+                m_openBlocks--;
+                break;
+            case W_LOOP:
+                // The values at the end of the body only hold for one pass
+                // through it
+                undo(task.mark);
+                m_openBlocks--;
+                break;
+        }
+    }
+
+    removeRedundant();
+}
+
+void ValueNumberer::visit(NodeId id)
+{
+    Node& node = m_ast[id];
+    switch (node.kind)
+    {
+        case N_DECLARE:
+        case N_ASSIGN:
+        {
+            // A declaration without a value leaves the variable as it was
+            if (node.b == NO_NODE)
+                break;
+
+            ValueId value = number(node.b);
+            if (m_values[node.a] == value)
+            {
+                m_redundant[id] = true;
+                break;
+            }
+            if (!m_mayFail)
+                rewrite(node.b);
+            set(node.a, value);
+            break;
+        }
+        case N_READ:
+            // The value read isn't known. If the input has run out, the
+            // variable keeps its old value, but a new value covers that too.
+            set(node.a, newValue());
+            break;
+        case N_PRINT:
+            for (NodeId arg = node.a; arg != NO_NODE; arg = m_ast[arg].next)
+            {
+                Node& item = m_ast[arg];
+                if (item.kind == N_VAR)
+                    item.a = holder(m_values[item.a]);
+            }
+            break;
+        case N_IF:
+            number(node.a);
+            rewrite(node.a);
+            m_openBlocks++;
+            m_work.push_back(WalkTask{W_IF_THEN, id, m_trail.size(), 0});
+            m_work.push_back(WalkTask{W_STATEMENTS, node.b, 0, 0});
+            break;
+        case N_WHILE:
+        case N_DOTIMES:
+            enterLoop(id, node.a, node.b);
+            break;
+        default:
+            break;
+    }
+}
+
+void ValueNumberer::enterLoop(NodeId id, NodeId test, NodeId body)
+{
+    // The test runs again after every pass through the body, so anything
+    // the loop assigns may have changed by then
+    for (SymbolId symbol : m_loopAssigns[id])
+        set(symbol, newValue());
+    number(test);
+    rewrite(test);
+
+    m_openBlocks++;
+    m_work.push_back(WalkTask{W_LOOP, id, m_trail.size(), 0});
+    m_work.push_back(WalkTask{W_STATEMENTS, body, 0, 0});
+}
+
+void ValueNumberer::joinBranches(const WalkTask& task)
+{
+    // Put the else block's values after the if block's, then go back to the
+    // values from before the if
+    size_t elseValues = m_branchValues.size();
+    collectChanges(task.mark);
+    undo(task.mark);
+
+    // Match each variable the else block changed with its value from the
+    // if block, or from before the if if the if block didn't change it. A
+    // variable whose values differ gets a new one, the same as a phi.
+    uint32_t stamp = ++m_stamp;
+    for (size_t i = task.thenValues; i < elseValues; i++)
+    {
+        SymbolId symbol = m_branchValues[i].first;
+        m_stamps[symbol] = stamp;
+        m_slots[symbol] = i;
+    }
+
+    std::vector<std::pair<SymbolId, ValueId>> joined;
+    for (size_t i = elseValues; i < m_branchValues.size(); i++)
+    {
+        SymbolId symbol = m_branchValues[i].first;
+        ValueId thenValue = m_values[symbol];
+        if (m_stamps[symbol] == stamp)
+        {
+            thenValue = m_branchValues[m_slots[symbol]].second;
+            m_stamps[symbol] = 0;
+        }
+        joined.emplace_back(symbol, thenValue);
+        if (thenValue != m_branchValues[i].second)
+            joined.back().second = newValue();
+    }
+
+    // The rest were only changed by the if block
+    for (size_t i = task.thenValues; i < elseValues; i++)
+    {
+        SymbolId symbol = m_branchValues[i].first;
+        if (m_stamps[symbol] == stamp)
+        {
+            joined.emplace_back(symbol, m_branchValues[i].second);
+            if (m_branchValues[i].second != m_values[symbol])
+                joined.back().second = newValue();
+        }
+    }
+
+    m_branchValues.resize(task.thenValues);
+    for (const auto& [symbol, value] : joined)
+        set(symbol, value);
+}
+
+ValueNumberer::ValueId ValueNumberer::number(NodeId root)
+{
+    // Operands are numbered before the operators that use them
+    m_mayFail = false;
+    m_expressionWork.clear();
+    m_expressionWork.push_back(ExpressionTask{root, false});
+    while (!m_expressionWork.empty())
+    {
+        ExpressionTask task = m_expressionWork.back();
+        m_expressionWork.pop_back();
+
+        const Node& node = m_ast[task.id];
+        if (!task.operandsDone && (node.kind == N_PAREN
+            || node.kind == N_NOT || node.kind == N_BINARY))
+        {
+            m_expressionWork.push_back(ExpressionTask{task.id, true});
+            m_expressionWork.push_back(ExpressionTask{node.a, false});
+            if (node.kind == N_BINARY)
+                m_expressionWork.push_back(ExpressionTask{node.b, false});
+            continue;
+        }
+
+        ValueId value = 0;
+        switch (node.kind)
+        {
+            case N_NUM:
+                value = lookup(ValueKey{N_NUM, 0, node.a, 0});
+                break;
+            case N_VAR:
+                value = m_values[node.a];
+                break;
+            case N_PAREN:
+                value = m_nodeValues[node.a];
+                break;
+            case N_NOT:
+                value = lookup(ValueKey{N_NOT, 0, m_nodeValues[node.a], 0});
+                break;
+            case N_BINARY:
+            {
+                ValueId left = m_nodeValues[node.a];
+                ValueId right = m_nodeValues[node.b];
+                if (isCommutative(node.op) && right < left)
+                    std::swap(left, right);
+                if ((node.op == T_DIV || node.op == T_MOD) 
+                    && !isSafeDivisor(m_ast, node.b))
+                    m_mayFail = true;
+                value = lookup(ValueKey{N_BINARY, node.op, left, right});
+                break;
+            }
+            default:
+                break;
+        }
+        m_nodeValues[task.id] = value;
+    }
+
+    return m_nodeValues[root];
+}
+
+void ValueNumberer::rewrite(NodeId root)
+{
+    // Work from the top down, so the largest part with a holder is the one
+    // that is replaced. A value that was computed before was computed on
+    // every way here, so a division it has didn't fail.
+    m_rewriteWork.clear();
+    m_rewriteWork.push_back(root);
+    while (!m_rewriteWork.empty())
+    {
+        Node& node = m_ast[m_rewriteWork.back()];
+        ValueId value = m_nodeValues[m_rewriteWork.back()];
+        m_rewriteWork.pop_back();
+
+        // Numbers are left as they are, since they cost nothing to compute
+        if (node.kind == N_NUM)
+            continue;
+
+        SymbolId symbol = holder(value);
+        if (symbol != SymbolTable::NO_SYMBOL)
+        {
+            // The node keeps its `next` link
+            node.kind = N_VAR;
+            node.flags = 0;
+            node.op = 0;
+            node.a = symbol;
+            node.b = 0;
+            node.c = 0;
+            continue;
+        }
+
+        if (node.kind == N_PAREN || node.kind == N_NOT
+            || node.kind == N_BINARY)
+            m_rewriteWork.push_back(node.a);
+        if (node.kind == N_BINARY)
+            m_rewriteWork.push_back(node.b);
+    }
+}
+
+SymbolId ValueNumberer::holder(ValueId value) const
+{
+    for (SymbolId symbol : m_holders[value])
+    {
+        if (m_values[symbol] == value)
+            return symbol;
+    }
+    return SymbolTable::NO_SYMBOL;
+}
+
+ValueNumberer::ValueId ValueNumberer::lookup(const ValueKey& key)
+{
+    auto found = m_table.find(key);
+    if (found != m_table.end())
+        return found->second;
+
+    ValueId value = newValue();
+    m_table.emplace(key, value);
+    return value;
+}
+
+ValueNumberer::ValueId ValueNumberer::newValue()
+{
+    m_holders.emplace_back();
+    return static_cast<ValueId>(m_holders.size() - 1);
+}
+
+void ValueNumberer::set(SymbolId symbol, ValueId value)
+{
+    if (m_openBlocks > 0)
+        m_trail.emplace_back(symbol, m_values[symbol]);
+    m_values[symbol] = value;
+    m_holders[value].push_back(symbol);
+}
+
+void ValueNumberer::undo(size_t mark)
+{
+    while (m_trail.size() > mark)
+    {
+        m_values[m_trail.back().first] = m_trail.back().second;
+        m_trail.pop_back();
+    }
+}
+
+void ValueNumberer::collectChanges(size_t mark)
+{
+    uint32_t stamp = ++m_stamp;
+    for (size_t i = mark; i < m_trail.size(); i++)
+    {
+        SymbolId symbol = m_trail[i].first;
+        if (m_stamps[symbol] != stamp)
+        {
+            m_stamps[symbol] = stamp;
+            m_branchValues.emplace_back(symbol, m_values[symbol]);
+        }
+    }
+}
+
+void ValueNumberer::removeRedundant()
+{
+    // Each block is relinked without the assignments that are removed. The
+    // nodes never move, since none are added, so links into them stay
+    // valid.
+    NodeId root = m_ast.root();
+    std::vector<NodeId*> blocks;
+    blocks.push_back(&root);
+    while (!blocks.empty())
+    {
+        NodeId* link = blocks.back();
+        blocks.pop_back();
+
+        for (NodeId id = *link; id != NO_NODE; id = m_ast[id].next)
+        {
+            Node& node = m_ast[id];
+            if (m_redundant[id])
+                continue;
+
+            *link = id;
+            link = &node.next;
+            if (node.kind == N_IF || node.kind == N_WHILE
+                || node.kind == N_DOTIMES)
+                blocks.push_back(&node.b);
+            if (node.kind == N_IF && (node.flags & F_HAS_ELSE))
+                blocks.push_back(&node.c);
+        }
+
+        *link = NO_NODE;
+    }
+    m_ast.setRoot(root);
+}
@@ -0,0 +1,210 @@
+/*
+File: value_numberer.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for the value numbering pass, which removes repeated
+computations and copies.
+*/
+
+
+#ifndef __VALUE_NUMBERER_H__
+#define __VALUE_NUMBERER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ast.h"
+#include "symbol_table.h"
+
+/*
+The `ValueNumberer` class gives every value the program computes a number,
+so that two expressions with the same number are known to be equal. The
+numbers are given out the way SSA form names values: every assignment
+defines a new value, the values of the two branches of an if are merged
+where they meet (a variable keeps its value only if both branches agree on
+it, and gets a new one otherwise), and a variable assigned anywhere in a loop
+gets a new value on the way into it. An expression is numbered from its
+operator and the numbers of its operands, so the same computation on the
+same values always gets the same number.
+
+With that, the pass rewrites the program:
+
+* An expression, or a part of one, whose value a variable already holds is
+  replaced by that variable, so a value is computed once and reused. This
+  covers repeated expressions like `(a + b) * c` in assignments and
+  conditions.
+* A variable is replaced by the first variable that took its value, so
+  copies like `t1 = x; t2 = t1; y = t2 + 1;` become `y = x + 1;`. The
+  copies are then left for dead store elimination to remove.
+* An assignment of the value a variable already holds is removed.
+
+An expression with a division that may fail is left exactly as it was
+written, the same as in constant folding. Otherwise, a division could end
+up in a form the C compiler simplifies, such as `x / x`, and no longer fail.
+
+The program isn't lowered to a separate IR for this. The generator works
+from the AST, and the numbers carry the same information SSA names would.
+*/
+class ValueNumberer
+{
+public:
+    ValueNumberer(Program& program);
+
+    // Runs the pass
+    void run();
+
+private:
+    // Identifies a value
+    typedef uint32_t ValueId;
+
+    // What a value is computed from: the number of an N_NUM, or the
+    // operator and the values of the operands of an N_BINARY or N_NOT
+    struct ValueKey
+    {
+        NodeKind kind;
+        int16_t op;
+        uint32_t a;
+        uint32_t b;
+
+        bool operator==(const ValueKey& other) const
+        {
+            return kind == other.kind && op == other.op && a == other.a
+                && b == other.b;
+        }
+    };
+
+    // Hashes a `ValueKey`
+    struct ValueKeyHash
+    {
+        size_t operator()(const ValueKey& key) const
+        {
+            uint64_t h = (static_cast<uint64_t>(key.a) << 32) | key.b;
+            h ^= (static_cast<uint64_t>(key.kind) << 16
+                | static_cast<uint16_t>(key.op)) * 0x9e3779b97f4a7c15ull;
+            return static_cast<size_t>(h ^ (h >> 29));
+        }
+    };
+
+    // The steps of work left to do while walking the statements
+    enum WalkStep : uint8_t
+    {
+        W_STATEMENTS,   // Walk the statements of a list, starting at `id`
+        W_IF_THEN,      // The if block of the if `id` has been walked
+        W_IF_ELSE,      // The else block of the if `id` has been walked
+        W_LOOP,         // The body of the loop `id` has been walked
+    };
+
+    // A single step of work
+    struct WalkTask
+    {
+        WalkStep step;
+        NodeId id;
+        size_t mark;        // The length of the trail when the block began
+        size_t thenValues;  // W_IF_ELSE: where the if block's values start
+    };
+
+    // A step of numbering an expression
+    struct ExpressionTask
+    {
+        NodeId id;
+        bool operandsDone;
+    };
+
+    Program& m_program;
+    Ast& m_ast;
+
+    // The values that have been computed, by what they are computed from
+    std::unordered_map<ValueKey, ValueId, ValueKeyHash> m_table;
+
+    // The variables that have been given each value, in the order they were
+    // given it. A variable only holds the value if it hasn't changed since.
+    std::vector<std::vector<SymbolId>> m_holders;
+
+    // The value of each variable at the point being walked
+    std::vector<ValueId> m_values;
+
+    // The earlier value of each variable that has been changed, so the
+    // changes made in a block can be undone
+    std::vector<std::pair<SymbolId, ValueId>> m_trail;
+
+    // The number of blocks that may be undone. Changes only need to go on
+    // the trail while there are some.
+    size_t m_openBlocks = 0;
+
+    // The values variables had at the end of if blocks whose else blocks
+    // are being walked
+    std::vector<std::pair<SymbolId, ValueId>> m_branchValues;
+
+    // Scratch space for matching up the variables changed by each branch
+    std::vector<uint32_t> m_stamps;
+    std::vector<size_t> m_slots;
+    uint32_t m_stamp = 0;
+
+    // The variables assigned anywhere in each loop
+    std::unordered_map<NodeId, std::vector<SymbolId>> m_loopAssigns;
+
+    // The work left to do while walking the statements
+    std::vector<WalkTask> m_work;
+
+    // The value of each node of the expression being numbered
+    std::vector<ValueId> m_nodeValues;
+
+    // The stacks used to number and rewrite expressions
+    std::vector<ExpressionTask> m_expressionWork;
+    std::vector<NodeId> m_rewriteWork;
+
+    // The assignments to remove, by node
+    std::vector<bool> m_redundant;
+
+    // Set if the last expression numbered has a division that may fail
+    bool m_mayFail = false;
+
+    // Walks a single statement
+    void visit(NodeId id);
+
+    // Walks the start of a loop. `test` is the loop's condition, or the
+    // count of a dotimes loop.
+    void enterLoop(NodeId id, NodeId test, NodeId body);
+
+    // Joins the values from both branches of an if, once its else block
+    // has been walked
+    void joinBranches(const WalkTask& task);
+
+    // Numbers every node of an expression and returns the value of the
+    // whole expression
+    ValueId number(NodeId root);
+
+    // Replaces the largest parts of a numbered expression whose values are
+    // held by variables with those variables
+    void rewrite(NodeId root);
+
+    // Gets the first variable that still holds a value, or NO_SYMBOL if
+    // there isn't one
+    SymbolId holder(ValueId value) const;
+
+    // Gets the value computed from a key, giving it a new number if it
+    // hasn't been computed before
+    ValueId lookup(const ValueKey& key);
+
+    // Makes a value that is different from every other value
+    ValueId newValue();
+
+    // Sets the value of a variable
+    void set(SymbolId symbol, ValueId value);
+
+    // Undoes the changes made since the trail had `mark` entries
+    void undo(size_t mark);
+
+    // Collects the variables changed since the trail had `mark` entries,
+    // along with their current values, into `m_branchValues`
+    void collectChanges(size_t mark);
+
+    // Unlinks the assignments that were found to be redundant
+    void removeRedundant();
+};
+
+#endif
@@ -0,0 +1,140 @@
+/*
+File: work_pool.cpp
+Author: Adam Thompson
+Course: CSC 407
+
+Contains the implementation for the `WorkPool` class.
+*/
+
+
+#include "work_pool.h"
+
+WorkPool::WorkPool(size_t threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    for (size_t i = 0; i < threads; i++)
+        m_queues.push_back(std::make_unique<Queue>());
+
+    // The calling thread is the first worker, so only the rest need threads
+    for (size_t i = 1; i < threads; i++)
+        m_threads.emplace_back(&WorkPool::workerLoop, this, i);
+}
+
+WorkPool::~WorkPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+void WorkPool::parallelFor(size_t count, 
+    const std::function<void(size_t)>& body)
+{
+    if (count == 0)
+        return;
+
+    // The body is set before any item can be taken. A worker that is still
+    // looking for items from the last job may take one of these, and the
+    // queue locks make sure it sees the new body when it does.
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_body = &body;
+        m_remaining.store(count);
+    }
+
+    // Deal the items out in order, so each worker starts with a run of
+    // neighbouring items
+    size_t perWorker = (count + size() - 1) / size();
+    for (size_t i = 0; i < count; i++)
+    {
+        Queue& queue = *m_queues[i / perWorker];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.items.push_back(i);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> guard(m_lock);
+    m_done.wait(guard, [this]() { return m_remaining.load() == 0; });
+    m_body = nullptr;
+}
+
+void WorkPool::workerLoop(size_t worker)
+{
+    size_t seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(m_lock);
+            m_wake.wait(guard, [&]() { 
+                return m_stopping || m_generation != seen; 
+            });
+            if (m_stopping)
+                return;
+            seen = m_generation;
+        }
+
+        work(worker);
+    }
+}
+
+void WorkPool::work(size_t worker)
+{
+    size_t item;
+    while (take(worker, item))
+    {
+        (*m_body)(item);
+
+        // The last item to finish wakes the thread that started the job
+        if (m_remaining.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_done.notify_all();
+        }
+    }
+}
+
+bool WorkPool::take(size_t worker, size_t& item)
+{
+    // Take from the front of our own queue
+    {
+        Queue& own = *m_queues[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.items.empty())
+        {
+            item = own.items.front();
+            own.items.pop_front();
+            return true;
+        }
+    }
+
+    // Steal from the back of someone else's
+    for (size_t i = 1; i < m_queues.size(); i++)
+    {
+        Queue& victim = *m_queues[(worker + i) % m_queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.items.empty())
+        {
+            item = victim.items.back();
+            victim.items.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
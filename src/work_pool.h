@@ -0,0 +1,97 @@
+/*
+File: work_pool.h
+Author: Adam Thompson
+Course: CSC 407
+
+Definitions for a small work-stealing thread pool.
+*/
+
+
+#ifndef __WORK_POOL_H__
+#define __WORK_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+The `WorkPool` class runs numbered work items across a fixed set of threads.
+The items of a job are dealt out to one queue per worker, and each worker
+takes items from the front of its own queue. A worker that runs out steals
+from the back of another worker's queue, so one slow item doesn't hold up the
+items queued behind it. The thread that starts a job works on it too.
+*/
+class WorkPool
+{
+public:
+    // Creates a pool with `threads` workers, counting the calling thread.
+    // A count of 0 uses one worker per hardware thread.
+    WorkPool(size_t threads = 0);
+
+    // Stops the workers and waits for them to finish
+    ~WorkPool();
+
+    // The pool owns running threads, so it can't be copied
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    // Gets the number of workers, counting the calling thread
+    size_t size() const { return m_queues.size(); }
+
+    // Runs `body` once for every index in [0, count) and waits for all of
+    // them to finish. The body must not throw.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+    // The queue of items dealt to one worker
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<size_t> items;
+    };
+
+    // One queue per worker. The calling thread uses the first one.
+    std::vector<std::unique_ptr<Queue>> m_queues;
+
+    // The worker threads
+    std::vector<std::thread> m_threads;
+
+    // Guards starting and finishing jobs
+    std::mutex m_lock;
+
+    // Wakes the workers when a job starts or the pool is stopping
+    std::condition_variable m_wake;
+
+    // Wakes the calling thread when the last item of a job is done
+    std::condition_variable m_done;
+
+    // The body of the current job
+    const std::function<void(size_t)>* m_body = nullptr;
+
+    // Counts the jobs started, so the workers can tell a new one apart
+    size_t m_generation = 0;
+
+    // The number of items of the current job that haven't finished
+    std::atomic<size_t> m_remaining{0};
+
+    // Set when the pool is being destroyed
+    bool m_stopping = false;
+
+    // The loop run by each worker thread
+    void workerLoop(size_t worker);
+
+    // Runs items until there are none left to take
+    void work(size_t worker);
+
+    // Takes the next item for a worker, stealing one if its own queue is
+    // empty. Returns false when every queue is empty.
+    bool take(size_t worker, size_t& item);
+};
+
+#endif